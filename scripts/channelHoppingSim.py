@@ -0,0 +1,213 @@
+# Simulation of the LoRa channel hopping schedule of channelPlan.cpp
+# Nodes in a single collision domain send hellos and unicast data with random (ALOHA) timing, once on a
+# single channel and once with the hopping schedule: hellos in the rendezvous window of each slot on the
+# rendezvous channel, data on the home channel of the receiver. A frame is lost when it overlaps another
+# one on the same channel, when the receiver is transmitting, or when the receiver listens on another
+# channel, which happens when the slot clocks of the nodes differ (--skew).
+# Prints the collisions and the airtime of each channel and the aggregate throughput for each offered load.
+#
+# python3 channelHoppingSim.py --nodes 40 --loads 0.5 1 2 5 --skew 0
+import argparse
+import bisect
+import random
+
+from loraTimeOnAir import LM_CONFIG_HEADER_SIZE, LORA_COMPACT_HEADER, time_on_air
+
+# Values of config.h
+LORA_DATA_CHANNELS = 8
+LORA_HOPPING_SEED = 0x4C6F5261
+LORA_HOPPING_DWELL = 10000  # ms
+LORA_HOPPING_RENDEZVOUS = 2000  # ms
+HELLO_PACKETS_DELAY = 120  # s, LoRaMesher
+HELLO_SIZE = LM_CONFIG_HEADER_SIZE + 4 * 10  # 10 routes
+
+RENDEZVOUS_CHANNEL = 0
+DEFER_JITTER = 1000  # ms, spreads the data deferred to the end of the rendezvous window
+
+
+def mix(value):
+    value ^= value >> 16
+    value = (value * 0x7FEB352D) & 0xFFFFFFFF
+    value ^= value >> 15
+    value = (value * 0x846CA68B) & 0xFFFFFFFF
+    value ^= value >> 16
+    return value
+
+
+def home_channel(address, slot, seed=LORA_HOPPING_SEED):
+    """ChannelPlan::getHomeChannel"""
+    return 1 + mix((seed ^ ((address << 16) & 0xFFFFFFFF) ^ mix(slot & 0xFFFFFFFF)) & 0xFFFFFFFF) % LORA_DATA_CHANNELS
+
+
+def listen_channel(address, local_time, hopping):
+    if not hopping or local_time % LORA_HOPPING_DWELL < LORA_HOPPING_RENDEZVOUS:
+        return RENDEZVOUS_CHANNEL
+    return home_channel(address, int(local_time // LORA_HOPPING_DWELL))
+
+
+def place_data(local_time, airtime, rng):
+    """First time at or after local_time where the data fits after the rendezvous window of a slot"""
+    slot_start = local_time - local_time % LORA_HOPPING_DWELL
+    position = local_time - slot_start
+    jitter = rng.uniform(0, min(DEFER_JITTER, LORA_HOPPING_DWELL - LORA_HOPPING_RENDEZVOUS - airtime))
+    if position < LORA_HOPPING_RENDEZVOUS:
+        return slot_start + LORA_HOPPING_RENDEZVOUS + jitter
+    if position + airtime > LORA_HOPPING_DWELL:
+        return slot_start + LORA_HOPPING_DWELL + LORA_HOPPING_RENDEZVOUS + jitter
+    return local_time
+
+
+class Frame:
+    __slots__ = ("start", "end", "channel", "src", "dst", "collided")
+
+    def __init__(self, start, end, channel, src, dst):
+        self.start = start
+        self.end = end
+        self.channel = channel
+        self.src = src
+        self.dst = dst
+        self.collided = False
+
+
+def simulate(args, load, hopping):
+    rng = random.Random(args.seed)
+    addresses = rng.sample(range(1, 0xFFFF), args.nodes)
+    skews = {a: rng.uniform(-args.skew, args.skew) for a in addresses}
+    duration = args.duration * 1000
+    data_airtime = time_on_air(LM_CONFIG_HEADER_SIZE + LORA_COMPACT_HEADER + args.payload, args.sf, args.bw, args.cr, 8)
+    hello_airtime = time_on_air(HELLO_SIZE, args.sf, args.bw, args.cr, 8)
+
+    frames = []
+    for address in addresses:
+        skew = skews[address]
+        events = []
+
+        phase = rng.uniform(0, HELLO_PACKETS_DELAY * 1000)
+        for k in range(int(duration // (HELLO_PACKETS_DELAY * 1000)) + 1):
+            local = phase + k * HELLO_PACKETS_DELAY * 1000 + skew
+            if hopping:
+                slot_start = local - local % LORA_HOPPING_DWELL
+                local = slot_start + rng.uniform(0, LORA_HOPPING_RENDEZVOUS - hello_airtime)
+            events.append((local - skew, None))
+
+        time = 0.0
+        rate = load / 60000.0
+        while rate > 0:
+            time += rng.expovariate(rate)
+            if time >= duration:
+                break
+            dst = rng.choice(addresses)
+            while dst == address:
+                dst = rng.choice(addresses)
+            events.append((time, dst))
+
+        # One radio, the frames of a node are sent one after the other
+        events.sort(key=lambda e: e[0])
+        busy = -1e18
+        for time, dst in events:
+            start = max(time, busy)
+            if dst is None:
+                airtime = hello_airtime
+                channel = RENDEZVOUS_CHANNEL
+            else:
+                airtime = data_airtime
+                channel = RENDEZVOUS_CHANNEL
+                if hopping:
+                    local = place_data(start + skew, airtime, rng)
+                    start = local - skew
+                    channel = home_channel(dst, int(local // LORA_HOPPING_DWELL))
+            if start + airtime > duration:
+                continue
+            frames.append(Frame(start, start + airtime, channel, address, dst))
+            busy = start + airtime
+
+    by_channel = {}
+    for frame in frames:
+        by_channel.setdefault(frame.channel, []).append(frame)
+    for channel_frames in by_channel.values():
+        channel_frames.sort(key=lambda f: f.start)
+        for i, frame in enumerate(channel_frames):
+            j = i + 1
+            while j < len(channel_frames) and channel_frames[j].start < frame.end:
+                frame.collided = True
+                channel_frames[j].collided = True
+                j += 1
+
+    transmitting = {a: [] for a in addresses}
+    for frame in sorted(frames, key=lambda f: f.start):
+        transmitting[frame.src].append((frame.start, frame.end))
+    starts = {a: [s for s, _ in transmitting[a]] for a in addresses}
+
+    def is_transmitting(address, start, end):
+        i = bisect.bisect_left(starts[address], end)
+        return i > 0 and transmitting[address][i - 1][1] > start
+
+    def hears(address, frame):
+        if is_transmitting(address, frame.start, frame.end):
+            return False
+        skew = skews[address]
+        return (listen_channel(address, frame.start + skew, hopping) == frame.channel and
+                listen_channel(address, frame.end + skew, hopping) == frame.channel)
+
+    result = {"data": 0, "delivered": 0, "missed": 0, "hellos": 0, "hellosHeard": 0, "channels": {}}
+    for frame in frames:
+        stats = result["channels"].setdefault(frame.channel, [0, 0, 0.0])
+        stats[0] += 1
+        stats[1] += frame.collided
+        stats[2] += frame.end - frame.start
+
+        if frame.dst is None:
+            result["hellos"] += args.nodes - 1
+            if not frame.collided:
+                result["hellosHeard"] += sum(hears(a, frame) for a in addresses if a != frame.src)
+            continue
+
+        result["data"] += 1
+        if frame.collided:
+            continue
+        if hears(frame.dst, frame):
+            result["delivered"] += 1
+        elif not is_transmitting(frame.dst, frame.start, frame.end):
+            result["missed"] += 1
+
+    result["goodput"] = result["delivered"] * args.payload / args.duration
+    result["airtime"] = data_airtime
+    return result
+
+
+def report(name, result, duration):
+    data = max(result["data"], 1)
+    print("  %-8s sent %6d, delivered %6d (%5.1f%%), missed rendezvous %5d, goodput %7.1f B/s, hellos heard %5.1f%%" % (
+        name, result["data"], result["delivered"], 100.0 * result["delivered"] / data, result["missed"],
+        result["goodput"], 100.0 * result["hellosHeard"] / max(result["hellos"], 1)))
+    for channel in sorted(result["channels"]):
+        sent, collided, airtime = result["channels"][channel]
+        print("    channel %d: %6d frames, %6d collided (%5.1f%%), airtime %5.1f%%" % (
+            channel, sent, collided, 100.0 * collided / sent, 100.0 * airtime / (duration * 1000)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Collisions and throughput of a single channel against channel hopping")
+    parser.add_argument("--nodes", type=int, default=40, help="Nodes, all in range of each other")
+    parser.add_argument("--loads", type=float, nargs="+", default=[0.5, 1, 2, 5, 10], help="Data frames per node per minute")
+    parser.add_argument("--payload", type=int, default=100, help="Application bytes of a data frame")
+    parser.add_argument("--duration", type=int, default=3600, help="Simulated seconds")
+    parser.add_argument("--skew", type=float, default=0, help="Maximum slot clock error of a node, ms")
+    parser.add_argument("--sf", type=int, default=7, help="Spreading factor")
+    parser.add_argument("--bw", type=int, default=125000, help="Bandwidth in Hz")
+    parser.add_argument("--cr", type=int, default=7, help="Coding rate denominator, 5 to 8")
+    parser.add_argument("--seed", type=int, default=1, help="Random seed")
+    args = parser.parse_args()
+
+    for load in args.loads:
+        single = simulate(args, load, False)
+        hopping = simulate(args, load, True)
+        print("%d nodes, %.1f frames/min each, %.1f ms per frame" % (args.nodes, load, single["airtime"]))
+        report("single", single, args.duration)
+        report("hopping", hopping, args.duration)
+        if single["goodput"] > 0:
+            print("  hopping / single goodput: %.2f" % (hopping["goodput"] / single["goodput"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+# LoRa time on air of the LoRaChat messages
+# Compares the legacy 3 byte LoRa header with the header each message gets on the wire, for every
+# spreading factor. Uses the Semtech SX127x formula with the values of config.h.
+import argparse
+import math
+
+LM_CONFIG_HEADER_SIZE = 9  # LoRaMesher header
+LORA_LEGACY_HEADER = 3  # appPortDst, appPortSrc, messageId
+LORA_COMPACT_HEADER = 2  # appPortDst << 4 | appPortSrc, messageId
+
+# appPort of dataMessage.h
+GPS_APP = 4
+MQTT_APP = 8
+SIM_APP = 12
+LED_APP = 13
+SENSOR_APP = 14
+METADATA_APP = 15
+MON_APP = 16
+
+# Approximate payload of each message in bytes, with its appPortDst and appPortSrc
+MESSAGES = {
+    "Led": (1, LED_APP, LED_APP),
+    "Calibrate": (1, SENSOR_APP, MQTT_APP),
+    "GPS response": (33, MQTT_APP, GPS_APP),
+    "Monitor (2 neighbors)": (49 + 10 * 2 + 40, MQTT_APP, MON_APP),
+    "Measurement": (59, MQTT_APP, SENSOR_APP),
+    "Metadata": (40, MQTT_APP, METADATA_APP),
+    "Sim": (100 + 4, MQTT_APP, SIM_APP),
+}
+
+
+def lora_header_size(app_port_dst, app_port_src):
+    """Same rule as getLoRaMeshHeaderSize of loraMeshMessage.h"""
+    if 4 <= app_port_dst <= 15 and app_port_src <= 15:
+        return LORA_COMPACT_HEADER
+    return LORA_LEGACY_HEADER
+
+
+def time_on_air(payload, sf, bw, cr, preamble):
+    """Time on air in ms, explicit header and CRC on"""
+    symbol = (2**sf) / bw * 1000
+    low_data_rate = 1 if symbol > 16 else 0
+    payload_symbols = 8 + max(
+        math.ceil((8 * payload - 4 * sf + 28 + 16) / (4 * (sf - 2 * low_data_rate))) * cr,
+        0,
+    )
+    return (preamble + 4.25 + payload_symbols) * symbol
+
+
+def main():
+    parser = argparse.ArgumentParser(description="LoRa time on air of the legacy header and the header sent")
+    parser.add_argument("--bw", type=int, default=125000, help="Bandwidth in Hz")
+    parser.add_argument("--cr", type=int, default=7, help="Coding rate denominator, 5 to 8")
+    parser.add_argument("--preamble", type=int, default=8, help="Preamble symbols")
+    args = parser.parse_args()
+
+    print("%-24s %6s %4s %8s %8s %8s" % ("Message", "Header", "SF", "3B (ms)", "Sent (ms)", "Saved"))
+    for name, (size, app_port_dst, app_port_src) in MESSAGES.items():
+        header = lora_header_size(app_port_dst, app_port_src)
+        for sf in range(7, 13):
+            legacy = time_on_air(LM_CONFIG_HEADER_SIZE + LORA_LEGACY_HEADER + size, sf, args.bw, args.cr, args.preamble)
+            sent = time_on_air(LM_CONFIG_HEADER_SIZE + header + size, sf, args.bw, args.cr, args.preamble)
+            print("%-24s %5dB %4d %8.1f %8.1f %7.1f%%" % (name, header, sf, legacy, sent, 100 * (legacy - sent) / legacy))
+
+if __name__ == "__main__":
+    main()
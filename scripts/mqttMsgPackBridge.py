@@ -0,0 +1,205 @@
+# MQTT MessagePack bridge
+# Decodes the MessagePack uplinks published by the gateways on to-server-bin/<addr>
+# and republishes them as JSON on to-server/<addr>, so Telegraf keeps ingesting them.
+# The messages with a layout known here arrive as one positional array, the header
+# [appPortSrc, messageId, addrSrc, addrDst, messageSize] and then the values of the message
+# (MessageService::encode), and are rebuilt into the JSON the firmware publishes. The rest arrive as a
+# map of that JSON document and are passed through.
+import argparse
+import json
+
+import msgpack
+import paho.mqtt.client as mqtt
+
+MQTT_TOPIC_IN = "to-server-bin/"
+MQTT_TOPIC_OUT = "to-server/"
+
+# appPorts of dataMessage.h
+GPS_APP = 4
+SIM_APP = 12
+LED_APP = 13
+SENSOR_APP = 14
+METADATA_APP = 15
+MON_APP = 16
+
+HEADER_SIZE = 5
+
+SENSOR_DATA = 0  # SensorCommand::Data
+SIM_MESSAGE = 2  # SimCommand::Message
+SIM_PAYLOAD = 3  # SimCommand::Payload
+GPS_RESPONSE = 2  # GPSMessageType::getGPS
+
+
+def float32(value):
+    """The floats are sent as float32, print them with the digits they have, the integers stay integers"""
+    if isinstance(value, float):
+        return float("%.7g" % value)
+    return value
+
+
+def header(values):
+    return {"messageId": values[1], "addrSrc": values[2], "addrDst": values[3], "messageSize": values[4]}
+
+
+def gps(values):
+    """GPSMessage::serialize, from latitude, longitude, altitude, satellites, hour, minute, second, day, month, year"""
+    latitude, longitude, altitude, satellites, hour, minute, second, day, month, year = values
+    return {
+        "gps": {"latitude": latitude, "longitude": longitude, "altitude": altitude, "satellite_number": satellites},
+        "timestamp": "%04d-%02d-%02dT%02d:%02d:%02dZ" % (year, month or 1, day or 1, hour, minute, second),
+    }
+
+
+def measurement(values):
+    """MeasurementMessage::serializeDataSerialize"""
+    data = header(values)
+    data.update(gps(values[HEADER_SIZE + 1:HEADER_SIZE + 11]))
+    data["message_type"] = "measurement"
+
+    ph_temperature, ph, air_temperature, humidity, soil_temperature, moisture, conductivity, distance = [
+        float32(v) for v in values[HEADER_SIZE + 11:HEADER_SIZE + 19]]
+    data["message"] = [
+        {"measurement": ph_temperature, "type": "Soil_Temperature"},
+        {"measurement": ph, "type": "Soil_PH"},
+        {"measurement": humidity, "type": "humidity"},
+        {"measurement": air_temperature, "type": "temperature"},
+        {"measurement": soil_temperature, "type": "Soil_Temperature_Low_Res"},
+        {"measurement": moisture, "type": "Soil_Moisture"},
+        {"measurement": conductivity, "type": "Soil_Conductivity"},
+        {"measurement": distance, "type": "Water_Level"},
+    ]
+    return {"data": data}
+
+
+def sensor(values):
+    if values[HEADER_SIZE] == SENSOR_DATA:
+        return measurement(values)
+    # The calibrate commands are serialized on the root
+    data = header(values)
+    data["sensorCommand"] = values[HEADER_SIZE]
+    return data
+
+
+def metadata(values):
+    """MetadataMessage::serialize"""
+    data = header(values)
+    data.update(gps(values[HEADER_SIZE:HEADER_SIZE + 10]))
+    data["message_type"] = "metadata"
+    data["metadata_send_time_interval"] = values[HEADER_SIZE + 10]
+    data["battery_percentage"] = float32(values[HEADER_SIZE + 11])
+    data["message"] = []
+    return {"data": data}
+
+
+def gps_message(values):
+    """GPSMessageResponse::serialize"""
+    data = header(values)
+    data["type"] = values[HEADER_SIZE]
+    if values[HEADER_SIZE] == GPS_RESPONSE:
+        data.update(gps(values[HEADER_SIZE + 1:HEADER_SIZE + 11]))
+    return {"data": data}
+
+
+def led(values):
+    data = header(values)
+    data["ledCommand"] = values[HEADER_SIZE]
+    return {"data": data}
+
+
+def sim(values):
+    """SimMessage::serialize, the state is a nested array, the payload a binary"""
+    data = header(values)
+    data["simCommand"] = values[HEADER_SIZE]
+
+    if values[HEADER_SIZE] == SIM_MESSAGE:
+        state = values[HEADER_SIZE + 1]
+        data["state"] = dict(zip(["Id", "Type", "QR", "QS", "QRU", "QWRP", "QWSP", "RT", "SSS", "FMA"], state[:10]))
+        data["state"]["packetHeader"] = dict(zip(["Type", "Id", "Size", "Src", "Dst", "Via", "SeqId", "Num"], state[10]))
+    elif values[HEADER_SIZE] == SIM_PAYLOAD:
+        data["packetSize"] = values[HEADER_SIZE + 1]
+        payload = values[HEADER_SIZE + 2]
+        data["payload"] = list(payload) if isinstance(payload, (bytes, bytearray)) else payload
+    return {"data": data}
+
+
+def mon(values):
+    """monOneMessage::serialize"""
+    data = header(values)
+    names = ["RTcount", "uptime", "TxQ", "RxQ", "number_of_neighbors", "routingTableId", "dutyCycleLeft", "deferred",
+             "sensorData"]
+    data.update(zip(names, values[HEADER_SIZE:HEADER_SIZE + 9]))
+    data["gps"] = gps(values[HEADER_SIZE + 9])
+    data["rt"] = [dict(zip(["neighbor", "RxSNR", "SRTT", "metric", "ETX"], route)) for route in values[HEADER_SIZE + 10]]
+    return {"RT": data}
+
+
+DECODERS = {
+    GPS_APP: gps_message,
+    SIM_APP: sim,
+    LED_APP: led,
+    SENSOR_APP: sensor,
+    METADATA_APP: metadata,
+    MON_APP: mon,
+}
+
+
+def to_json(payload):
+    """JSON document of a decoded uplink, None if the appPort of a positional array is unknown"""
+    if isinstance(payload, dict):
+        return payload
+
+    decoder = DECODERS.get(payload[0]) if isinstance(payload, list) and payload else None
+    if decoder is None:
+        return None
+    return decoder(payload)
+
+
+class MsgPackBridge:
+    def __init__(self, host, port):
+        self.decoded = 0
+        self.errors = 0
+
+        self.client = mqtt.Client("MsgPackBridge")
+        self.client.on_connect = self.on_connect
+        self.client.on_message = self.on_message
+        self.client.connect(host, port)
+
+    def on_connect(self, client, userdata, flags, rc):
+        client.subscribe(MQTT_TOPIC_IN + "#", 2)
+        print("Subscribed to " + MQTT_TOPIC_IN + "#")
+
+    def on_message(self, client, userdata, message):
+        address = message.topic[len(MQTT_TOPIC_IN):]
+
+        try:
+            payload = to_json(msgpack.unpackb(message.payload, raw=False, strict_map_key=False))
+        except (msgpack.ExtraData, msgpack.FormatError, ValueError, IndexError, TypeError) as e:
+            self.errors += 1
+            print("Error decoding message from " + address + ": " + str(e))
+            return
+
+        if payload is None:
+            self.errors += 1
+            print("Unknown layout from " + address)
+            return
+
+        body = json.dumps(payload, separators=(",", ":"))
+        client.publish(MQTT_TOPIC_OUT + address, body, 2)
+
+        self.decoded += 1
+        print(
+            "%s: %d bytes -> %d bytes JSON (decoded %d, errors %d)"
+            % (address, len(message.payload), len(body), self.decoded, self.errors)
+        )
+
+    def run(self):
+        self.client.loop_forever()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Republish MessagePack uplinks as JSON")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    args = parser.parse_args()
+
+    MsgPackBridge(args.host, args.port).run()
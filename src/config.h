@@ -73,6 +73,45 @@
 #define DISPLAY_RST -1
 #endif
 
+// Message pool configuration
+#define MESSAGE_POOL_SLOTS 16
+#define MESSAGE_POOL_SLOT_SIZE 256 // Bytes, including the DataMessage header
+// Large slots for the monitor frames, with their neighbors and sensor JSON, and the reassembled fragments
+#define MESSAGE_POOL_LARGE_SLOTS 4
+#define MESSAGE_POOL_LARGE_SLOT_SIZE 1536 // Bytes, a message of LORA_FRAGMENT_MAX_COUNT fragments fits in it
+
+// Duplicate message suppression
+#define DUPLICATE_CACHE_SIZE 64 // Entries, must be a power of 2
+#define DUPLICATE_CACHE_PROBE 8 // Entries checked for every message
+#define DUPLICATE_CACHE_WINDOW 120000 // ms
+#define DUPLICATE_CACHE_MAX_WINDOW 3600000 // ms, the longest window /dupWindow accepts
+
+// Message send workers, one for each port
+#define MESSAGE_SEND_QUEUE_SIZE 10
+#define MESSAGE_SEND_TASK_STACK 6144
+#define MESSAGE_SEND_TASK_PRIORITY 2
+#define MESSAGE_SEND_TASK_CORE 1
+
+// Message expiry, ms a message can wait in the queues for each traffic class, 0 never expires.
+// A measurement is superseded after a few SENSOR_SENDING_EVERY periods, the store and forward log keeps
+// the uplinks while no gateway is reachable
+#define MESSAGE_TTLS {30000, 300000, 60000, 0} // Interactive, sensor, monitor and bulk
+#define MQTT_RECEIVE_TTL 30000 // ms a downlink can wait in the MQTT receive queue
+
+// Store and forward of the uplinks while there is no MQTT connection nor gateway
+#define STORE_FORWARD_ENABLED // Comment to drop them instead
+#define STORE_FORWARD_DIR "/sf" // LittleFS directory of the log
+#define STORE_FORWARD_SEGMENT_SIZE 16384 // Bytes of each log segment
+#define STORE_FORWARD_SEGMENTS 8 // Segments kept, the oldest one is dropped when full
+#define STORE_FORWARD_REPLAY_BATCH 4 // Messages replayed every interval
+#define STORE_FORWARD_REPLAY_INTERVAL 2000 // ms
+#define STORE_FORWARD_TASK_STACK 4096
+
+// Trace configuration
+#define TRACE_ENABLED // Comment to compile out the hot path traces
+#define TRACE_RING_SIZE 128 // Entries kept until they are dumped
+#define TRACE_MAX_ARGS 6
+
 //WiFi Configuration
 #define WIFI_ENABLED
 #define MAX_CONNECTION_TRY 10
@@ -90,7 +129,10 @@
 #define MQTT_PASSWORD "public"
 #define MQTT_TOPIC_SUB "from-server/"
 #define MQTT_TOPIC_OUT "to-server/"
+#define MQTT_TOPIC_OUT_BIN "to-server-bin/" // MessagePack uplinks, decoded by scripts/mqttMsgPackBridge.py
+#define MQTT_DEFAULT_CODEC JsonCodec // JsonCodec or MsgPackCodec, can be changed by appPort with /setCodec
 #define MQTT_MAX_PACKET_SIZE 2048 // 128, 256 or 512
+#define MQTT_JSON_ARENA_SIZE 6144 // Bytes reserved to build the document of a publish
 #define MQTT_MAX_QUEUE_SIZE 10
 #define MQTT_STILL_CONNECTED_INTERVAL 300000 // In milliseconds, 0 to disable
 
@@ -163,6 +205,113 @@
 #define LM_CONFIG_LORASF 7U
 #define LM_CONFIG_POWER 2
 
+#define LM_CONFIG_BANDWIDTH 125000 // Hz
+#define LM_CONFIG_CR 7 // Coding rate 4/7
+#define LM_CONFIG_PREAMBLE 8 // Symbols
+#define LM_CONFIG_HEADER_SIZE 9 // Bytes added by LoRaMesher to every data packet, used to estimate the airtime
+
+// LoRa send scheduler, the classes are interactive, sensor, monitor and bulk
+#define LORA_SCHEDULER_QUEUE_SIZE 8 // Maximum messages of each class
+#define LORA_SCHEDULER_WEIGHTS {8, 4, 2, 1}
+#define LORA_SCHEDULER_LIMITS {8, 6, 4, 4}
+#define LORA_SCHEDULER_QUANTUM 64 // Bytes earned every turn for each unit of weight
+#define LORA_SCHEDULER_RADIO_BACKLOG 1 // Packets waiting in LoRaMesher before holding the next one
+#define LORA_SCHEDULER_POLL_DELAY 100 //ms
+
+// LoRa fragmentation
+#define LORA_FRAGMENT_THRESHOLD 200 // Bigger LoRaMeshMessages are split in fragments
+#define LORA_FRAGMENT_DATA_SIZE 180 // Payload bytes of each fragment
+#define LORA_FRAGMENT_MAX_COUNT 8 // Maximum fragments of a message, at most 32
+#define LORA_FRAGMENT_TX_SLOTS 4 // Messages waiting to be acknowledged
+#define LORA_FRAGMENT_RX_SLOTS 2 // Messages being reassembled
+#define LORA_FRAGMENT_NACK_DELAY 3000 //ms without fragments before asking for the missing ones
+#define LORA_FRAGMENT_RETRY_DELAY 8000 //ms without answer before sending the missing fragments again
+#define LORA_FRAGMENT_RETRIES 3
+#define LORA_FRAGMENT_TIMEOUT 30000 //ms to complete a reassembly
+
+// LoRa windowed reliable delivery
+#define LORA_RELIABLE_WINDOWED // Comment to send the reliable frames with LoRaMesher, one at a time
+#define LORA_RELIABLE_WINDOW 8 // Maximum frames in flight to each destination, at most 32
+#define LORA_RELIABLE_INITIAL_WINDOW 2
+#define LORA_RELIABLE_TX_SLOTS 16 // Frames kept until they are acknowledged
+#define LORA_RELIABLE_FRAME_SIZE 200 // Bigger frames are sent with LoRaMesher
+#define LORA_RELIABLE_PEERS 8 // Destinations and sources tracked
+#define LORA_RELIABLE_RTO 10000 //ms before the first retransmission when the route has no RTT yet
+#define LORA_RELIABLE_MIN_RTO 2000 //ms
+#define LORA_RELIABLE_MAX_RTO 60000 //ms
+#define LORA_RELIABLE_RETRIES 4
+#define LORA_RELIABLE_ACK_EVERY 2 // Frames received in order before they are acknowledged
+#define LORA_RELIABLE_ACK_DELAY 1000 //ms a frame received in order waits to be acknowledged with the next ones
+#define LORA_RELIABLE_PEER_TIMEOUT 600000 //ms without frames before a source is forgotten
+
+// Send a 2 byte LoRa header when both app ports fit in a nibble, every node must support it
+#define LORA_COMPACT_HEADER
+
+// Routing table snapshot shared by the monitor, the display and the commands
+#define LORA_ROUTING_SNAPSHOT_SIZE 64 // Routes kept, neighbors and gateways first, the rest are counted as truncated
+// and their next hop lookups walk the LoRaMesher table. At most 256, RouteRecord keeps the position in 8 bits
+#define LORA_ROUTING_SNAPSHOT_BUFFERS 3
+#define LORA_ROUTING_SNAPSHOT_MAX_AGE 60000 //ms, to refresh the SNR and RTT of unchanged routes
+#define LORA_ROUTING_INDEX_SIZE 128 // Slots of the address index, a power of 2 over 4/3 of the snapshot size
+
+// Gateway selection, cost = hops * HOP + dB under the SNR target * SNR + SRTT / 100 ms * RTT + recent uplinks * LOAD
+// + (ETX of the first hop - 1) * ETX
+#define LORA_GATEWAY_COST_HOP 100
+#define LORA_GATEWAY_COST_SNR 5
+#define LORA_GATEWAY_SNR_TARGET 10 // dB
+#define LORA_GATEWAY_COST_RTT 10
+#define LORA_GATEWAY_COST_LOAD 5
+#define LORA_GATEWAY_COST_ETX 100 // For each expected transmission over 1 on the first hop
+#define LORA_GATEWAY_LOAD_HALF_LIFE 10000 //ms
+#define LORA_GATEWAY_MARGIN 15 // % over the cheapest gateway to share the new flows
+#define LORA_GATEWAY_HYSTERESIS 30 // % over the cheapest gateway a flow tolerates before moving
+#define LORA_GATEWAY_MAX 8 // Gateways tracked
+#define LORA_GATEWAY_FLOWS 16 // Flows kept on their gateway
+
+// LoRa channel plan, only reported by /channelStats: the radio stays on the frequency of LoRaMesher until
+// it can retune per slot. The hopping schedule assumes the nodes share the slot clock
+#define LORA_RENDEZVOUS_FREQUENCY 869.9 // MHz, hellos and broadcasts
+#define LORA_DATA_FREQUENCIES {868.1, 868.3, 868.5, 867.1, 867.3, 867.5, 867.7, 867.9} // MHz
+#define LORA_DATA_CHANNELS 8 // Frequencies in LORA_DATA_FREQUENCIES
+#define LORA_HOPPING_SEED 0x4C6F5261 // Shared by the whole network
+#define LORA_HOPPING_DWELL 10000 //ms of each slot
+#define LORA_HOPPING_RENDEZVOUS 2000 //ms at the start of each slot on the rendezvous channel
+
+// Link quality estimation
+#define LORA_LINK_NEIGHBORS 16
+#define LORA_LINK_SAMPLE_INTERVAL 30000 //ms between routing table samples
+#define LORA_LINK_HELLO_INTERVAL (HELLO_PACKETS_DELAY * 1000) //ms between the hellos of a neighbor
+#define LORA_LINK_HELLO_TOLERANCE 50 // % of the interval a hello can be late before it is counted as lost
+#define LORA_LINK_WEIGHT 0.1 // Weight of a new sample in the delivery ratios
+#define LORA_LINK_MIN_RATIO 0.05 // Lowest delivery ratio used for the ETX
+#define LORA_LINK_TIMEOUT 600000 //ms without hellos nor frames before a neighbor is forgotten
+
+// Adaptive data rate
+#define LORA_ADR_INTERVAL 30000 //ms between routing table samples
+#define LORA_ADR_NEIGHBORS 16
+#define LORA_ADR_NEIGHBOR_TIMEOUT 300000 //ms out of the routing table before a neighbor is forgotten
+#define LORA_ADR_SNR_WEIGHT 0.25 // Weight of a new sample in the SNR average
+#define LORA_ADR_MARGIN 10 // dB over the demodulation floor
+#define LORA_ADR_HYSTERESIS 3 // dB
+#define LORA_ADR_MIN_POWER 2 // dBm
+#define LORA_ADR_MAX_POWER 17 // dBm
+
+// LoRa duty cycle
+#define LORA_DUTY_CYCLE_PERMILLE 10 // Airtime allowed in the window, 10 is the 1% of the EU868 sub-bands
+#define LORA_DUTY_CYCLE_WINDOW 3600000 //ms
+#define LORA_DUTY_CYCLE_BUCKETS 60
+#define LORA_DUTY_CYCLE_DEFER {0, 10, 25, 50} // % of the budget left under which each class is deferred
+#define LORA_DUTY_CYCLE_FRAME 200 // Bytes of the frame assumed when the budget is checked
+
+// LoRa receive batches
+#define LORA_RECEIVE_BATCH 8 // Messages decoded before they are handed to the MessageManager
+#define LORA_RECEIVE_BUDGET 50 //ms of processing before the receive task yields
+
+// LoRa uplink coalescing
+#define LORA_COALESCE_ENABLED // Comment to send every message in its own frame
+#define LORA_COALESCE_MTU 200 // Maximum bytes of a container frame
+#define LORA_COALESCE_WINDOW 2000 //ms a container waits for more messages to the same destination
+
 
 #ifndef LORA_SCK
 #if defined(NAYAD_V1)
@@ -240,6 +389,9 @@
 
 #define PACKET_COUNT 3
 #define PACKET_DELAY 30000
+#define SIM_OFFERED_LOAD 10 // Permille of the airtime offered by each sender, it sets the time between packets
+#define SIM_MAX_BACKLOG 3 // Messages waiting to be sent before the simulation holds the next packet
+#define SIM_BACKLOG_POLL 500 //ms between backlog checks when no message is handed to LoRaMesher
 #define PACKET_SIZE 100
 #define UPLOAD_PAYLOAD 0
 #define LOG_MESHER 0
@@ -4,6 +4,8 @@
 
 #include "message/dataMessage.h"
 
+#include "message/messageSchema.h"
+
 #pragma pack(1)
 
 enum GPSMessageType: uint8_t {
@@ -47,6 +49,23 @@ public:
         doc["timestamp"] = isoTime;
     }
 
+    /**
+     * @brief Array of the fields in declaration order, as in the GPS fields of the schemas
+     */
+    void encode(MsgPackWriter& writer) {
+        writer.writeArray(10);
+        writer.writeDouble(latitude);
+        writer.writeDouble(longitude);
+        writer.writeDouble(altitude);
+        writer.writeUnsigned(satellites);
+        writer.writeUnsigned(hour);
+        writer.writeUnsigned(minute);
+        writer.writeUnsigned(second);
+        writer.writeUnsigned(day);
+        writer.writeUnsigned(month);
+        writer.writeUnsigned(year);
+    }
+
     // String setLeadingZeroes(uint8_t num, bool isHour = false) {
     //     if (!isHour && num == 0)
     //         return "01";
@@ -66,6 +85,32 @@ public:
 class GPSMessageResponse: public GPSMessageGeneric {
 public:
     GPSMessage gps;
+
+    void serialize(JsonObject& doc) {
+        // Call the base class serialize function
+        ((DataMessageGeneric*) (this))->serialize(doc);
+
+        // Add the derived class data to the JSON object
+        doc["type"] = type;
+        gps.serialize(doc);
+    }
 };
 
-#pragma pack()
\ No newline at end of file
+#pragma pack()
+
+MESSAGE_SCHEMA(GPSMessageGeneric,
+    SCHEMA_FIELD(GPSMessageGeneric, type));
+
+// The JSON stays hand-written, the gps object and the ISO timestamp are built by GPSMessage::serialize
+MESSAGE_SCHEMA(GPSMessageResponse,
+    SCHEMA_FIELD(GPSMessageResponse, type),
+    SCHEMA_FIELD(GPSMessageResponse, gps.latitude),
+    SCHEMA_FIELD(GPSMessageResponse, gps.longitude),
+    SCHEMA_FIELD(GPSMessageResponse, gps.altitude),
+    SCHEMA_FIELD(GPSMessageResponse, gps.satellites),
+    SCHEMA_FIELD(GPSMessageResponse, gps.hour),
+    SCHEMA_FIELD(GPSMessageResponse, gps.minute),
+    SCHEMA_FIELD(GPSMessageResponse, gps.second),
+    SCHEMA_FIELD(GPSMessageResponse, gps.day),
+    SCHEMA_FIELD(GPSMessageResponse, gps.month),
+    SCHEMA_FIELD(GPSMessageResponse, gps.year));
\ No newline at end of file
@@ -106,6 +106,21 @@ String GPSService::gpsResponse(messagePort port, DataMessage* message) {
     return "GPS response sent";
 }
 
+void GPSService::serialize(DataMessage* message, JsonDocument& doc) {
+    GPSMessageResponse* gpsMessage = (GPSMessageResponse*) message;
+
+    JsonObject data = doc.createNestedObject("data");
+
+    gpsMessage->serialize(data);
+}
+
+const MessageSchema* GPSService::getSchema(DataMessage* message) {
+    // The requests only carry the type
+    if (message->messageSize > 0 && ((GPSMessageGeneric*) message)->type == GPSMessageType::getGPS)
+        return &GPSMessageResponseSchema;
+    return &GPSMessageGenericSchema;
+}
+
 GPSMessage GPSService::getGPSMessage() {
     getGPSUpdatedWait();
 
@@ -130,7 +145,7 @@ GPSMessageResponse* GPSService::getGPSMessageResponse(DataMessage* message) {
 
     GPSMessageResponse* response = new GPSMessageResponse();
 
-    response->messageSize = sizeof(GPSMessageResponse) - sizeof(DataMessageGeneric);
+    response->messageSize = GPSMessageResponseSchema.payloadSize;
 
     response->appPortDst = message->appPortSrc;
     response->appPortSrc = appPort::GPSApp;
@@ -120,6 +120,10 @@ public:
 
     GPSMessage getGPSMessage();
 
+    void serialize(DataMessage* message, JsonDocument& doc);
+
+    const MessageSchema* getSchema(DataMessage* message);
+
 private:
 
     GPSService(): MessageService(appPort::GPSApp, String("GPS")) {
@@ -0,0 +1,74 @@
+#include "traceLog.h"
+
+static_assert(TRACE_MAX_ARGS == 6, "TraceLog::dump formats exactly 6 arguments");
+
+void TraceLog::push(const char* format, const uintptr_t* args) {
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&traceMux);
+
+    Entry& entry = entries[(head + count) % TRACE_RING_SIZE];
+    if (count == TRACE_RING_SIZE) {
+        head = (head + 1) % TRACE_RING_SIZE;
+        overwritten++;
+    }
+    else {
+        count++;
+    }
+
+    entry.format = format;
+    entry.timestamp = now;
+    memcpy(entry.args, args, sizeof(entry.args));
+    added++;
+
+    portEXIT_CRITICAL(&traceMux);
+}
+
+String TraceLog::dump(bool clear) {
+    String result = "";
+    char line[160];
+
+    size_t pending;
+    size_t index;
+    portENTER_CRITICAL(&traceMux);
+    pending = count;
+    index = head;
+    portEXIT_CRITICAL(&traceMux);
+
+    for (size_t i = 0; i < pending; i++) {
+        Entry entry;
+        portENTER_CRITICAL(&traceMux);
+        entry = entries[(index + i) % TRACE_RING_SIZE];
+        portEXIT_CRITICAL(&traceMux);
+
+        int length = snprintf(line, sizeof(line), "[%u] ", entry.timestamp);
+        snprintf(line + length, sizeof(line) - length, entry.format,
+            entry.args[0], entry.args[1], entry.args[2], entry.args[3], entry.args[4], entry.args[5]);
+
+        result += line;
+        result += "\n";
+    }
+
+    if (clear) {
+        // Entries added while formatting are kept, unless they overwrote the ones dumped
+        portENTER_CRITICAL(&traceMux);
+        size_t dumped = pending < count ? pending : count;
+        head = (head + dumped) % TRACE_RING_SIZE;
+        count -= dumped;
+        portEXIT_CRITICAL(&traceMux);
+    }
+
+    return result;
+}
+
+void TraceLog::clear() {
+    portENTER_CRITICAL(&traceMux);
+    head = 0;
+    count = 0;
+    portEXIT_CRITICAL(&traceMux);
+}
+
+String TraceLog::getStats() {
+    return "Trace entries: " + String(count) + "/" + String(TRACE_RING_SIZE) +
+        ", added " + String(added) + ", overwritten " + String(overwritten) + "\n";
+}
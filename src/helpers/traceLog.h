@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+/**
+ * @brief Binary trace of the hot paths, formatted only when it is dumped
+ *
+ * Every entry stores the pointer to its format string, which works as its ID, the timestamp and up to
+ * TRACE_MAX_ARGS raw arguments. Formatting happens in dump(), over serial (/trace) or MQTT.
+ * Arguments must be integers or string literals, their values are read when the trace is dumped.
+ * When the ring is full the oldest entries are overwritten.
+ *
+ * Use the TRACE macro, without TRACE_ENABLED it compiles to nothing.
+ */
+class TraceLog {
+public:
+    static TraceLog& getInstance() {
+        static TraceLog instance;
+        return instance;
+    }
+
+    template<typename... Args>
+    void add(const char* format, Args... args) {
+        static_assert(sizeof...(Args) <= TRACE_MAX_ARGS, "Too many trace arguments");
+        uintptr_t values[TRACE_MAX_ARGS] = {(uintptr_t) args...};
+        push(format, values);
+    }
+
+    /**
+     * @brief Format the entries from the oldest to the newest
+     *
+     * @param clear Remove the entries dumped
+     * @return String One line per entry
+     */
+    String dump(bool clear = true);
+
+    void clear();
+
+    String getStats();
+
+private:
+    TraceLog() {};
+
+    struct Entry {
+        const char* format;
+        uint32_t timestamp;
+        uintptr_t args[TRACE_MAX_ARGS];
+    };
+
+    Entry entries[TRACE_RING_SIZE];
+
+    size_t head = 0;
+    size_t count = 0;
+
+    uint32_t added = 0;
+    uint32_t overwritten = 0;
+
+    portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void push(const char* format, const uintptr_t* args);
+};
+
+#ifdef TRACE_ENABLED
+#define TRACE(format, ...) TraceLog::getInstance().add(format, ##__VA_ARGS__)
+#else
+#define TRACE(format, ...) do {} while (0)
+#endif
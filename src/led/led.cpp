@@ -69,35 +69,10 @@ String Led::ledBlink() {
     return "Led Blink";
 }
 
-String Led::getJSON(DataMessage* message) {
-    LedMessage* ledMessage = (LedMessage*) message;
-
-    StaticJsonDocument<200> doc;
-
-    JsonObject data = doc.createNestedObject("data");
-
-    ledMessage->serialize(data);
-
-    String json;
-    serializeJson(doc, json);
-
-    return json;
-}
-
-DataMessage* Led::getDataMessage(JsonObject data) {
-    LedMessage* ledMessage = new LedMessage();
-
-    ledMessage->deserialize(data);
-
-    ledMessage->messageSize = sizeof(LedMessage) - sizeof(DataMessageGeneric);
-
-    return ((DataMessage*) ledMessage);
-}
-
 DataMessage* Led::getLedMessage(LedCommand command, uint16_t dst) {
     LedMessage* ledMessage = new LedMessage();
 
-    ledMessage->messageSize = sizeof(LedMessage) - sizeof(DataMessageGeneric);
+    ledMessage->messageSize = LedMessageSchema.payloadSize;
 
     ledMessage->ledCommand = command;
 
@@ -106,6 +81,7 @@ DataMessage* Led::getLedMessage(LedCommand command, uint16_t dst) {
 
     ledMessage->addrSrc = LoraMesher::getInstance().getLocalAddress();
     ledMessage->addrDst = dst;
+    ledMessage->messageId = ledMessageId++;
 
     return (DataMessage*) ledMessage;
 }
@@ -26,13 +26,13 @@ public:
     String ledOff();
     String ledOff(uint16_t dst);
     String ledBlink();
-    String getJSON(DataMessage* message);
-    DataMessage* getDataMessage(JsonObject data);
     DataMessage* getLedMessage(LedCommand command, uint16_t dst);
     void processReceivedMessage(messagePort port, DataMessage* message);
 private:
     Led(): MessageService(LedApp, "Led") {
         commandService = ledCommandService;
+        schema = &LedMessageSchema;
     };
     uint8_t state = 0;
+    uint8_t ledMessageId = 0;
 };
@@ -4,6 +4,8 @@
 
 #include "message/dataMessage.h"
 
+#include "message/messageSchema.h"
+
 #pragma pack(1)
 
 enum LedCommand: uint8_t {
@@ -14,21 +16,8 @@ enum LedCommand: uint8_t {
 class LedMessage: public DataMessageGeneric {
 public:
     LedCommand ledCommand;
-
-    void serialize(JsonObject& doc) {
-        // Call the base class serialize function
-        ((DataMessageGeneric*) (this))->serialize(doc);
-
-        // Add the derived class data to the JSON object
-        doc["ledCommand"] = ledCommand;
-    }
-
-    void deserialize(JsonObject& doc) {
-        // Call the base class deserialize function
-        ((DataMessageGeneric*) (this))->deserialize(doc);
-
-        // Add the derived class data to the JSON object
-        ledCommand = doc["ledCommand"];
-    }
 };
-#pragma pack()
\ No newline at end of file
+#pragma pack()
+
+MESSAGE_SCHEMA(LedMessage,
+    SCHEMA_FIELD(LedMessage, ledCommand));
\ No newline at end of file
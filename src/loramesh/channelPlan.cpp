@@ -0,0 +1,67 @@
+#include "channelPlan.h"
+
+static const float dataFrequencies[] = LORA_DATA_FREQUENCIES;
+
+static_assert(sizeof(dataFrequencies) / sizeof(dataFrequencies[0]) == LORA_DATA_CHANNELS,
+    "LORA_DATA_CHANNELS must match LORA_DATA_FREQUENCIES");
+
+uint8_t ChannelPlan::getHomeChannel(uint16_t address, uint32_t slot) {
+    // scripts/channelHoppingSim.py uses the same hash, keep them equal
+    return 1 + mix(LORA_HOPPING_SEED ^ ((uint32_t) address << 16) ^ mix(slot)) % LORA_DATA_CHANNELS;
+}
+
+float ChannelPlan::getFrequency(uint8_t channel) {
+    if (channel == RENDEZVOUS_CHANNEL || channel > LORA_DATA_CHANNELS)
+        return LORA_RENDEZVOUS_FREQUENCY;
+    return dataFrequencies[channel - 1];
+}
+
+uint8_t ChannelPlan::getChannel(uint16_t nextHop) {
+    if (nextHop == BROADCAST_ADDR || nextHop == 0 || isRendezvous())
+        return RENDEZVOUS_CHANNEL;
+    return getHomeChannel(nextHop, getSlot());
+}
+
+void ChannelPlan::account(uint16_t nextHop, uint32_t airtime) {
+    uint8_t channel = getChannel(nextHop);
+
+    portENTER_CRITICAL(&channelMux);
+    load[channel].frames++;
+    load[channel].airtime += airtime;
+    portEXIT_CRITICAL(&channelMux);
+}
+
+String ChannelPlan::getStats(uint16_t localAddress, const RoutingTableSnapshot* routingTable) {
+    uint32_t slot = getSlot();
+    String stats = "Slot " + String(slot) + (isRendezvous() ? " (rendezvous)" : "") +
+        ", home channel " + String(getHomeChannel(localAddress, slot)) + "\n";
+
+    for (uint16_t i = 0; i < routingTable->size; i++) {
+        const RouteNode& route = routingTable->routes[i];
+        if (route.networkNode.address != route.via)
+            continue;
+
+        uint8_t channel = getHomeChannel(route.via, slot);
+        stats += "Neighbor " + String(route.via, HEX) + ": channel " + String(channel) +
+            " (" + String(getFrequency(channel), 1) + " MHz)\n";
+    }
+
+    for (uint8_t channel = 0; channel <= LORA_DATA_CHANNELS; channel++) {
+        portENTER_CRITICAL(&channelMux);
+        ChannelLoad channelLoad = load[channel];
+        portEXIT_CRITICAL(&channelMux);
+
+        stats += "Channel " + String(channel) + " " + String(getFrequency(channel), 1) + " MHz: " +
+            String(channelLoad.frames) + " frames, " + String((uint32_t) (channelLoad.airtime / 1000)) + " ms\n";
+    }
+    return stats;
+}
+
+uint32_t ChannelPlan::mix(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x7FEB352Du;
+    value ^= value >> 15;
+    value *= 0x846CA68Bu;
+    value ^= value >> 16;
+    return value;
+}
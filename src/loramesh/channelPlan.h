@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "routingSnapshot.h"
+
+/**
+ * @brief Deterministic channel hopping schedule shared by all the nodes
+ *
+ * Time is split in slots of LORA_HOPPING_DWELL. Every slot starts with LORA_HOPPING_RENDEZVOUS on the
+ * rendezvous channel, where the hellos and the broadcasts are sent. The rest of the slot each node listens
+ * on its home channel, a hash of the shared seed, its address and the slot, and the data to a neighbor is
+ * sent on the home channel of the neighbor, so each link uses its own channel and hops with the slot.
+ * Channel 0 is the rendezvous channel, 1 to LORA_DATA_CHANNELS the data channels.
+ * The slots are counted on millis() plus an offset, the nodes must share that clock to meet.
+ * The radio is not retuned: the plan only counts the frames on the channel they would use, and the
+ * frequencies are not passed to LoRaMesher.
+ */
+class ChannelPlan {
+public:
+    static const uint8_t RENDEZVOUS_CHANNEL = 0;
+
+    /**
+     * @brief Home channel of a node in a slot, the same in every node with the same seed
+     *
+     * @return uint8_t From 1 to LORA_DATA_CHANNELS
+     */
+    static uint8_t getHomeChannel(uint16_t address, uint32_t slot);
+
+    static float getFrequency(uint8_t channel);
+
+    /**
+     * @brief Channel of a frame sent now to a next hop
+     *
+     * @param nextHop Next hop, BROADCAST_ADDR for the rendezvous channel
+     */
+    uint8_t getChannel(uint16_t nextHop);
+
+    uint32_t getSlot() {
+        return (millis() + clockOffset) / LORA_HOPPING_DWELL;
+    }
+
+    bool isRendezvous() {
+        return (millis() + clockOffset) % LORA_HOPPING_DWELL < LORA_HOPPING_RENDEZVOUS;
+    }
+
+    /**
+     * @brief Align the slot clock with the other nodes
+     *
+     * @param offset ms added to millis()
+     */
+    void setClockOffset(int32_t offset) {
+        clockOffset = offset;
+    }
+
+    /**
+     * @brief Account a frame on the channel the plan gives it
+     *
+     * @param nextHop Next hop, BROADCAST_ADDR for the rendezvous channel
+     * @param airtime Time on air, us
+     */
+    void account(uint16_t nextHop, uint32_t airtime);
+
+    /**
+     * @brief Current slot, home channels of this node and its neighbors, and the load of each channel
+     *
+     * @param localAddress Address of this node
+     * @param routingTable Snapshot of the routing table
+     */
+    String getStats(uint16_t localAddress, const RoutingTableSnapshot* routingTable);
+
+private:
+    struct ChannelLoad {
+        uint32_t frames;
+        uint64_t airtime; //us
+    };
+
+    ChannelLoad load[LORA_DATA_CHANNELS + 1] = {};
+
+    int32_t clockOffset = 0;
+
+    portMUX_TYPE channelMux = portMUX_INITIALIZER_UNLOCKED;
+
+    static uint32_t mix(uint32_t value);
+};
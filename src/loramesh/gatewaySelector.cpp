@@ -0,0 +1,163 @@
+#include "gatewaySelector.h"
+
+#include "loraMeshService.h"
+
+#define LORA_GATEWAY_LOAD_UNIT 16
+
+uint16_t GatewaySelector::select(DataMessage* message, const RoutingTableSnapshot* routingTable) {
+    struct Candidate {
+        uint16_t address;
+        uint32_t cost;
+    };
+
+    Candidate candidates[LORA_GATEWAY_MAX];
+    uint8_t count = 0;
+
+    for (uint16_t i = 0; i < routingTable->size && count < LORA_GATEWAY_MAX; i++) {
+        const RouteNode& route = routingTable->routes[i];
+        if ((route.networkNode.role & ROLE_GATEWAY) != ROLE_GATEWAY)
+            continue;
+
+        candidates[count].address = route.networkNode.address;
+        candidates[count].cost = getRouteCost(route);
+        count++;
+    }
+
+    if (count == 0)
+        return 0;
+
+    uint32_t now = millis();
+    uint32_t key = ((uint32_t) message->addrSrc << 8) | message->appPortSrc;
+
+    portENTER_CRITICAL(&selectorMux);
+
+    decayLoads(now);
+
+    uint32_t bestCost = UINT32_MAX;
+    for (uint8_t i = 0; i < count; i++) {
+        Gateway* gateway = getGateway(candidates[i].address, now);
+        candidates[i].cost += (uint32_t) gateway->load * LORA_GATEWAY_COST_LOAD / LORA_GATEWAY_LOAD_UNIT;
+        gateway->cost = candidates[i].cost;
+        if (candidates[i].cost < bestCost)
+            bestCost = candidates[i].cost;
+    }
+
+    Flow* flow = getFlow(key, now);
+
+    //Keep the flow on its gateway while it is not much worse than the best one
+    uint16_t chosen = 0;
+    if (flow->gateway != 0) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (candidates[i].address == flow->gateway &&
+                candidates[i].cost * 100 <= bestCost * (100 + LORA_GATEWAY_HYSTERESIS)) {
+                chosen = flow->gateway;
+                break;
+            }
+        }
+    }
+
+    if (chosen == 0) {
+        //Spread the flows over the near-equal gateways, the hash keeps the choice stable
+        uint8_t nearEqual = 0;
+        for (uint8_t i = 0; i < count; i++)
+            if (candidates[i].cost * 100 <= bestCost * (100 + LORA_GATEWAY_MARGIN))
+                nearEqual++;
+
+        uint8_t pick = (key * 2654435769u >> 24) % nearEqual;
+        for (uint8_t i = 0; i < count; i++) {
+            if (candidates[i].cost * 100 > bestCost * (100 + LORA_GATEWAY_MARGIN))
+                continue;
+            if (pick-- == 0) {
+                chosen = candidates[i].address;
+                break;
+            }
+        }
+
+        if (nearEqual > 1)
+            spread++;
+        if (flow->gateway != 0 && flow->gateway != chosen)
+            flowSwitches++;
+        flow->gateway = chosen;
+    }
+
+    Gateway* gateway = getGateway(chosen, now);
+    gateway->load += LORA_GATEWAY_LOAD_UNIT;
+    gateway->selected++;
+    decisions++;
+
+    portEXIT_CRITICAL(&selectorMux);
+
+    return chosen;
+}
+
+String GatewaySelector::getStats() {
+    String stats = "Gateway decisions: " + String(decisions) + ", spread " + String(spread) +
+        ", flow switches " + String(flowSwitches) + "\n";
+
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < LORA_GATEWAY_MAX; i++) {
+        Gateway& gateway = gateways[i];
+        if (gateway.address == 0)
+            continue;
+
+        stats += String(gateway.address, HEX) + ": cost " + String(gateway.cost) +
+            ", load " + String((float) gateway.load / LORA_GATEWAY_LOAD_UNIT, 1) +
+            ", selected " + String(gateway.selected) + ", seen " + String((now - gateway.lastSeen) / 1000) + " s ago\n";
+    }
+    return stats;
+}
+
+uint32_t GatewaySelector::getRouteCost(const RouteNode& route) {
+    uint32_t cost = (uint32_t) route.networkNode.metric * LORA_GATEWAY_COST_HOP;
+
+    if (route.receivedSNR < LORA_GATEWAY_SNR_TARGET)
+        cost += (uint32_t) (LORA_GATEWAY_SNR_TARGET - route.receivedSNR) * LORA_GATEWAY_COST_SNR;
+
+    cost += route.SRTT / 100 * LORA_GATEWAY_COST_RTT;
+
+    // A lossy first hop costs its retransmissions, even with a good SNR
+    uint16_t etx = LoRaMeshService::getInstance().getLinkEtx(route.via);
+    cost += (uint32_t) (etx - 100) * LORA_GATEWAY_COST_ETX / 100;
+
+    return cost;
+}
+
+GatewaySelector::Gateway* GatewaySelector::getGateway(uint16_t address, uint32_t now) {
+    Gateway* oldest = &gateways[0];
+    for (uint8_t i = 0; i < LORA_GATEWAY_MAX; i++) {
+        if (gateways[i].address == address) {
+            gateways[i].lastSeen = now;
+            return &gateways[i];
+        }
+        if (gateways[i].address == 0 || now - gateways[i].lastSeen > now - oldest->lastSeen)
+            oldest = &gateways[i];
+    }
+
+    *oldest = {address, 0, 0, 0, now};
+    return oldest;
+}
+
+GatewaySelector::Flow* GatewaySelector::getFlow(uint32_t key, uint32_t now) {
+    Flow* oldest = &flows[0];
+    for (uint8_t i = 0; i < LORA_GATEWAY_FLOWS; i++) {
+        if (flows[i].gateway != 0 && flows[i].key == key) {
+            flows[i].lastUsed = now;
+            return &flows[i];
+        }
+        if (flows[i].gateway == 0 || now - flows[i].lastUsed > now - oldest->lastUsed)
+            oldest = &flows[i];
+    }
+
+    *oldest = {key, 0, now};
+    return oldest;
+}
+
+void GatewaySelector::decayLoads(uint32_t now) {
+    uint32_t halvings = (now - lastDecay) / LORA_GATEWAY_LOAD_HALF_LIFE;
+    if (halvings == 0)
+        return;
+
+    lastDecay += halvings * LORA_GATEWAY_LOAD_HALF_LIFE;
+    for (uint8_t i = 0; i < LORA_GATEWAY_MAX; i++)
+        gateways[i].load = halvings >= 16 ? 0 : gateways[i].load >> halvings;
+}
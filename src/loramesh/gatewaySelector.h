@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "message/dataMessage.h"
+
+#include "routingSnapshot.h"
+
+/**
+ * @brief Chooses the gateway of each uplink among all the gateways of the routing table
+ *
+ * Every gateway gets a cost from its hops, the SNR and the SRTT of its route, the ETX of its first
+ * hop, and the uplinks this node sent to it recently, which stands for its queue depth since
+ * LoRaMesher does not advertise it. A flow (source address and port) stays on its gateway until another one is cheaper by more
+ * than LORA_GATEWAY_HYSTERESIS percent. New flows are spread over the gateways within
+ * LORA_GATEWAY_MARGIN percent of the cheapest one.
+ */
+class GatewaySelector {
+public:
+    /**
+     * @brief Choose the gateway of a message
+     *
+     * @param message Message, only its source is used
+     * @param routingTable Routing table
+     * @return uint16_t Gateway address, 0 if there is none
+     */
+    uint16_t select(DataMessage* message, const RoutingTableSnapshot* routingTable);
+
+    String getStats();
+
+private:
+    struct Gateway {
+        uint16_t address;
+        uint16_t load; //Uplinks sent recently, 1/16 units
+        uint32_t cost;
+        uint32_t selected;
+        uint32_t lastSeen;
+    };
+
+    struct Flow {
+        uint32_t key;
+        uint16_t gateway;
+        uint32_t lastUsed;
+    };
+
+    Gateway gateways[LORA_GATEWAY_MAX] = {};
+
+    Flow flows[LORA_GATEWAY_FLOWS] = {};
+
+    uint32_t lastDecay = 0;
+
+    uint32_t decisions = 0;
+    uint32_t flowSwitches = 0;
+    uint32_t spread = 0;
+
+    portMUX_TYPE selectorMux = portMUX_INITIALIZER_UNLOCKED;
+
+    static uint32_t getRouteCost(const RouteNode& route);
+
+    Gateway* getGateway(uint16_t address, uint32_t now);
+
+    Flow* getFlow(uint32_t key, uint32_t now);
+
+    void decayLoads(uint32_t now);
+};
@@ -0,0 +1,132 @@
+#include "linkEstimator.h"
+
+void LinkEstimator::sample(const RoutingTableSnapshot* routingTable) {
+    uint32_t now = millis();
+    lastSample = now;
+
+    // A hello can come late, but every interval without one is a loss
+    uint32_t late = (uint32_t) LORA_LINK_HELLO_INTERVAL * (100 + LORA_LINK_HELLO_TOLERANCE) / 100;
+
+    portENTER_CRITICAL(&linkMux);
+    for (uint16_t i = 0; i < routingTable->size; i++) {
+        const RouteNode& route = routingTable->routes[i];
+        if (route.networkNode.address != route.via)
+            continue;
+
+        Link* link = getLink(route.via, true);
+        if (link->lastTimeout == 0) {
+            link->lastTimeout = route.timeout;
+            link->lastHello = now;
+            link->lastSeen = now;
+            continue;
+        }
+
+        if (route.timeout != link->lastTimeout) {
+            update(link->reverse, link->reverseSamples, 1);
+            link->lastTimeout = route.timeout;
+            link->lastHello = now;
+            link->lastSeen = now;
+            continue;
+        }
+
+        while (now - link->lastHello > late) {
+            update(link->reverse, link->reverseSamples, 0);
+            link->lastHello += LORA_LINK_HELLO_INTERVAL;
+        }
+    }
+    portEXIT_CRITICAL(&linkMux);
+}
+
+void LinkEstimator::recordReception(uint16_t neighbor, uint8_t received, uint8_t lost) {
+    portENTER_CRITICAL(&linkMux);
+    Link* link = getLink(neighbor, true);
+    for (uint8_t i = 0; i < lost; i++)
+        update(link->reverse, link->reverseSamples, 0);
+    for (uint8_t i = 0; i < received; i++)
+        update(link->reverse, link->reverseSamples, 1);
+    link->lastSeen = millis();
+    portEXIT_CRITICAL(&linkMux);
+}
+
+void LinkEstimator::recordDelivery(uint16_t neighbor, uint8_t transmissions, bool delivered) {
+    portENTER_CRITICAL(&linkMux);
+    Link* link = getLink(neighbor, true);
+    update(link->forward, link->forwardSamples, delivered ? 1.0f / transmissions : 0);
+    link->lastSeen = millis();
+    portEXIT_CRITICAL(&linkMux);
+}
+
+uint16_t LinkEstimator::getEtx(uint16_t neighbor) {
+    portENTER_CRITICAL(&linkMux);
+    Link* link = getLink(neighbor, false);
+    uint16_t etx = link ? getEtx(*link) : 100;
+    portEXIT_CRITICAL(&linkMux);
+    return etx;
+}
+
+String LinkEstimator::getStats() {
+    String stats = "";
+    for (uint8_t i = 0; i < LORA_LINK_NEIGHBORS; i++) {
+        portENTER_CRITICAL(&linkMux);
+        Link link = links[i];
+        portEXIT_CRITICAL(&linkMux);
+
+        if (link.address == 0)
+            continue;
+
+        stats += String(link.address, HEX) + ": ETX " + String(getEtx(link) / 100.0, 2) +
+            ", reverse " + String(link.reverse * 100, 0) + "% (" + String(link.reverseSamples) + ")" +
+            ", forward " + String(link.forward * 100, 0) + "% (" + String(link.forwardSamples) + ")\n";
+    }
+    return stats.length() > 0 ? stats : "No neighbors\n";
+}
+
+LinkEstimator::Link* LinkEstimator::getLink(uint16_t address, bool create) {
+    uint32_t now = millis();
+    Link* candidate = nullptr;
+    for (uint8_t i = 0; i < LORA_LINK_NEIGHBORS; i++) {
+        Link& link = links[i];
+        if (link.address == address) {
+            if (now - link.lastSeen <= LORA_LINK_TIMEOUT)
+                return &link;
+
+            // Nothing heard for too long, start again
+            candidate = &link;
+            break;
+        }
+
+        // Reuse an empty slot, else the neighbor seen least recently
+        if (!candidate || (candidate->address != 0 && (link.address == 0 || now - link.lastSeen > now - candidate->lastSeen)))
+            candidate = &link;
+    }
+
+    if (!create)
+        return nullptr;
+
+    *candidate = {};
+    candidate->address = address;
+    candidate->lastSeen = now;
+    return candidate;
+}
+
+void LinkEstimator::update(float& ratio, uint16_t& samples, float value) {
+    // Plain average of the first samples, so a new neighbor converges fast
+    float weight = 1.0f / (samples + 1);
+    if (weight < LORA_LINK_WEIGHT)
+        weight = LORA_LINK_WEIGHT;
+
+    ratio += weight * (value - ratio);
+    if (samples < UINT16_MAX)
+        samples++;
+}
+
+uint16_t LinkEstimator::getEtx(const Link& link) {
+    float forward = link.forwardSamples > 0 ? link.forward : 1;
+    float reverse = link.reverseSamples > 0 ? link.reverse : 1;
+    if (forward < LORA_LINK_MIN_RATIO)
+        forward = LORA_LINK_MIN_RATIO;
+    if (reverse < LORA_LINK_MIN_RATIO)
+        reverse = LORA_LINK_MIN_RATIO;
+
+    return 100 / (forward * reverse);
+}
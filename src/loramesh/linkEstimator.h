@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "routingSnapshot.h"
+
+/**
+ * @brief Delivery ratio and expected transmission count (ETX) of each neighbor
+ *
+ * The reverse ratio, from the neighbor to this node, comes from its hello packets: a refresh of the
+ * timeout of its route is a hello received, an interval without one is a hello lost. The reliable frames
+ * received from the neighbor add a success for each frame and a loss for each sequence number skipped.
+ * The forward ratio comes from the reliable frames sent through the neighbor: 1 / transmissions when a
+ * frame is acknowledged, 0 when it is given up.
+ * Both are EWMAs in a fixed table, ETX = 1 / (forward * reverse).
+ */
+class LinkEstimator {
+public:
+    bool isSampleDue() {
+        return millis() - lastSample >= LORA_LINK_SAMPLE_INTERVAL;
+    }
+
+    /**
+     * @brief Look for the hellos received from the neighbors since the last sample
+     *
+     * @param routingTable Snapshot of the routing table
+     */
+    void sample(const RoutingTableSnapshot* routingTable);
+
+    /**
+     * @brief Account frames received from a neighbor
+     *
+     * @param neighbor Neighbor
+     * @param received Frames received
+     * @param lost Frames that did not arrive
+     */
+    void recordReception(uint16_t neighbor, uint8_t received, uint8_t lost);
+
+    /**
+     * @brief Account the outcome of a frame sent through a neighbor
+     *
+     * @param neighbor Next hop
+     * @param transmissions Times it has been sent
+     * @param delivered If it has been acknowledged
+     */
+    void recordDelivery(uint16_t neighbor, uint8_t transmissions, bool delivered);
+
+    /**
+     * @brief Expected transmissions to deliver a frame to the neighbor
+     *
+     * @return uint16_t ETX * 100, 100 for an unknown neighbor
+     */
+    uint16_t getEtx(uint16_t neighbor);
+
+    String getStats();
+
+private:
+    struct Link {
+        uint16_t address;
+        float forward;
+        float reverse;
+        uint16_t forwardSamples;
+        uint16_t reverseSamples;
+        uint32_t lastTimeout;
+        uint32_t lastHello;
+        uint32_t lastSeen;
+    };
+
+    Link links[LORA_LINK_NEIGHBORS] = {};
+
+    uint32_t lastSample = 0;
+
+    portMUX_TYPE linkMux = portMUX_INITIALIZER_UNLOCKED;
+
+    Link* getLink(uint16_t address, bool create);
+
+    static void update(float& ratio, uint16_t& samples, float value);
+
+    static uint16_t getEtx(const Link& link);
+};
@@ -0,0 +1,194 @@
+#include "loraAdr.h"
+
+#include "loraAirtime.h"
+
+static const char* ADR_TAG = "LoRaAdr";
+
+// SNR in dB under which a SX127x cannot demodulate, from SF7 to SF12
+static const float demodulationFloor[] = {-7.5, -10, -12.5, -15, -17.5, -20};
+
+void LoRaAdr::begin(uint8_t radioSF, int8_t radioPower) {
+    sf = radioSF;
+    power = radioPower;
+    ESP_LOGI(ADR_TAG, "Radio at SF%d, %d dBm", sf, power);
+}
+
+void LoRaAdr::sample(const RoutingTableSnapshot* routingTable) {
+    uint32_t now = millis();
+    lastSample = now;
+
+    portENTER_CRITICAL(&adrMux);
+    for (uint16_t i = 0; i < routingTable->size; i++) {
+        const RouteNode& route = routingTable->routes[i];
+        if (route.networkNode.address != route.via)
+            continue;
+
+        // The sent SNR is how the neighbor hears this node, 0 until it has reported it
+        int8_t snr = route.receivedSNR;
+        if (route.sentSNR != 0 && route.sentSNR < snr)
+            snr = route.sentSNR;
+
+        Neighbor* neighbor = getNeighbor(route.via, now);
+        if (neighbor)
+            update(*neighbor, snr);
+    }
+
+    for (uint8_t i = 0; i < LORA_ADR_NEIGHBORS; i++)
+        if (neighbors[i].samples > 0 && now - neighbors[i].lastSeen > LORA_ADR_NEIGHBOR_TIMEOUT)
+            neighbors[i].samples = 0;
+    portEXIT_CRITICAL(&adrMux);
+}
+
+void LoRaAdr::account(uint16_t via, size_t frameSize) {
+    uint8_t adaptedSF = sf;
+    uint32_t frameAirtime = LoRaAirtime::getTimeOnAir(frameSize + LM_CONFIG_HEADER_SIZE, sf);
+
+    portENTER_CRITICAL(&adrMux);
+    if (via == BROADCAST_ADDR) {
+        adaptedSF = getSlowestSF();
+    }
+    else {
+        for (uint8_t i = 0; i < LORA_ADR_NEIGHBORS; i++) {
+            if (neighbors[i].samples > 0 && neighbors[i].address == via) {
+                adaptedSF = neighbors[i].sf;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&adrMux);
+
+    uint32_t adaptedFrameAirtime = LoRaAirtime::getTimeOnAir(frameSize + LM_CONFIG_HEADER_SIZE, adaptedSF);
+
+    // Sent from the send and the receive tasks, the 64-bit sums are not updated atomically
+    portENTER_CRITICAL(&adrMux);
+    airtime += frameAirtime;
+    adaptedAirtime += adaptedFrameAirtime;
+    portEXIT_CRITICAL(&adrMux);
+}
+
+int8_t LoRaAdr::getNodePower() {
+    int8_t nodePower = LORA_ADR_MIN_POWER;
+    bool found = false;
+
+    portENTER_CRITICAL(&adrMux);
+    for (uint8_t i = 0; i < LORA_ADR_NEIGHBORS; i++) {
+        if (neighbors[i].samples == 0)
+            continue;
+
+        int8_t neighborPower = getPowerFor(neighbors[i].snr, sf);
+        if (neighborPower > nodePower)
+            nodePower = neighborPower;
+        found = true;
+    }
+    portEXIT_CRITICAL(&adrMux);
+
+    return found ? nodePower : power;
+}
+
+String LoRaAdr::getStats() {
+    // Copied under the lock, the radio task updates them while the stats are formatted
+    Neighbor entries[LORA_ADR_NEIGHBORS];
+    portENTER_CRITICAL(&adrMux);
+    uint64_t totalAirtime = airtime;
+    uint64_t totalAdaptedAirtime = adaptedAirtime;
+    uint32_t changes = sfChanges;
+    uint8_t slowestSF = getSlowestSF();
+    memcpy(entries, neighbors, sizeof(entries));
+    portEXIT_CRITICAL(&adrMux);
+
+    uint32_t airtimeMs = totalAirtime / 1000;
+    uint32_t adaptedMs = totalAdaptedAirtime / 1000;
+    // Negative when the per-link SFs are slower than the radio SF, the broadcasts go at the slowest one
+    int32_t saved = totalAirtime > 0 ?
+        ((int64_t) totalAirtime - (int64_t) totalAdaptedAirtime) * 100 / (int64_t) totalAirtime : 0;
+
+    String stats = "Radio SF" + String(sf) + ", " + String(power) + " dBm, node power needed " +
+        String(getNodePower()) + " dBm, network SF" + String(slowestSF) + "\n";
+
+    uint32_t now = millis();
+    for (const Neighbor& neighbor : entries) {
+        if (neighbor.samples == 0)
+            continue;
+
+        stats += String(neighbor.address, HEX) + ": SNR " + String(neighbor.snr, 1) + " dB, SF" + String(neighbor.sf) +
+            " at " + String(neighbor.power) + " dBm, " + String(neighbor.samples) + " samples, seen " +
+            String((now - neighbor.lastSeen) / 1000) + " s ago\n";
+    }
+
+    stats += "Airtime: " + String(airtimeMs) + " ms at SF" + String(sf) + ", " + String(adaptedMs) +
+        " ms with per-link SF, " + String(saved) + "% saved, " + String(changes) + " SF changes\n";
+    return stats;
+}
+
+LoRaAdr::Neighbor* LoRaAdr::getNeighbor(uint16_t address, uint32_t now) {
+    Neighbor* oldest = nullptr;
+    for (uint8_t i = 0; i < LORA_ADR_NEIGHBORS; i++) {
+        if (neighbors[i].samples > 0 && neighbors[i].address == address) {
+            neighbors[i].lastSeen = now;
+            return &neighbors[i];
+        }
+        if (!oldest || neighbors[i].samples == 0 ||
+            (oldest->samples > 0 && now - neighbors[i].lastSeen > now - oldest->lastSeen))
+            oldest = &neighbors[i];
+    }
+
+    *oldest = {address, 0, sf, power, 0, now};
+    return oldest;
+}
+
+void LoRaAdr::update(Neighbor& neighbor, int8_t snrSample) {
+    if (neighbor.samples == 0)
+        neighbor.snr = snrSample;
+    else
+        neighbor.snr += (snrSample - neighbor.snr) * LORA_ADR_SNR_WEIGHT;
+    neighbor.samples++;
+
+    // Lowest SF that is viable at the maximum power, a faster one needs the hysteresis too
+    float headroom = neighbor.snr + LORA_ADR_MAX_POWER - power;
+    uint8_t chosen = 12;
+    for (uint8_t candidate = 7; candidate < 12; candidate++) {
+        float required = getRequiredSNR(candidate);
+        if (candidate < neighbor.sf)
+            required += LORA_ADR_HYSTERESIS;
+        if (headroom >= required) {
+            chosen = candidate;
+            break;
+        }
+    }
+
+    if (chosen != neighbor.sf) {
+        sfChanges++;
+        neighbor.sf = chosen;
+    }
+
+    int8_t chosenPower = getPowerFor(neighbor.snr, neighbor.sf);
+    if (chosenPower > neighbor.power || neighbor.power - chosenPower >= LORA_ADR_HYSTERESIS)
+        neighbor.power = chosenPower;
+}
+
+int8_t LoRaAdr::getPowerFor(float snr, uint8_t linkSF) {
+    // The SNR moves with the power dB by dB
+    float needed = getRequiredSNR(linkSF) - snr + power;
+    int8_t linkPower = (int8_t) ceilf(needed);
+
+    if (linkPower < LORA_ADR_MIN_POWER)
+        return LORA_ADR_MIN_POWER;
+    if (linkPower > LORA_ADR_MAX_POWER)
+        return LORA_ADR_MAX_POWER;
+    return linkPower;
+}
+
+uint8_t LoRaAdr::getSlowestSF() {
+    uint8_t slowest = 7;
+    bool found = false;
+    for (uint8_t i = 0; i < LORA_ADR_NEIGHBORS; i++) {
+        if (neighbors[i].samples > 0 && neighbors[i].sf > slowest)
+            slowest = neighbors[i].sf;
+        found |= neighbors[i].samples > 0;
+    }
+    return found ? slowest : sf;
+}
+
+float LoRaAdr::getRequiredSNR(uint8_t linkSF) {
+    return demodulationFloor[linkSF - 7] + LORA_ADR_MARGIN;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "routingSnapshot.h"
+
+/**
+ * @brief Adaptive data rate, lowest viable spreading factor and TX power for every neighbor
+ *
+ * The SNR of each neighbor is averaged from the routing table, taking the worst of both
+ * directions. A link is viable at a SF when its SNR is LORA_ADR_MARGIN dB over the demodulation
+ * floor of that SF. A neighbor only moves to a faster SF or a lower power when it clears the
+ * threshold by LORA_ADR_HYSTERESIS dB more, and moves back as soon as it does not.
+ *
+ * Every node of the mesh has to listen on the same SF, and LoRaMesher sets the SF and the power
+ * once in begin(), so the choices are not applied per packet. The controller reports the airtime a
+ * per-link SF would save and the SF the whole network could use, and /adrApply stores the lowest
+ * power that still reaches every neighbor at the current SF, used from the next boot.
+ */
+class LoRaAdr {
+public:
+    /**
+     * @brief Set the SF and the power the radio is using
+     *
+     */
+    void begin(uint8_t sf, int8_t power);
+
+    bool isSampleDue() {
+        return millis() - lastSample >= LORA_ADR_INTERVAL;
+    }
+
+    /**
+     * @brief Update the SNR of the neighbors from the routing table, call it when isSampleDue()
+     *
+     */
+    void sample(const RoutingTableSnapshot* routingTable);
+
+    /**
+     * @brief Account the airtime of a frame at the current SF and at the SF of its next hop
+     *
+     * @param via Next hop, BROADCAST_ADDR for all the neighbors
+     * @param frameSize Bytes given to LoRaMesher
+     */
+    void account(uint16_t via, size_t frameSize);
+
+    /**
+     * @brief Lowest power that keeps every neighbor viable at the current SF
+     *
+     * @return int8_t Power in dBm, the current one if there are no neighbors
+     */
+    int8_t getNodePower();
+
+    String getStats();
+
+private:
+    struct Neighbor {
+        uint16_t address;
+        float snr;
+        uint8_t sf;
+        int8_t power;
+        uint32_t samples;
+        uint32_t lastSeen;
+    };
+
+    Neighbor neighbors[LORA_ADR_NEIGHBORS] = {};
+
+    uint8_t sf = LM_CONFIG_LORASF;
+
+    int8_t power = LM_CONFIG_POWER;
+
+    uint32_t lastSample = 0;
+
+    uint64_t airtime = 0; //us at the current SF
+
+    uint64_t adaptedAirtime = 0; //us at the SF of each next hop
+
+    uint32_t sfChanges = 0;
+
+    portMUX_TYPE adrMux = portMUX_INITIALIZER_UNLOCKED;
+
+    Neighbor* getNeighbor(uint16_t address, uint32_t now);
+
+    void update(Neighbor& neighbor, int8_t snrSample);
+
+    int8_t getPowerFor(float snr, uint8_t sf);
+
+    /**
+     * @brief Slowest SF of the neighbors, the caller holds adrMux
+     */
+    uint8_t getSlowestSF();
+
+    static float getRequiredSNR(uint8_t sf);
+};
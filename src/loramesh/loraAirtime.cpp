@@ -0,0 +1,19 @@
+#include "loraAirtime.h"
+
+uint32_t LoRaAirtime::getTimeOnAir(uint16_t payloadSize, uint8_t sf, uint32_t bandwidth, uint8_t codingRate, uint16_t preamble) {
+    // Symbol time in ns, so SF7 at 500 kHz is still exact
+    uint64_t symbolTime = ((uint64_t) 1000000000 << sf) / bandwidth;
+
+    int32_t lowDataRate = (sf >= 11 && bandwidth <= 125000) ? 1 : 0;
+    int32_t numerator = 8 * payloadSize - 4 * sf + 28 + 16;
+    int32_t denominator = 4 * (sf - 2 * lowDataRate);
+
+    int32_t payloadSymbols = 8;
+    if (numerator > 0)
+        payloadSymbols += ((numerator + denominator - 1) / denominator) * codingRate;
+
+    // The preamble adds 4.25 symbols
+    uint64_t preambleTime = symbolTime * (4 * preamble + 17) / 4;
+
+    return (preambleTime + symbolTime * payloadSymbols) / 1000;
+}
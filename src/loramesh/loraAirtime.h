@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+/**
+ * @brief LoRa time on air, following the Semtech SX127x/SX126x datasheet formula
+ *
+ * Explicit header and CRC on, low data rate optimization from SF11 at 125 kHz.
+ */
+class LoRaAirtime {
+public:
+    /**
+     * @brief Time on air of a radio packet
+     *
+     * @param payloadSize Bytes of the radio payload
+     * @return uint32_t Microseconds
+     */
+    static uint32_t getTimeOnAir(uint16_t payloadSize, uint8_t sf = LM_CONFIG_LORASF, uint32_t bandwidth = LM_CONFIG_BANDWIDTH,
+        uint8_t codingRate = LM_CONFIG_CR, uint16_t preamble = LM_CONFIG_PREAMBLE);
+
+    /**
+     * @brief Time on air of an application payload sent through LoRaMesher, with its header
+     *
+     * @param appPayloadSize Bytes given to LoRaMesher
+     * @return uint32_t Microseconds
+     */
+    static uint32_t getFrameTimeOnAir(uint16_t appPayloadSize) {
+        return getTimeOnAir(appPayloadSize + LM_CONFIG_HEADER_SIZE);
+    }
+};
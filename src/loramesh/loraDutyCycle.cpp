@@ -0,0 +1,70 @@
+#include "loraDutyCycle.h"
+
+#define LORA_DUTY_CYCLE_BUCKET_TIME (LORA_DUTY_CYCLE_WINDOW / LORA_DUTY_CYCLE_BUCKETS)
+
+static const uint8_t deferThresholds[] = LORA_DUTY_CYCLE_DEFER;
+
+void LoRaDutyCycle::add(uint32_t airtime) {
+    portENTER_CRITICAL(&dutyCycleMux);
+    advance(millis());
+    buckets[currentBucket] += airtime;
+    portEXIT_CRITICAL(&dutyCycleMux);
+
+    uint32_t used = getUsed();
+    if (used > maxUsed)
+        maxUsed = used;
+}
+
+bool LoRaDutyCycle::allows(uint8_t trafficClass, uint32_t airtime) {
+    uint32_t used = getUsed();
+    uint32_t budget = getBudget();
+    if (used + airtime > budget)
+        return false;
+
+    return (uint64_t) (budget - used) * 100 >= (uint64_t) budget * deferThresholds[trafficClass];
+}
+
+uint32_t LoRaDutyCycle::getUsed() {
+    uint32_t used = 0;
+
+    portENTER_CRITICAL(&dutyCycleMux);
+    advance(millis());
+    for (uint8_t i = 0; i < LORA_DUTY_CYCLE_BUCKETS; i++)
+        used += buckets[i];
+    portEXIT_CRITICAL(&dutyCycleMux);
+
+    return used;
+}
+
+uint16_t LoRaDutyCycle::getRemaining() {
+    uint32_t used = getUsed();
+    uint32_t budget = getBudget();
+    if (used >= budget)
+        return 0;
+
+    return (uint64_t) (budget - used) * 1000 / budget;
+}
+
+String LoRaDutyCycle::getStats() {
+    uint32_t used = getUsed();
+
+    return "Duty cycle: " + String(used / 1000) + " of " + String(getBudget() / 1000) + " ms used in the last " +
+        String(LORA_DUTY_CYCLE_WINDOW / 60000) + " min, " + String(getRemaining() / 10.0, 1) + "% left, max used " +
+        String(maxUsed / 1000) + " ms\n";
+}
+
+void LoRaDutyCycle::advance(uint32_t now) {
+    uint32_t elapsed = (now - bucketStart) / LORA_DUTY_CYCLE_BUCKET_TIME;
+    if (elapsed == 0)
+        return;
+
+    if (elapsed > LORA_DUTY_CYCLE_BUCKETS)
+        elapsed = LORA_DUTY_CYCLE_BUCKETS;
+
+    for (uint32_t i = 0; i < elapsed; i++) {
+        currentBucket = (currentBucket + 1) % LORA_DUTY_CYCLE_BUCKETS;
+        buckets[currentBucket] = 0;
+    }
+
+    bucketStart = now - (now - bucketStart) % LORA_DUTY_CYCLE_BUCKET_TIME;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+/**
+ * @brief Sliding window accountant of the airtime used by this node
+ *
+ * The window is split in LORA_DUTY_CYCLE_BUCKETS buckets, the oldest one is dropped as the window
+ * moves. The budget is LORA_DUTY_CYCLE_PERMILLE of the window, and each traffic class stops
+ * transmitting when the budget left falls under its LORA_DUTY_CYCLE_DEFER percentage, so the
+ * bulk traffic is deferred first and the interactive one last.
+ * Only the frames given to LoRaMesher by this service are counted, not its routing packets.
+ */
+class LoRaDutyCycle {
+public:
+    /**
+     * @brief Account a transmission
+     *
+     * @param airtime Time on air in us
+     */
+    void add(uint32_t airtime);
+
+    /**
+     * @brief If a class can transmit a frame now
+     *
+     * @param trafficClass Class, from 0 (interactive) to LORA_SCHEDULER_CLASSES - 1 (bulk)
+     * @param airtime Time on air of the frame in us
+     */
+    bool allows(uint8_t trafficClass, uint32_t airtime);
+
+    uint32_t getUsed();
+
+    uint32_t getBudget() {
+        return (uint64_t) LORA_DUTY_CYCLE_WINDOW * LORA_DUTY_CYCLE_PERMILLE;
+    }
+
+    /**
+     * @brief Budget left in the window
+     *
+     * @return uint16_t Permille of the budget, from 0 to 1000
+     */
+    uint16_t getRemaining();
+
+    String getStats();
+
+private:
+    uint32_t buckets[LORA_DUTY_CYCLE_BUCKETS] = {}; //us
+
+    uint8_t currentBucket = 0;
+
+    uint32_t bucketStart = 0;
+
+    uint32_t maxUsed = 0;
+
+    portMUX_TYPE dutyCycleMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void advance(uint32_t now);
+};
@@ -0,0 +1,102 @@
+#include "loraMeshCoalescer.h"
+
+#include "loraAirtime.h"
+
+#include "loraMeshService.h"
+
+static const char* COALESCE_TAG = "LoRaMeshCoalescer";
+
+bool LoRaMeshCoalescer::add(DataMessage* message, uint8_t trafficClass) {
+    size_t entrySize = getLoRaMeshHeaderSize(message->appPortDst, message->appPortSrc) + message->messageSize;
+
+    if (message->addrDst == BROADCAST_ADDR || sizeof(LoRaMeshMessage) + 1 + entrySize > LORA_COALESCE_MTU)
+        return false;
+
+    if (count > 0 && (message->addrDst != dst || frameSize + 1 + entrySize > LORA_COALESCE_MTU))
+        flush();
+
+    if (count == 0) {
+        LoRaMeshMessage* container = (LoRaMeshMessage*) frame;
+        container->appPortDst = LoRaContainerApp;
+        container->appPortSrc = LoRaContainerApp;
+        container->messageId = containerId++;
+
+        frameSize = sizeof(LoRaMeshMessage);
+        dst = message->addrDst;
+        firstAdded = millis();
+        pendingAloneAirtime = 0;
+        pendingAppBytes = 0;
+    }
+
+    frame[frameSize++] = entrySize;
+
+    size_t headerSize = writeLoRaMeshHeader(frame + frameSize, message->appPortDst, message->appPortSrc, message->messageId);
+    memcpy(frame + frameSize + headerSize, message->message, message->messageSize);
+
+    frameSize += entrySize;
+    count++;
+    pendingAppBytes += message->messageSize;
+    pendingAloneAirtime += LoRaAirtime::getFrameTimeOnAir(entrySize);
+
+    // Interactive messages do not wait, nor those that would expire within the window
+    if (trafficClass == InteractivePriority - 1 ||
+        (message->deadline != 0 && (int32_t) (message->deadline - millis()) < LORA_COALESCE_WINDOW))
+        flush();
+
+    return true;
+}
+
+void LoRaMeshCoalescer::poll() {
+    if (count > 0 && millis() - firstAdded >= LORA_COALESCE_WINDOW)
+        flush();
+}
+
+void LoRaMeshCoalescer::flush() {
+    if (count == 0)
+        return;
+
+    LoRaMeshService& service = LoRaMeshService::getInstance();
+    if (count == 1) {
+        // Nothing to share, send the entry as a normal frame
+        service.sendFrame(dst, frame + sizeof(LoRaMeshMessage) + 1, frameSize - sizeof(LoRaMeshMessage) - 1, pendingAppBytes);
+    }
+    else {
+        service.sendFrame(dst, frame, frameSize, pendingAppBytes);
+
+        uint32_t airtime = LoRaAirtime::getFrameTimeOnAir(frameSize);
+        if (pendingAloneAirtime > airtime)
+            airtimeSaved += pendingAloneAirtime - airtime;
+
+        containersSent++;
+        messagesCoalesced += count;
+        TRACE("Container %d to %X sent with %d messages, %d bytes", ((LoRaMeshMessage*) frame)->messageId, dst, count, frameSize);
+    }
+
+    count = 0;
+    frameSize = 0;
+}
+
+uint8_t LoRaMeshCoalescer::unpack(LoRaMeshMessage* frame, uint32_t frameSize, void (*callback)(uint8_t* entry, uint32_t size, void* arg), void* arg) {
+    uint8_t* data = (uint8_t*) frame;
+    uint32_t offset = sizeof(LoRaMeshMessage);
+    uint8_t found = 0;
+
+    while (offset < frameSize) {
+        uint8_t entrySize = data[offset++];
+        if (entrySize < sizeof(LoRaMeshCompactMessage) || offset + entrySize > frameSize) {
+            ESP_LOGW(COALESCE_TAG, "Malformed container, %d bytes left", frameSize - offset);
+            break;
+        }
+
+        callback(data + offset, entrySize, arg);
+        offset += entrySize;
+        found++;
+    }
+
+    return found;
+}
+
+String LoRaMeshCoalescer::getStats() {
+    return "Containers sent: " + String(containersSent) + ", messages coalesced " + String(messagesCoalesced) + "\n" +
+        "Airtime saved: " + String((uint32_t) (airtimeSaved / 1000)) + " ms\n";
+}
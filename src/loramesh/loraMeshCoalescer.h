@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "loraMeshMessage.h"
+
+#include "message/dataMessage.h"
+
+/**
+ * @brief Pack the small messages sent to the same destination into one LoRa frame
+ *
+ * A container is a LoRaMeshMessage to LoRaContainerApp followed by entries of one size byte and each
+ * message with its LoRa header. It is sent when the next message does not fit in LORA_COALESCE_MTU
+ * or goes to another destination, after LORA_COALESCE_WINDOW, or right after an interactive message or a
+ * message whose deadline is closer than the window, so the container never holds one past its deadline.
+ * A container with one message is sent as a normal frame.
+ *
+ * It is only used from the LoRa send task, so it is not locked.
+ */
+class LoRaMeshCoalescer {
+public:
+    /**
+     * @brief Add the message to the container
+     *
+     * @param message Message, it is copied
+     * @param trafficClass Scheduler class of the message
+     * @return true If it has been added
+     * @return false If it cannot be coalesced, it must be sent alone
+     */
+    bool add(DataMessage* message, uint8_t trafficClass);
+
+    /**
+     * @brief Send the container if its window has expired
+     */
+    void poll();
+
+    void flush();
+
+    /**
+     * @brief Call the callback with every message of a received container
+     *
+     * @return uint8_t Messages found
+     */
+    static uint8_t unpack(LoRaMeshMessage* frame, uint32_t frameSize, void (*callback)(uint8_t* entry, uint32_t size, void* arg), void* arg);
+
+    String getStats();
+
+private:
+    uint8_t frame[LORA_COALESCE_MTU];
+
+    size_t frameSize = 0;
+
+    uint8_t count = 0;
+
+    uint16_t dst = 0;
+
+    uint32_t firstAdded = 0;
+
+    uint8_t containerId = 0;
+
+    // Airtime of the messages of the current container if they were sent alone
+    uint32_t pendingAloneAirtime = 0;
+
+    uint32_t pendingAppBytes = 0;
+
+    uint32_t containersSent = 0;
+    uint32_t messagesCoalesced = 0;
+    uint64_t airtimeSaved = 0;
+};
@@ -11,4 +11,69 @@ LoRaMeshCommandService::LoRaMeshCommandService() {
         [this](String args) {
         return LoRaMeshService::getInstance().getRoutingTable();
     }));
+
+    addCommand(Command("/schedStats", "Get the LoRa send scheduler counters of each class", LoRaMeshMessageType::getSchedulerStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getSchedulerStats();
+    }));
+
+    addCommand(Command("/setClass", "Set the weight and queue limit of a LoRa traffic class: <class> <weight> <limit>", LoRaMeshMessageType::setSchedulerClass, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().setSchedulerClass(args);
+    }));
+
+    addCommand(Command("/fragStats", "Get the LoRa fragmentation and reassembly counters", LoRaMeshMessageType::getFragmentStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getFragmenterStats();
+    }));
+
+    addCommand(Command("/airStats", "Get the LoRa coalescing counters, airtime and goodput", LoRaMeshMessageType::getCoalescerStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getCoalescerStats();
+    }));
+
+    addCommand(Command("/rxStats", "Get the LoRa receive batch counters", LoRaMeshMessageType::getReceiveStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getReceiveStats();
+    }));
+
+    addCommand(Command("/rtStats", "Get the routing table snapshot counters", LoRaMeshMessageType::getRoutingStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getRoutingStats();
+    }));
+
+    addCommand(Command("/getRTGateways", "Get the cost, load and choices of each gateway", LoRaMeshMessageType::getGatewayStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getGatewayStats();
+    }));
+
+    addCommand(Command("/adrStats", "Get the SF and power chosen for each neighbor and the airtime saved", LoRaMeshMessageType::getAdrStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getAdrStats();
+    }));
+
+    addCommand(Command("/adrApply", "Store the lowest TX power that reaches every neighbor, used after a reboot", LoRaMeshMessageType::applyAdrPower, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().applyAdrPower();
+    }));
+
+    addCommand(Command("/dutyStats", "Get the airtime used in the duty cycle window and the messages deferred", LoRaMeshMessageType::getDutyCycleStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getDutyCycleStats();
+    }));
+
+    addCommand(Command("/reliableStats", "Get the windows, RTT and retransmissions of the reliable frames", LoRaMeshMessageType::getReliableStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getReliableStats();
+    }));
+
+    addCommand(Command("/linkStats", "Get the delivery ratios and the ETX of each neighbor", LoRaMeshMessageType::getLinkStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getLinkStats();
+    }));
+
+    addCommand(Command("/channelStats", "Get the hopping slot, the channel of each neighbor and the load planned on each channel", LoRaMeshMessageType::getChannelStats, 1,
+        [this](String args) {
+        return LoRaMeshService::getInstance().getChannelStats();
+    }));
 }
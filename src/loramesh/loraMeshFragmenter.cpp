@@ -0,0 +1,353 @@
+#include "loraMeshFragmenter.h"
+
+#include "loraMeshService.h"
+
+static const char* FRAG_TAG = "LoRaMeshFragmenter";
+
+static_assert(sizeof(DataMessage) + LORA_FRAGMENT_MAX_COUNT * LORA_FRAGMENT_DATA_SIZE <= MESSAGE_POOL_LARGE_SLOT_SIZE,
+    "A reassembled message must fit in a large slot of the message pool");
+
+LoRaMeshFragmenter::LoRaMeshFragmenter() {
+    fragmenterMutex = xSemaphoreCreateMutex();
+}
+
+bool LoRaMeshFragmenter::needsFragmentation(DataMessage* message) {
+    return sizeof(LoRaMeshMessage) + message->messageSize > LORA_FRAGMENT_THRESHOLD;
+}
+
+bool LoRaMeshFragmenter::send(DataMessage* message) {
+    uint32_t count = (message->messageSize + LORA_FRAGMENT_DATA_SIZE - 1) / LORA_FRAGMENT_DATA_SIZE;
+    if (count > LORA_FRAGMENT_MAX_COUNT) {
+        ESP_LOGE(FRAG_TAG, "Message of %d bytes too big to be fragmented", message->messageSize);
+        messagesFailed++;
+        return false;
+    }
+
+    MessagePool& pool = MessageManager::getInstance().pool;
+
+    xSemaphoreTake(fragmenterMutex, portMAX_DELAY);
+
+    TxTransfer* transfer = nullptr;
+    for (size_t i = 0; i < LORA_FRAGMENT_TX_SLOTS; i++) {
+        if (!txTransfers[i].used) {
+            transfer = &txTransfers[i];
+            break;
+        }
+    }
+
+    if (!transfer) {
+        transfersRejected++;
+        xSemaphoreGive(fragmenterMutex);
+        ESP_LOGW(FRAG_TAG, "All the fragmentation slots are busy, message dropped");
+        return false;
+    }
+
+    DataMessage* fragmentedMessage = message;
+    if (pool.owns(message)) {
+        pool.retain(message);
+    }
+    else {
+        fragmentedMessage = (DataMessage*) pool.alloc(message->getDataMessageSize());
+        if (!fragmentedMessage) {
+            xSemaphoreGive(fragmenterMutex);
+            ESP_LOGE(FRAG_TAG, "Not enough memory to fragment the message");
+            return false;
+        }
+        memcpy(fragmentedMessage, message, message->getDataMessageSize());
+    }
+
+    transfer->message = fragmentedMessage;
+    transfer->count = count;
+    transfer->acked = 0;
+    transfer->retries = 0;
+    transfer->used = true;
+
+    for (uint8_t i = 0; i < count; i++)
+        sendFragment(*transfer, i);
+    transfer->lastSent = millis();
+
+    TRACE("Message %d to %X sent in %d fragments", message->messageId, message->addrDst, count);
+
+    // Nobody acknowledges broadcasts
+    if (message->addrDst == BROADCAST_ADDR)
+        releaseTransfer(*transfer);
+
+    xSemaphoreGive(fragmenterMutex);
+    return true;
+}
+
+DataMessage* LoRaMeshFragmenter::receive(uint16_t src, uint16_t dst, LoRaMeshMessage* frame, uint32_t frameSize) {
+    if (frameSize < sizeof(LoRaMeshMessage) + sizeof(LoRaFragmentHeader)) {
+        ESP_LOGW(FRAG_TAG, "Fragment frame too small: %d bytes", frameSize);
+        return nullptr;
+    }
+
+    LoRaFragmentHeader* header = (LoRaFragmentHeader*) frame->dataMessage;
+    uint32_t dataSize = frameSize - sizeof(LoRaMeshMessage) - sizeof(LoRaFragmentHeader);
+
+    DataMessage* message = nullptr;
+
+    xSemaphoreTake(fragmenterMutex, portMAX_DELAY);
+
+    if (header->type == FragmentNack && dataSize >= sizeof(LoRaFragmentNack))
+        processNack(src, frame, (LoRaFragmentNack*) (header + 1));
+    else if (header->type == FragmentData)
+        message = processFragment(src, dst, frame, header, dataSize);
+    else
+        ESP_LOGW(FRAG_TAG, "Unknown fragment type %d", header->type);
+
+    xSemaphoreGive(fragmenterMutex);
+
+    return message;
+}
+
+void LoRaMeshFragmenter::poll() {
+    uint32_t now = millis();
+
+    xSemaphoreTake(fragmenterMutex, portMAX_DELAY);
+
+    for (size_t i = 0; i < LORA_FRAGMENT_TX_SLOTS; i++) {
+        TxTransfer& transfer = txTransfers[i];
+        if (!transfer.used || now - transfer.lastSent < LORA_FRAGMENT_RETRY_DELAY)
+            continue;
+
+        if (transfer.retries >= LORA_FRAGMENT_RETRIES) {
+            ESP_LOGW(FRAG_TAG, "Message %d to %X not acknowledged, dropped", transfer.message->messageId, transfer.message->addrDst);
+            messagesFailed++;
+            releaseTransfer(transfer);
+            continue;
+        }
+
+        transfer.retries++;
+        sendMissingFragments(transfer);
+    }
+
+    for (size_t i = 0; i < LORA_FRAGMENT_RX_SLOTS; i++) {
+        RxTransfer& transfer = rxTransfers[i];
+        if (!transfer.used || transfer.done)
+            continue;
+
+        if (now - transfer.started > LORA_FRAGMENT_TIMEOUT) {
+            ESP_LOGW(FRAG_TAG, "Message %d from %X not completed, dropped", transfer.messageId, transfer.src);
+            reassembliesExpired++;
+            transfer.used = false;
+            continue;
+        }
+
+        if (now - transfer.lastReceived > LORA_FRAGMENT_NACK_DELAY && now - transfer.lastNack > LORA_FRAGMENT_NACK_DELAY)
+            sendNack(transfer);
+    }
+
+    xSemaphoreGive(fragmenterMutex);
+}
+
+String LoRaMeshFragmenter::getStats() {
+    return "Fragments sent: " + String(fragmentsSent) + ", resent " + String(fragmentsResent) + "\n" +
+        "Messages acknowledged: " + String(messagesAcked) + ", failed " + String(messagesFailed) + "\n" +
+        "Messages reassembled: " + String(messagesReassembled) + ", expired " + String(reassembliesExpired) + "\n" +
+        "NACKs sent: " + String(nacksSent) + ", transfers rejected " + String(transfersRejected) + "\n";
+}
+
+uint32_t LoRaMeshFragmenter::fullBitmap(uint8_t count) {
+    return count >= 32 ? UINT32_MAX : (1u << count) - 1;
+}
+
+void LoRaMeshFragmenter::sendFragment(TxTransfer& transfer, uint8_t index) {
+    DataMessage* message = transfer.message;
+
+    uint8_t frame[sizeof(LoRaMeshMessage) + sizeof(LoRaFragmentHeader) + LORA_FRAGMENT_DATA_SIZE];
+    LoRaMeshMessage* loraMeshMessage = (LoRaMeshMessage*) frame;
+    loraMeshMessage->appPortDst = LoRaFragmentApp;
+    loraMeshMessage->appPortSrc = message->appPortSrc;
+    loraMeshMessage->messageId = message->messageId;
+
+    LoRaFragmentHeader* header = (LoRaFragmentHeader*) loraMeshMessage->dataMessage;
+    header->type = FragmentData;
+    header->appPortDst = message->appPortDst;
+    header->index = index;
+    header->count = transfer.count;
+
+    uint32_t offset = index * LORA_FRAGMENT_DATA_SIZE;
+    uint32_t size = message->messageSize - offset;
+    if (size > LORA_FRAGMENT_DATA_SIZE)
+        size = LORA_FRAGMENT_DATA_SIZE;
+
+    memcpy(header + 1, message->message + offset, size);
+
+    LoRaMeshService::getInstance().sendFrame(message->addrDst, frame,
+        sizeof(LoRaMeshMessage) + sizeof(LoRaFragmentHeader) + size, size, false);
+    fragmentsSent++;
+}
+
+void LoRaMeshFragmenter::sendMissingFragments(TxTransfer& transfer) {
+    for (uint8_t i = 0; i < transfer.count; i++) {
+        if (transfer.acked & (1u << i))
+            continue;
+
+        sendFragment(transfer, i);
+        fragmentsResent++;
+    }
+    transfer.lastSent = millis();
+}
+
+void LoRaMeshFragmenter::releaseTransfer(TxTransfer& transfer) {
+    MessageManager::getInstance().pool.release(transfer.message);
+    transfer.message = nullptr;
+    transfer.used = false;
+}
+
+void LoRaMeshFragmenter::sendNack(RxTransfer& transfer) {
+    if (transfer.dst == BROADCAST_ADDR)
+        return;
+
+    uint8_t frame[sizeof(LoRaMeshMessage) + sizeof(LoRaFragmentHeader) + sizeof(LoRaFragmentNack)];
+    LoRaMeshMessage* loraMeshMessage = (LoRaMeshMessage*) frame;
+    loraMeshMessage->appPortDst = LoRaFragmentApp;
+    loraMeshMessage->appPortSrc = transfer.appPortSrc;
+    loraMeshMessage->messageId = transfer.messageId;
+
+    LoRaFragmentHeader* header = (LoRaFragmentHeader*) loraMeshMessage->dataMessage;
+    header->type = FragmentNack;
+    header->appPortDst = transfer.appPortDst;
+    header->index = 0;
+    header->count = transfer.count;
+
+    LoRaFragmentNack* nack = (LoRaFragmentNack*) (header + 1);
+    nack->received = transfer.received;
+
+    LoRaMeshService::getInstance().sendFrame(transfer.src, frame, sizeof(frame), 0, false);
+    transfer.lastNack = millis();
+    nacksSent++;
+}
+
+void LoRaMeshFragmenter::processNack(uint16_t src, LoRaMeshMessage* frame, LoRaFragmentNack* nack) {
+    for (size_t i = 0; i < LORA_FRAGMENT_TX_SLOTS; i++) {
+        TxTransfer& transfer = txTransfers[i];
+        if (!transfer.used || transfer.message->addrDst != src ||
+            transfer.message->appPortSrc != frame->appPortSrc || transfer.message->messageId != frame->messageId)
+            continue;
+
+        transfer.acked |= nack->received & fullBitmap(transfer.count);
+
+        if (transfer.acked == fullBitmap(transfer.count)) {
+            TRACE("Message %d to %X acknowledged", frame->messageId, src);
+            messagesAcked++;
+            releaseTransfer(transfer);
+            return;
+        }
+
+        if (transfer.retries >= LORA_FRAGMENT_RETRIES) {
+            ESP_LOGW(FRAG_TAG, "Message %d to %X still incomplete, dropped", frame->messageId, src);
+            messagesFailed++;
+            releaseTransfer(transfer);
+            return;
+        }
+
+        transfer.retries++;
+        sendMissingFragments(transfer);
+        return;
+    }
+}
+
+LoRaMeshFragmenter::RxTransfer* LoRaMeshFragmenter::getRxTransfer(uint16_t src, LoRaMeshMessage* frame, LoRaFragmentHeader* header) {
+    uint32_t now = millis();
+    RxTransfer* candidate = nullptr;
+
+    for (size_t i = 0; i < LORA_FRAGMENT_RX_SLOTS; i++) {
+        RxTransfer& transfer = rxTransfers[i];
+
+        bool alive = transfer.used && (transfer.done ? now - transfer.lastReceived : now - transfer.started) <= LORA_FRAGMENT_TIMEOUT;
+        if (alive && transfer.src == src && transfer.appPortSrc == frame->appPortSrc &&
+            transfer.messageId == frame->messageId && transfer.count == header->count)
+            return &transfer;
+
+        // Reuse an empty slot, else a completed one, else an expired one
+        if (!transfer.used)
+            candidate = &transfer;
+        else if ((transfer.done || !alive) && (!candidate || candidate->used))
+            candidate = &transfer;
+    }
+
+    if (!candidate)
+        return nullptr;
+
+    if (candidate->used && !candidate->done)
+        reassembliesExpired++;
+
+    candidate->src = src;
+    candidate->appPortSrc = frame->appPortSrc;
+    candidate->appPortDst = header->appPortDst;
+    candidate->messageId = frame->messageId;
+    candidate->count = header->count;
+    candidate->received = 0;
+    candidate->size = 0;
+    candidate->started = now;
+    candidate->lastNack = now;
+    candidate->used = true;
+    candidate->done = false;
+
+    return candidate;
+}
+
+DataMessage* LoRaMeshFragmenter::processFragment(uint16_t src, uint16_t dst, LoRaMeshMessage* frame, LoRaFragmentHeader* header, uint32_t dataSize) {
+    bool last = header->index == header->count - 1;
+    if (header->count == 0 || header->count > LORA_FRAGMENT_MAX_COUNT || header->index >= header->count ||
+        dataSize > LORA_FRAGMENT_DATA_SIZE || (!last && dataSize != LORA_FRAGMENT_DATA_SIZE)) {
+        ESP_LOGW(FRAG_TAG, "Invalid fragment %d/%d from %X", header->index, header->count, src);
+        return nullptr;
+    }
+
+    RxTransfer* transfer = getRxTransfer(src, frame, header);
+    if (!transfer) {
+        transfersRejected++;
+        ESP_LOGW(FRAG_TAG, "All the reassembly slots are busy, fragment from %X dropped", src);
+        return nullptr;
+    }
+
+    transfer->dst = dst;
+    transfer->lastReceived = millis();
+
+    // The acknowledgement was lost, send it again
+    if (transfer->done) {
+        sendNack(*transfer);
+        return nullptr;
+    }
+
+    uint32_t bit = 1u << header->index;
+    if (!(transfer->received & bit)) {
+        memcpy(transfer->data + header->index * LORA_FRAGMENT_DATA_SIZE, header + 1, dataSize);
+        transfer->received |= bit;
+        if (last)
+            transfer->size = header->index * LORA_FRAGMENT_DATA_SIZE + dataSize;
+    }
+
+    if (transfer->received != fullBitmap(transfer->count)) {
+        if (last)
+            sendNack(*transfer);
+        return nullptr;
+    }
+
+    transfer->done = true;
+    sendNack(*transfer);
+
+    DataMessage* message = (DataMessage*) MessageManager::getInstance().pool.alloc(sizeof(DataMessage) + transfer->size);
+    if (!message) {
+        ESP_LOGE(FRAG_TAG, "Not enough memory to reassemble the message");
+        return nullptr;
+    }
+
+    message->appPortDst = transfer->appPortDst;
+    message->appPortSrc = transfer->appPortSrc;
+    message->messageId = transfer->messageId;
+    message->addrSrc = transfer->src;
+    message->addrDst = dst;
+    message->messageSize = transfer->size;
+    message->priority = messagePriority::DefaultPriority;
+    message->deadline = 0;
+    memcpy(message->message, transfer->data, transfer->size);
+
+    messagesReassembled++;
+    TRACE("Message %d from %X reassembled, %d bytes", message->messageId, message->addrSrc, message->messageSize);
+
+    return message;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "loraMeshMessage.h"
+
+#include "message/dataMessage.h"
+
+static_assert(LORA_FRAGMENT_MAX_COUNT <= 32, "The fragment bitmaps are 32 bits");
+
+/**
+ * @brief Split the messages that do not fit in one LoRa frame and reassemble them at the destination
+ *
+ * Fragments are sent unreliably, the receiver answers with a bitmap of the fragments it has: after the
+ * last fragment, after LORA_FRAGMENT_NACK_DELAY without new fragments, or when the message is complete,
+ * which acknowledges it. The sender only sends again the fragments missing in the bitmap.
+ * Both sides use a fixed number of slots, a new transfer is rejected when all of them are busy.
+ */
+class LoRaMeshFragmenter {
+public:
+    LoRaMeshFragmenter();
+
+    static bool needsFragmentation(DataMessage* message);
+
+    /**
+     * @brief Start sending a message in fragments
+     *
+     * @param message Message, it is retained or copied into the message pool until it is acknowledged
+     * @return true If the transfer has started
+     */
+    bool send(DataMessage* message);
+
+    /**
+     * @brief Process a frame addressed to LoRaFragmentApp
+     *
+     * @param src Address of the sender
+     * @param dst Address of the destination
+     * @param frame Frame
+     * @param frameSize Size of the frame
+     * @return DataMessage* Message reassembled from the message pool, nullptr if it is not complete yet
+     */
+    DataMessage* receive(uint16_t src, uint16_t dst, LoRaMeshMessage* frame, uint32_t frameSize);
+
+    /**
+     * @brief Send the pending NACKs and retries, and expire the old transfers
+     */
+    void poll();
+
+    String getStats();
+
+private:
+    struct TxTransfer {
+        DataMessage* message;
+        uint32_t acked;
+        uint32_t lastSent;
+        uint8_t count;
+        uint8_t retries;
+        bool used;
+    };
+
+    struct RxTransfer {
+        uint16_t src;
+        uint16_t dst;
+        appPort appPortSrc;
+        appPort appPortDst;
+        uint8_t messageId;
+        uint8_t count;
+        uint32_t received;
+        uint32_t size;
+        uint32_t started;
+        uint32_t lastReceived;
+        uint32_t lastNack;
+        bool used;
+        bool done;
+        uint8_t data[LORA_FRAGMENT_DATA_SIZE * LORA_FRAGMENT_MAX_COUNT];
+    };
+
+    TxTransfer txTransfers[LORA_FRAGMENT_TX_SLOTS] = {};
+
+    RxTransfer rxTransfers[LORA_FRAGMENT_RX_SLOTS] = {};
+
+    SemaphoreHandle_t fragmenterMutex;
+
+    uint32_t fragmentsSent = 0;
+    uint32_t fragmentsResent = 0;
+    uint32_t messagesAcked = 0;
+    uint32_t messagesFailed = 0;
+    uint32_t nacksSent = 0;
+    uint32_t messagesReassembled = 0;
+    uint32_t reassembliesExpired = 0;
+    uint32_t transfersRejected = 0;
+
+    static uint32_t fullBitmap(uint8_t count);
+
+    void sendFragment(TxTransfer& transfer, uint8_t index);
+
+    void sendMissingFragments(TxTransfer& transfer);
+
+    void releaseTransfer(TxTransfer& transfer);
+
+    void sendNack(RxTransfer& transfer);
+
+    void processNack(uint16_t src, LoRaMeshMessage* frame, LoRaFragmentNack* nack);
+
+    RxTransfer* getRxTransfer(uint16_t src, LoRaMeshMessage* frame, LoRaFragmentHeader* header);
+
+    DataMessage* processFragment(uint16_t src, uint16_t dst, LoRaMeshMessage* frame, LoRaFragmentHeader* header, uint32_t dataSize);
+};
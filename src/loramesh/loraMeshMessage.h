@@ -11,6 +11,19 @@
 enum LoRaMeshMessageType: uint8_t {
     sendMessage = 1,
     getRoutingTable = 2,
+    getSchedulerStats = 3,
+    setSchedulerClass = 4,
+    getFragmentStats = 5,
+    getCoalescerStats = 6,
+    getReceiveStats = 7,
+    getRoutingStats = 8,
+    getGatewayStats = 9,
+    getAdrStats = 10,
+    applyAdrPower = 11,
+    getDutyCycleStats = 12,
+    getReliableStats = 13,
+    getLinkStats = 14,
+    getChannelStats = 15,
 };
 
 class LoRaMeshMessage {
@@ -20,6 +33,130 @@ public:
     uint8_t messageId;
     uint8_t dataMessage[];
 };
+
+/**
+ * @brief Compact header, used when both ports fit in a nibble
+ *
+ * The first byte is appPortDst << 4 | appPortSrc. appPortDst goes from 4 to 15, so the top bits are never
+ * 0b00 like the appPortDst of a LoRaMeshMessage, every port below 64 keeps the legacy header. It covers
+ * the uplinks to MQTTApp from GPSApp, SimApp, SensorApp and MetadataApp, MonApp and the LoRa transport
+ * ports do not fit and use the legacy header.
+ * The payload size is never sent, it comes from the radio packet length.
+ */
+class LoRaMeshCompactMessage {
+public:
+    uint8_t appPorts;
+    uint8_t messageId;
+    uint8_t dataMessage[];
+};
+
+#define LORA_COMPACT_HEADER_MASK 0xC0
+#define LORA_COMPACT_HEADER_MIN_DST 4
+#define LORA_COMPACT_HEADER_MAX_PORT 15
+
+inline size_t getLoRaMeshHeaderSize(appPort appPortDst, appPort appPortSrc) {
+#ifdef LORA_COMPACT_HEADER
+    if (appPortDst >= LORA_COMPACT_HEADER_MIN_DST && appPortDst <= LORA_COMPACT_HEADER_MAX_PORT &&
+        appPortSrc <= LORA_COMPACT_HEADER_MAX_PORT)
+        return sizeof(LoRaMeshCompactMessage);
+#endif
+    return sizeof(LoRaMeshMessage);
+}
+
+/**
+ * @brief Write the LoRa header of a message
+ *
+ * @return size_t Bytes written, the payload starts after them
+ */
+inline size_t writeLoRaMeshHeader(uint8_t* buffer, appPort appPortDst, appPort appPortSrc, uint8_t messageId) {
+    if (getLoRaMeshHeaderSize(appPortDst, appPortSrc) == sizeof(LoRaMeshCompactMessage)) {
+        LoRaMeshCompactMessage* header = (LoRaMeshCompactMessage*) buffer;
+        header->appPorts = appPortDst << 4 | appPortSrc;
+        header->messageId = messageId;
+        return sizeof(LoRaMeshCompactMessage);
+    }
+
+    LoRaMeshMessage* header = (LoRaMeshMessage*) buffer;
+    header->appPortDst = appPortDst;
+    header->appPortSrc = appPortSrc;
+    header->messageId = messageId;
+    return sizeof(LoRaMeshMessage);
+}
+
+/**
+ * @brief Read the LoRa header of a message, compact or legacy
+ *
+ * @return size_t Bytes read, 0 if the frame is too small
+ */
+inline size_t readLoRaMeshHeader(const uint8_t* buffer, size_t size, appPort& appPortDst, appPort& appPortSrc, uint8_t& messageId) {
+    if (size >= sizeof(LoRaMeshCompactMessage) && (buffer[0] & LORA_COMPACT_HEADER_MASK) != 0) {
+        const LoRaMeshCompactMessage* header = (const LoRaMeshCompactMessage*) buffer;
+        appPortDst = (appPort) (header->appPorts >> 4);
+        appPortSrc = (appPort) (header->appPorts & 0x0F);
+        messageId = header->messageId;
+        return sizeof(LoRaMeshCompactMessage);
+    }
+
+    if (size < sizeof(LoRaMeshMessage))
+        return 0;
+
+    const LoRaMeshMessage* header = (const LoRaMeshMessage*) buffer;
+    appPortDst = header->appPortDst;
+    appPortSrc = header->appPortSrc;
+    messageId = header->messageId;
+    return sizeof(LoRaMeshMessage);
+}
+
+enum LoRaFragmentType: uint8_t {
+    FragmentData = 1,
+    FragmentNack = 2,
+};
+
+/**
+ * @brief Header after the LoRaMeshMessage of the frames sent to LoRaFragmentApp
+ *
+ * The LoRaMeshMessage keeps the appPortSrc and messageId of the original message, together with the
+ * addresses they identify the transfer.
+ * FragmentData is followed by the fragment bytes, FragmentNack by LoRaFragmentNack.
+ */
+class LoRaFragmentHeader {
+public:
+    LoRaFragmentType type;
+    appPort appPortDst;
+    uint8_t index;
+    uint8_t count;
+};
+
+class LoRaFragmentNack {
+public:
+    uint32_t received; //Bitmap of the fragments received, all of them acknowledges the message
+};
+
+enum LoRaReliableType: uint8_t {
+    ReliableData = 1,
+    ReliableAck = 2,
+};
+
+/**
+ * @brief Header after the LoRaMeshMessage of the frames sent to LoRaReliableApp
+ *
+ * The LoRaMeshMessage has both ports set to LoRaReliableApp and the sequence number in the messageId.
+ * ReliableData is followed by the frame delivered, ReliableAck by LoRaReliableAck and acknowledges all
+ * the frames before its sequence number.
+ * The epoch is chosen by the sender for each destination, a new one resets the state of the receiver.
+ * The base is the oldest frame the sender has not given up, the receiver does not wait for the older ones.
+ */
+class LoRaReliableHeader {
+public:
+    LoRaReliableType type;
+    uint8_t epoch;
+    uint8_t base;
+};
+
+class LoRaReliableAck {
+public:
+    uint32_t received; //Bitmap of the frames received after the cumulative one, bit 0 is sequence + 1
+};
 #pragma pack()
 
 
@@ -0,0 +1,502 @@
+#include "loraMeshReliable.h"
+
+#include "loraMeshService.h"
+
+static const char* RELIABLE_TAG = "LoRaMeshReliable";
+
+#define LORA_RELIABLE_HEADER_SIZE (sizeof(LoRaMeshMessage) + sizeof(LoRaReliableHeader))
+
+LoRaMeshReliable::LoRaMeshReliable() {
+    reliableMutex = xSemaphoreCreateMutex();
+    nextEpoch = esp_random();
+}
+
+bool LoRaMeshReliable::send(uint16_t dst, uint8_t* frame, size_t frameSize, uint32_t appBytes) {
+    if (frameSize > LORA_RELIABLE_FRAME_SIZE)
+        return false;
+
+    xSemaphoreTake(reliableMutex, portMAX_DELAY);
+
+    TxFrame* txFrame = nullptr;
+    for (size_t i = 0; i < LORA_RELIABLE_TX_SLOTS; i++) {
+        if (!txFrames[i].used) {
+            txFrame = &txFrames[i];
+            break;
+        }
+    }
+
+    TxPeer* peer = txFrame ? getTxPeer(dst) : nullptr;
+    if (!peer) {
+        framesRejected++;
+        xSemaphoreGive(reliableMutex);
+        ESP_LOGW(RELIABLE_TAG, "No reliable slot for a frame to %X", dst);
+        return false;
+    }
+
+    txFrame->peer = peer - txPeers;
+    txFrame->seq = peer->nextSeq++;
+    txFrame->retries = 0;
+    txFrame->sent = false;
+    txFrame->fastRetransmitted = false;
+    txFrame->used = true;
+    txFrame->appBytes = appBytes;
+    txFrame->size = LORA_RELIABLE_HEADER_SIZE + frameSize;
+
+    LoRaMeshMessage* loraMeshMessage = (LoRaMeshMessage*) txFrame->data;
+    loraMeshMessage->appPortDst = LoRaReliableApp;
+    loraMeshMessage->appPortSrc = LoRaReliableApp;
+    loraMeshMessage->messageId = txFrame->seq;
+
+    LoRaReliableHeader* header = (LoRaReliableHeader*) loraMeshMessage->dataMessage;
+    header->type = ReliableData;
+    header->epoch = peer->epoch;
+    memcpy(header + 1, frame, frameSize);
+
+    peer->queued++;
+    peer->lastActive = millis();
+
+    sendWindows();
+
+    xSemaphoreGive(reliableMutex);
+    return true;
+}
+
+bool LoRaMeshReliable::hasSpace() {
+    for (size_t i = 0; i < LORA_RELIABLE_TX_SLOTS; i++) {
+        if (!txFrames[i].used)
+            return true;
+    }
+    return false;
+}
+
+bool LoRaMeshReliable::receive(uint16_t src, LoRaMeshMessage* frame, uint32_t frameSize, uint8_t*& data, uint32_t& dataSize) {
+    if (frameSize < LORA_RELIABLE_HEADER_SIZE) {
+        ESP_LOGW(RELIABLE_TAG, "Reliable frame too small: %d bytes", frameSize);
+        return false;
+    }
+
+    LoRaReliableHeader* header = (LoRaReliableHeader*) frame->dataMessage;
+    uint8_t seq = frame->messageId;
+
+    if (header->type == ReliableAck) {
+        if (frameSize < LORA_RELIABLE_HEADER_SIZE + sizeof(LoRaReliableAck))
+            return false;
+
+        xSemaphoreTake(reliableMutex, portMAX_DELAY);
+        processAck(src, header->epoch, seq, (LoRaReliableAck*) (header + 1));
+        xSemaphoreGive(reliableMutex);
+        return false;
+    }
+
+    if (header->type != ReliableData) {
+        ESP_LOGW(RELIABLE_TAG, "Unknown reliable frame type %d", header->type);
+        return false;
+    }
+
+    xSemaphoreTake(reliableMutex, portMAX_DELAY);
+
+    RxPeer* peer = getRxPeer(src, header->epoch, header->base);
+    if (!peer) {
+        // Not acknowledged, the sender tries again
+        framesRejected++;
+        xSemaphoreGive(reliableMutex);
+        return false;
+    }
+
+    peer->lastActive = millis();
+
+    // The sender gave up the frames before its base
+    while ((int8_t) (header->base - peer->expected) > 0)
+        advance(*peer);
+
+    // Sequence numbers skipped are frames lost on the link, the first time they are seen
+    uint8_t lost = 0;
+    if ((int8_t) (seq - peer->highest) > 0) {
+        lost = seq - peer->highest - 1;
+        peer->highest = seq;
+    }
+    LoRaMeshService::getInstance().recordReception(src, 1, lost);
+
+    int8_t offset = (int8_t) (seq - peer->expected);
+    bool isNew = false;
+    bool gap = peer->received != 0;
+
+    if (offset == 0) {
+        advance(*peer);
+        isNew = true;
+    }
+    else if (offset > 0 && offset <= 32) {
+        uint32_t bit = 1u << (offset - 1);
+        isNew = !(peer->received & bit);
+        peer->received |= bit;
+        gap = true;
+        if (isNew)
+            outOfOrder++;
+    }
+
+    if (!isNew) {
+        duplicates++;
+        sendAck(*peer);
+        xSemaphoreGive(reliableMutex);
+        return false;
+    }
+
+    if (peer->unacked++ == 0)
+        peer->firstUnacked = millis();
+
+    // A hole is reported at once, so the sender does not wait for its RTO
+    if (gap || peer->unacked >= LORA_RELIABLE_ACK_EVERY)
+        sendAck(*peer);
+
+    framesReceived++;
+
+    xSemaphoreGive(reliableMutex);
+
+    data = (uint8_t*) (header + 1);
+    dataSize = frameSize - LORA_RELIABLE_HEADER_SIZE;
+    return true;
+}
+
+void LoRaMeshReliable::poll() {
+    uint32_t now = millis();
+
+    xSemaphoreTake(reliableMutex, portMAX_DELAY);
+
+    for (size_t i = 0; i < LORA_RELIABLE_TX_SLOTS; i++) {
+        TxFrame& txFrame = txFrames[i];
+        if (!txFrame.used || !txFrame.sent)
+            continue;
+
+        TxPeer& peer = txPeers[txFrame.peer];
+        uint32_t rto = getRto(peer) << txFrame.retries;
+        if (rto > LORA_RELIABLE_MAX_RTO)
+            rto = LORA_RELIABLE_MAX_RTO;
+
+        if (now - txFrame.sentAt < rto)
+            continue;
+
+        // Once for each window of losses
+        if (now - peer.lastLoss > getRto(peer)) {
+            peer.cwnd = peer.cwnd > 2 ? peer.cwnd / 2 : 1;
+            peer.lastLoss = now;
+        }
+
+        if (txFrame.retries >= LORA_RELIABLE_RETRIES) {
+            ESP_LOGW(RELIABLE_TAG, "Frame %d to %X not acknowledged, dropped", txFrame.seq, peer.dst);
+            LoRaMeshService::getInstance().recordDelivery(peer.dst, txFrame.retries + 1, false);
+            framesFailed++;
+            releaseTxFrame(txFrame);
+            continue;
+        }
+
+        txFrame.retries++;
+        sendTxFrame(txFrame);
+    }
+
+    sendWindows();
+
+    for (size_t i = 0; i < LORA_RELIABLE_PEERS; i++) {
+        RxPeer& rxPeer = rxPeers[i];
+        if (rxPeer.used && rxPeer.unacked > 0 && now - rxPeer.firstUnacked >= LORA_RELIABLE_ACK_DELAY)
+            sendAck(rxPeer);
+
+        if (rxPeer.used && now - rxPeer.lastActive > LORA_RELIABLE_PEER_TIMEOUT)
+            rxPeer.used = false;
+
+        TxPeer& txPeer = txPeers[i];
+        if (txPeer.used && txPeer.queued == 0 && now - txPeer.lastActive > LORA_RELIABLE_PEER_TIMEOUT)
+            txPeer.used = false;
+    }
+
+    xSemaphoreGive(reliableMutex);
+}
+
+String LoRaMeshReliable::getStats() {
+    String stats = "Frames sent: " + String(framesSent) + ", resent " + String(framesResent) + ", acknowledged " +
+        String(framesAcked) + ", failed " + String(framesFailed) + ", rejected " + String(framesRejected) + "\n" +
+        "Frames received: " + String(framesReceived) + ", out of order " + String(outOfOrder) + ", duplicates " +
+        String(duplicates) + ", ACKs sent " + String(acksSent) + "\n" +
+        "RTT samples: " + String(rttSamples) + "\n";
+
+    xSemaphoreTake(reliableMutex, portMAX_DELAY);
+    for (size_t i = 0; i < LORA_RELIABLE_PEERS; i++) {
+        TxPeer& peer = txPeers[i];
+        if (!peer.used)
+            continue;
+
+        stats += String(peer.dst, HEX) + ": window " + String(getWindow(peer)) + ", in flight " + String(peer.inFlight) +
+            ", queued " + String(peer.queued) + ", SRTT " + String(peer.srtt) + " ms, RTTVAR " + String(peer.rttvar) +
+            " ms, RTO " + String(getRto(peer)) + " ms\n";
+    }
+    xSemaphoreGive(reliableMutex);
+
+    return stats;
+}
+
+LoRaMeshReliable::TxPeer* LoRaMeshReliable::getTxPeer(uint16_t dst) {
+    TxPeer* candidate = nullptr;
+    for (size_t i = 0; i < LORA_RELIABLE_PEERS; i++) {
+        TxPeer& peer = txPeers[i];
+        if (peer.used && peer.dst == dst)
+            return &peer;
+
+        // Reuse an empty slot, else the idle one used least recently
+        if (!peer.used)
+            candidate = &peer;
+        else if (peer.queued == 0 && (!candidate || (candidate->used && peer.lastActive - candidate->lastActive > UINT32_MAX / 2)))
+            candidate = &peer;
+    }
+
+    if (!candidate)
+        return nullptr;
+
+    // A new epoch, the destination can still remember the sequence numbers of the previous one
+    candidate->dst = dst;
+    candidate->epoch = nextEpoch++;
+    candidate->nextSeq = 0;
+    candidate->queued = 0;
+    candidate->inFlight = 0;
+    candidate->cwnd = LORA_RELIABLE_INITIAL_WINDOW;
+    candidate->srtt = 0;
+    candidate->rttvar = 0;
+    candidate->lastLoss = 0;
+    candidate->frameAirtime = 0;
+    candidate->used = true;
+
+    LoRaMeshService& service = LoRaMeshService::getInstance();
+    const RoutingTableSnapshot* routingTable = service.acquireRoutingTable();
+    seedRtt(*candidate, routingTable);
+    service.releaseRoutingTable(routingTable);
+
+    return candidate;
+}
+
+LoRaMeshReliable::RxPeer* LoRaMeshReliable::getRxPeer(uint16_t src, uint8_t epoch, uint8_t base) {
+    RxPeer* candidate = nullptr;
+    for (size_t i = 0; i < LORA_RELIABLE_PEERS; i++) {
+        RxPeer& peer = rxPeers[i];
+        if (peer.used && peer.src == src) {
+            candidate = &peer;
+            if (peer.epoch == epoch)
+                return &peer;
+            break;
+        }
+
+        // Reuse an empty slot, else the one used least recently
+        if (!candidate || (candidate->used && (!peer.used || peer.lastActive - candidate->lastActive > UINT32_MAX / 2)))
+            candidate = &peer;
+    }
+
+    if (candidate->used && candidate->unacked > 0)
+        sendAck(*candidate);
+
+    candidate->src = src;
+    candidate->epoch = epoch;
+    candidate->expected = base;
+    candidate->highest = base - 1;
+    candidate->received = 0;
+    candidate->unacked = 0;
+    candidate->used = true;
+
+    return candidate;
+}
+
+void LoRaMeshReliable::advance(RxPeer& peer) {
+    peer.expected++;
+    while (peer.received & 1) {
+        peer.received >>= 1;
+        peer.expected++;
+    }
+    peer.received >>= 1;
+}
+
+uint8_t LoRaMeshReliable::getBase(TxPeer& peer) {
+    uint8_t base = peer.nextSeq;
+    for (size_t i = 0; i < LORA_RELIABLE_TX_SLOTS; i++) {
+        TxFrame& txFrame = txFrames[i];
+        if (txFrame.used && &txPeers[txFrame.peer] == &peer && (int8_t) (txFrame.seq - base) < 0)
+            base = txFrame.seq;
+    }
+    return base;
+}
+
+void LoRaMeshReliable::seedRtt(TxPeer& peer, const RoutingTableSnapshot* routingTable) {
+    const RouteNode* route = routingTable->find(peer.dst);
+    if (!route || route->SRTT == 0)
+        return;
+
+    peer.srtt = route->SRTT;
+    peer.rttvar = route->RTTVAR;
+}
+
+uint32_t LoRaMeshReliable::getRto(TxPeer& peer) {
+    if (peer.srtt == 0)
+        return LORA_RELIABLE_RTO;
+
+    uint32_t rto = peer.srtt + 4 * peer.rttvar;
+    if (rto < LORA_RELIABLE_MIN_RTO)
+        return LORA_RELIABLE_MIN_RTO;
+    if (rto > LORA_RELIABLE_MAX_RTO)
+        return LORA_RELIABLE_MAX_RTO;
+    return rto;
+}
+
+uint8_t LoRaMeshReliable::getWindow(TxPeer& peer) {
+    uint32_t window = LORA_RELIABLE_INITIAL_WINDOW;
+
+    if (peer.srtt > 0 && peer.frameAirtime > 0) {
+        // Frames that fit in one round trip, fewer when the RTT is unstable
+        window = (uint64_t) peer.srtt * 1000 / peer.frameAirtime;
+        if (4 * peer.rttvar > peer.srtt)
+            window /= 2;
+    }
+
+    if (window > peer.cwnd)
+        window = peer.cwnd;
+    if (window > LORA_RELIABLE_WINDOW)
+        window = LORA_RELIABLE_WINDOW;
+
+    return window > 0 ? window : 1;
+}
+
+void LoRaMeshReliable::sendWindows() {
+    for (size_t p = 0; p < LORA_RELIABLE_PEERS; p++) {
+        TxPeer& peer = txPeers[p];
+        if (!peer.used || peer.queued == peer.inFlight)
+            continue;
+
+        uint8_t window = getWindow(peer);
+        uint8_t base = getBase(peer);
+
+        while (peer.inFlight < window) {
+            // Oldest frame not sent yet, it must fit in the acknowledgement bitmap
+            TxFrame* next = nullptr;
+            for (size_t i = 0; i < LORA_RELIABLE_TX_SLOTS; i++) {
+                TxFrame& txFrame = txFrames[i];
+                if (txFrame.used && !txFrame.sent && txFrame.peer == p &&
+                    (!next || (int8_t) (txFrame.seq - next->seq) < 0))
+                    next = &txFrame;
+            }
+
+            if (!next || (uint8_t) (next->seq - base) >= 32)
+                break;
+
+            sendTxFrame(*next);
+        }
+    }
+}
+
+void LoRaMeshReliable::sendTxFrame(TxFrame& txFrame) {
+    TxPeer& peer = txPeers[txFrame.peer];
+
+    LoRaReliableHeader* header = (LoRaReliableHeader*) ((LoRaMeshMessage*) txFrame.data)->dataMessage;
+    header->base = getBase(peer);
+
+    bool first = !txFrame.sent;
+    LoRaMeshService::getInstance().sendFrame(peer.dst, txFrame.data, txFrame.size, first ? txFrame.appBytes : 0, false);
+    txFrame.sentAt = millis();
+    peer.lastActive = txFrame.sentAt;
+
+    if (!first) {
+        framesResent++;
+        return;
+    }
+
+    txFrame.sent = true;
+    peer.inFlight++;
+    framesSent++;
+
+    uint32_t airtime = LoRaAirtime::getFrameTimeOnAir(txFrame.size);
+    peer.frameAirtime = peer.frameAirtime == 0 ? airtime : (7 * peer.frameAirtime + airtime) / 8;
+}
+
+void LoRaMeshReliable::releaseTxFrame(TxFrame& txFrame) {
+    TxPeer& peer = txPeers[txFrame.peer];
+    if (txFrame.sent)
+        peer.inFlight--;
+    peer.queued--;
+    txFrame.used = false;
+}
+
+void LoRaMeshReliable::processAck(uint16_t src, uint8_t epoch, uint8_t cumulative, LoRaReliableAck* ack) {
+    TxPeer* peer = nullptr;
+    for (size_t i = 0; i < LORA_RELIABLE_PEERS; i++) {
+        if (txPeers[i].used && txPeers[i].dst == src && txPeers[i].epoch == epoch) {
+            peer = &txPeers[i];
+            break;
+        }
+    }
+
+    if (!peer)
+        return;
+
+    uint32_t now = millis();
+    peer->lastActive = now;
+
+    for (size_t i = 0; i < LORA_RELIABLE_TX_SLOTS; i++) {
+        TxFrame& txFrame = txFrames[i];
+        if (!txFrame.used || !txFrame.sent || &txPeers[txFrame.peer] != peer)
+            continue;
+
+        int8_t offset = (int8_t) (txFrame.seq - cumulative);
+        bool acked = offset < 0 || (offset > 0 && offset <= 32 && (ack->received & (1u << (offset - 1))));
+
+        if (!acked) {
+            // A later frame arrived, this one is lost: do not wait for its RTO
+            if (offset == 0 && ack->received != 0 && !txFrame.fastRetransmitted && txFrame.retries < LORA_RELIABLE_RETRIES) {
+                txFrame.fastRetransmitted = true;
+                txFrame.retries++;
+                sendTxFrame(txFrame);
+            }
+            continue;
+        }
+
+        // Karn: the retransmitted frames do not tell which copy was acknowledged
+        if (txFrame.retries == 0)
+            sampleRtt(*peer, now - txFrame.sentAt);
+
+        LoRaMeshService::getInstance().recordDelivery(peer->dst, txFrame.retries + 1, true);
+
+        if (peer->cwnd < LORA_RELIABLE_WINDOW)
+            peer->cwnd += 1.0f / peer->cwnd;
+
+        framesAcked++;
+        releaseTxFrame(txFrame);
+    }
+
+    sendWindows();
+}
+
+void LoRaMeshReliable::sampleRtt(TxPeer& peer, uint32_t rtt) {
+    rttSamples++;
+
+    if (peer.srtt == 0) {
+        peer.srtt = rtt;
+        peer.rttvar = rtt / 2;
+        return;
+    }
+
+    uint32_t delta = rtt > peer.srtt ? rtt - peer.srtt : peer.srtt - rtt;
+    peer.rttvar = (3 * peer.rttvar + delta) / 4;
+    peer.srtt = (7 * peer.srtt + rtt) / 8;
+}
+
+void LoRaMeshReliable::sendAck(RxPeer& peer) {
+    uint8_t frame[LORA_RELIABLE_HEADER_SIZE + sizeof(LoRaReliableAck)];
+    LoRaMeshMessage* loraMeshMessage = (LoRaMeshMessage*) frame;
+    loraMeshMessage->appPortDst = LoRaReliableApp;
+    loraMeshMessage->appPortSrc = LoRaReliableApp;
+    loraMeshMessage->messageId = peer.expected;
+
+    LoRaReliableHeader* header = (LoRaReliableHeader*) loraMeshMessage->dataMessage;
+    header->type = ReliableAck;
+    header->epoch = peer.epoch;
+    header->base = 0;
+
+    LoRaReliableAck* ack = (LoRaReliableAck*) (header + 1);
+    ack->received = peer.received;
+
+    LoRaMeshService::getInstance().sendFrame(peer.src, frame, sizeof(frame), 0, false);
+    peer.unacked = 0;
+    acksSent++;
+}
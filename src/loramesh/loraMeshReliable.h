@@ -0,0 +1,152 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "loraMeshMessage.h"
+
+#include "routingSnapshot.h"
+
+static_assert(LORA_RELIABLE_WINDOW <= 32, "The acknowledgement bitmaps are 32 bits");
+
+/**
+ * @brief Reliable delivery with several frames in flight to each destination
+ *
+ * Frames get a sequence number per destination and are sent unreliably. The receiver answers with the
+ * next sequence number it expects and a bitmap of the frames received after it, every
+ * LORA_RELIABLE_ACK_EVERY frames, after LORA_RELIABLE_ACK_DELAY, or at once when a frame is missing.
+ * The sender sends again the frames not acknowledged after the RTO, and the first missing one as soon as
+ * a later one is acknowledged.
+ * The RTT estimate starts from the SRTT and RTTVAR of the route and is updated with the ACKs. The window
+ * is the frames that fit in one SRTT, halved when RTTVAR is high, and it is also limited by a congestion
+ * window that grows with the ACKs and is halved on a timeout.
+ */
+class LoRaMeshReliable {
+public:
+    LoRaMeshReliable();
+
+    /**
+     * @brief Queue a frame, it is sent when the window of its destination has space
+     *
+     * @param dst Destination, not broadcast
+     * @param frame Frame, it is copied
+     * @param frameSize Size of the frame
+     * @param appBytes Application bytes of the frame, for the statistics
+     * @return true If it has been queued
+     * @return false If it is too big or all the slots are busy
+     */
+    bool send(uint16_t dst, uint8_t* frame, size_t frameSize, uint32_t appBytes);
+
+    /**
+     * @brief If a frame can be queued without waiting
+     */
+    bool hasSpace();
+
+    /**
+     * @brief Process a frame addressed to LoRaReliableApp
+     *
+     * @param src Address of the sender
+     * @param frame Frame
+     * @param frameSize Size of the frame
+     * @param data Frame carried, it points inside frame
+     * @param dataSize Size of the frame carried
+     * @return true If it carries a frame received for the first time
+     */
+    bool receive(uint16_t src, LoRaMeshMessage* frame, uint32_t frameSize, uint8_t*& data, uint32_t& dataSize);
+
+    /**
+     * @brief Send the frames that fit in the windows, the retransmissions and the delayed ACKs
+     */
+    void poll();
+
+    String getStats();
+
+private:
+    struct TxPeer {
+        uint16_t dst;
+        uint8_t epoch;
+        uint8_t nextSeq;
+        uint8_t queued;
+        uint8_t inFlight;
+        float cwnd;
+        uint32_t srtt; //ms, 0 until the first sample
+        uint32_t rttvar; //ms
+        uint32_t lastLoss;
+        uint32_t lastActive;
+        uint32_t frameAirtime; //us, average
+        bool used;
+    };
+
+    struct TxFrame {
+        uint8_t peer;
+        uint8_t seq;
+        uint8_t retries;
+        bool sent;
+        bool fastRetransmitted;
+        bool used;
+        uint32_t sentAt;
+        uint32_t appBytes;
+        uint16_t size;
+        uint8_t data[sizeof(LoRaMeshMessage) + sizeof(LoRaReliableHeader) + LORA_RELIABLE_FRAME_SIZE];
+    };
+
+    struct RxPeer {
+        uint16_t src;
+        uint8_t epoch;
+        uint8_t expected;
+        uint8_t highest;
+        uint32_t received; //Bitmap after expected, bit 0 is expected + 1
+        uint8_t unacked;
+        uint32_t firstUnacked;
+        uint32_t lastActive;
+        bool used;
+    };
+
+    TxPeer txPeers[LORA_RELIABLE_PEERS] = {};
+
+    TxFrame txFrames[LORA_RELIABLE_TX_SLOTS] = {};
+
+    RxPeer rxPeers[LORA_RELIABLE_PEERS] = {};
+
+    uint8_t nextEpoch;
+
+    SemaphoreHandle_t reliableMutex;
+
+    uint32_t framesSent = 0;
+    uint32_t framesResent = 0;
+    uint32_t framesAcked = 0;
+    uint32_t framesFailed = 0;
+    uint32_t framesRejected = 0;
+    uint32_t acksSent = 0;
+    uint32_t framesReceived = 0;
+    uint32_t duplicates = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t rttSamples = 0;
+
+    TxPeer* getTxPeer(uint16_t dst);
+
+    RxPeer* getRxPeer(uint16_t src, uint8_t epoch, uint8_t base);
+
+    static void advance(RxPeer& peer);
+
+    uint8_t getBase(TxPeer& peer);
+
+    void seedRtt(TxPeer& peer, const RoutingTableSnapshot* routingTable);
+
+    uint32_t getRto(TxPeer& peer);
+
+    uint8_t getWindow(TxPeer& peer);
+
+    void sendWindows();
+
+    void sendTxFrame(TxFrame& txFrame);
+
+    void releaseTxFrame(TxFrame& txFrame);
+
+    void processAck(uint16_t src, uint8_t epoch, uint8_t cumulative, LoRaReliableAck* ack);
+
+    void sampleRtt(TxPeer& peer, uint32_t rtt);
+
+    void sendAck(RxPeer& peer);
+};
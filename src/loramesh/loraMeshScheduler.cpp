@@ -0,0 +1,208 @@
+#include "loraMeshScheduler.h"
+
+#include "message/messageManager.h"
+
+static const char* SCHED_TAG = "LoRaMeshScheduler";
+
+static const uint8_t defaultWeights[LORA_SCHEDULER_CLASSES] = LORA_SCHEDULER_WEIGHTS;
+static const uint8_t defaultLimits[LORA_SCHEDULER_CLASSES] = LORA_SCHEDULER_LIMITS;
+
+LoRaMeshScheduler::LoRaMeshScheduler() {
+    for (uint8_t i = 0; i < LORA_SCHEDULER_CLASSES; i++)
+        setClass(i, defaultWeights[i], defaultLimits[i]);
+}
+
+uint8_t LoRaMeshScheduler::getClass(DataMessage* message) {
+    if (message->priority > DefaultPriority && message->priority <= LORA_SCHEDULER_CLASSES)
+        return message->priority - 1;
+
+    switch (message->appPortSrc) {
+        case SensorApp:
+        case MetadataApp:
+            return SensorPriority - 1;
+        case MonApp:
+            return MonitorPriority - 1;
+        case SimApp:
+            return BulkPriority - 1;
+        default:
+            return InteractivePriority - 1;
+    }
+}
+
+bool LoRaMeshScheduler::enqueue(DataMessage* message) {
+    MessagePool& pool = MessageManager::getInstance().pool;
+    uint8_t trafficClass = getClass(message);
+    ClassQueue& queue = queues[trafficClass];
+
+    portENTER_CRITICAL(&schedulerMux);
+    bool full = queue.count >= queue.limit;
+    if (full)
+        queue.dropped++;
+    portEXIT_CRITICAL(&schedulerMux);
+
+    if (full) {
+        ESP_LOGW(SCHED_TAG, "Class %d queue full, message dropped", trafficClass);
+        return false;
+    }
+
+    DataMessage* queuedMessage = message;
+    if (pool.owns(message)) {
+        pool.retain(message);
+    }
+    else {
+        queuedMessage = (DataMessage*) pool.alloc(message->getDataMessageSize());
+        if (!queuedMessage) {
+            ESP_LOGE(SCHED_TAG, "Not enough memory to queue the message");
+            return false;
+        }
+        memcpy(queuedMessage, message, message->getDataMessageSize());
+    }
+
+    portENTER_CRITICAL(&schedulerMux);
+    if (queue.count >= queue.limit) {
+        queue.dropped++;
+        portEXIT_CRITICAL(&schedulerMux);
+        pool.release(queuedMessage);
+        return false;
+    }
+    QueuedMessage& entry = queue.messages[(queue.head + queue.count) % LORA_SCHEDULER_QUEUE_SIZE];
+    entry.message = queuedMessage;
+    entry.enqueuedAt = millis();
+    queue.count++;
+    waiting++;
+    portEXIT_CRITICAL(&schedulerMux);
+
+    return true;
+}
+
+DataMessage* LoRaMeshScheduler::dequeue(uint8_t classes) {
+    if (classes > LORA_SCHEDULER_CLASSES)
+        classes = LORA_SCHEDULER_CLASSES;
+
+    for (;;) {
+        bool expired;
+        DataMessage* message = dequeueNext(classes, expired);
+        if (!expired)
+            return message;
+
+        TRACE("Message %X:%d expired in the LoRa queue", message->addrSrc, message->messageId);
+        MessageManager::getInstance().pool.release(message);
+    }
+}
+
+DataMessage* LoRaMeshScheduler::dequeueNext(uint8_t classes, bool& expired) {
+    expired = false;
+
+    portENTER_CRITICAL(&schedulerMux);
+
+    size_t served = 0;
+    for (uint8_t i = 0; i < LORA_SCHEDULER_CLASSES; i++) {
+        ClassQueue& queue = queues[i];
+        if (i < classes) {
+            served += queue.count;
+            continue;
+        }
+
+        // Every message is counted once, when it is deferred at the head of its queue
+        if (queue.count > 0 && queue.messages[queue.head].message != queue.lastDeferred) {
+            queue.lastDeferred = queue.messages[queue.head].message;
+            queue.deferred++;
+        }
+    }
+
+    if (served == 0) {
+        portEXIT_CRITICAL(&schedulerMux);
+        return nullptr;
+    }
+
+    // Deficit round robin, every turn a class earns weight * quantum bytes
+    for (;;) {
+        ClassQueue& queue = queues[current];
+
+        if (queue.count == 0 || current >= classes) {
+            queue.deficit = 0;
+            turnStarted = false;
+            current = (current + 1) % LORA_SCHEDULER_CLASSES;
+            continue;
+        }
+
+        if (!turnStarted) {
+            queue.deficit += (int32_t) queue.weight * LORA_SCHEDULER_QUANTUM;
+            turnStarted = true;
+        }
+
+        QueuedMessage& entry = queue.messages[queue.head];
+
+        if (entry.message->isExpired()) {
+            // It does not use the deficit, the class keeps its turn
+            queue.head = (queue.head + 1) % LORA_SCHEDULER_QUEUE_SIZE;
+            queue.count--;
+            waiting--;
+            queue.expired++;
+            expired = true;
+
+            DataMessage* message = entry.message;
+            portEXIT_CRITICAL(&schedulerMux);
+            return message;
+        }
+
+        int32_t size = entry.message->messageSize;
+
+        if (size <= queue.deficit) {
+            queue.deficit -= size;
+            queue.head = (queue.head + 1) % LORA_SCHEDULER_QUEUE_SIZE;
+            queue.count--;
+            waiting--;
+
+            uint32_t latency = millis() - entry.enqueuedAt;
+            queue.sent++;
+            queue.totalLatency += latency;
+            if (latency > queue.maxLatency)
+                queue.maxLatency = latency;
+
+            DataMessage* message = entry.message;
+            portEXIT_CRITICAL(&schedulerMux);
+            return message;
+        }
+
+        turnStarted = false;
+        current = (current + 1) % LORA_SCHEDULER_CLASSES;
+    }
+}
+
+size_t LoRaMeshScheduler::size() {
+    return waiting;
+}
+
+uint32_t LoRaMeshScheduler::getDeferred() {
+    uint32_t deferred = 0;
+    for (uint8_t i = 0; i < LORA_SCHEDULER_CLASSES; i++)
+        deferred += queues[i].deferred;
+    return deferred;
+}
+
+bool LoRaMeshScheduler::setClass(uint8_t trafficClass, uint8_t weight, uint8_t limit) {
+    if (trafficClass >= LORA_SCHEDULER_CLASSES || weight == 0 || limit == 0 || limit > LORA_SCHEDULER_QUEUE_SIZE)
+        return false;
+
+    portENTER_CRITICAL(&schedulerMux);
+    queues[trafficClass].weight = weight;
+    queues[trafficClass].limit = limit;
+    portEXIT_CRITICAL(&schedulerMux);
+
+    return true;
+}
+
+String LoRaMeshScheduler::getStats() {
+    String stats = "";
+    for (uint8_t i = 0; i < LORA_SCHEDULER_CLASSES; i++) {
+        ClassQueue& queue = queues[i];
+        uint32_t averageLatency = queue.sent > 0 ? queue.totalLatency / queue.sent : 0;
+
+        stats += "Class " + String(i) + " (weight " + String(queue.weight) + ", limit " + String(queue.limit) + "): " +
+            "waiting " + String(queue.count) + ", sent " + String(queue.sent) + ", dropped " + String(queue.dropped) +
+            ", expired " + String(queue.expired) + ", deferred " + String(queue.deferred) +
+            ", latency avg " + String(averageLatency) + " ms, max " + String(queue.maxLatency) + " ms\n";
+    }
+    return stats;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include "message/dataMessage.h"
+
+#define LORA_SCHEDULER_CLASSES 4
+
+/**
+ * @brief Weighted fair queuing of the outbound LoRa messages
+ *
+ * Every traffic class has its own bounded FIFO. The classes are served with deficit round robin, so each
+ * one gets a share of the bytes sent proportional to its weight, and a burst of telemetry cannot delay
+ * interactive commands for more than one quantum.
+ * The queues keep references to pool buffers, the caller releases the messages returned by dequeue.
+ */
+class LoRaMeshScheduler {
+public:
+    LoRaMeshScheduler();
+
+    /**
+     * @brief Add the message to the queue of its class
+     *
+     * @param message Message, it is retained or copied into the message pool
+     * @return true If it has been queued
+     * @return false If the queue of its class is full
+     */
+    bool enqueue(DataMessage* message);
+
+    /**
+     * @brief Get the next message to be sent, the expired ones are dropped
+     *
+     * @param classes Only the classes below it are served, the others are deferred
+     * @return DataMessage* Message or nullptr if the queues of the classes served are empty
+     */
+    DataMessage* dequeue(uint8_t classes = LORA_SCHEDULER_CLASSES);
+
+    size_t size();
+
+    /**
+     * @brief Messages that have been held back because their class was not served
+     */
+    uint32_t getDeferred();
+
+    /**
+     * @brief Set the share and the queue limit of a class
+     *
+     * @param trafficClass Class, from 0 (interactive) to LORA_SCHEDULER_CLASSES - 1 (bulk)
+     * @param weight Share of the airtime, at least 1
+     * @param limit Maximum messages waiting, at most LORA_SCHEDULER_QUEUE_SIZE
+     * @return true If the values are valid
+     */
+    bool setClass(uint8_t trafficClass, uint8_t weight, uint8_t limit);
+
+    static uint8_t getClass(DataMessage* message);
+
+    String getStats();
+
+private:
+    struct QueuedMessage {
+        DataMessage* message;
+        uint32_t enqueuedAt;
+    };
+
+    struct ClassQueue {
+        QueuedMessage messages[LORA_SCHEDULER_QUEUE_SIZE];
+        uint8_t head = 0;
+        uint8_t count = 0;
+        uint8_t weight = 1;
+        uint8_t limit = LORA_SCHEDULER_QUEUE_SIZE;
+        int32_t deficit = 0;
+
+        uint32_t sent = 0;
+        uint32_t dropped = 0;
+        uint32_t expired = 0;
+        uint32_t deferred = 0;
+        DataMessage* lastDeferred = nullptr;
+        uint32_t totalLatency = 0;
+        uint32_t maxLatency = 0;
+    };
+
+    ClassQueue queues[LORA_SCHEDULER_CLASSES];
+
+    uint8_t current = 0;
+
+    bool turnStarted = false;
+
+    size_t waiting = 0;
+
+    portMUX_TYPE schedulerMux = portMUX_INITIALIZER_UNLOCKED;
+
+    DataMessage* dequeueNext(uint8_t classes, bool& expired);
+};
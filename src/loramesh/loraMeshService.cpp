@@ -15,11 +15,15 @@ void LoRaMeshService::initLoraMesherService() {
     config.loraIrq = LORA_IRQ;
     config.loraIo1 = LORA_IO1;
     config.sf = LM_CONFIG_LORASF ;
-    config.power = LM_CONFIG_POWER ;
+    config.power = ConfigService::getInstance().getConfig("loraPower", String(LM_CONFIG_POWER)).toInt();
+    config.bw = LM_CONFIG_BANDWIDTH / 1000.0;
+    config.cr = LM_CONFIG_CR;
         
     ESP_LOGV(LMS_TAG, "LoraMesher config: CS: %d, RST: %d, IRQ: %d, IO1: %d, SF: %d, power: %d",
              config.loraCs, config.loraRst, config.loraIrq, config.loraIo1, config.sf, config.power);
 
+    adr.begin(config.sf, config.power);
+
 #ifdef LORA_MODULE_SX1276
     config.module = LoraMesher::LoraModules::SX1276_MOD;
 #elif defined(LORA_MODULE_SX1262)
@@ -46,33 +50,124 @@ void LoRaMeshService::initLoraMesherService() {
     //Start LoRaMesher
     radio.start();
 
+    //Create the task that feeds LoRaMesher from the scheduler
+    createSendMessages();
+
     ESP_LOGV(LMS_TAG, "LoraMesher initialized");
 #endif
 
 }
 
 void LoRaMeshService::loopReceivedPackets() {
-    //Iterate through all the packets inside the Received User Packets FiFo
+    uint32_t budgetStart = millis();
+
+    //Iterate through all the packets inside the Received User Packets FiFo, a batch at a time
     while (radio.getReceivedQueueSize() > 0) {
-        ESP_LOGV(LMS_TAG, "LoRaPacket received");
-        ESP_LOGV(LMS_TAG, "Queue receiveUserData size: %d", radio.getReceivedQueueSize());
-        ESP_LOGV(LMS_TAG, "Heap size receive: %d", ESP.getFreeHeap());
-        //Get the first element inside the Received User Packets FiFo
-        AppPacket<LoRaMeshMessage>* packet = radio.getNextAppPacket<LoRaMeshMessage>();
-        //Create a DataMessage from the received packet
-        DataMessage* message = createDataMessage(packet);
-        //Delete the packet when used. It is very important to call this function to release the memory of the packet.
-        radio.deletePacket(packet);
-        if(message) {
-          //Process the packet
-          MessageManager::getInstance().processReceivedMessage(LoRaMeshPort, message);
-          //Delete the message
-          vPortFree(message);
+        size_t queueSize = radio.getReceivedQueueSize();
+        if (queueSize > maxReceiveQueue)
+            maxReceiveQueue = queueSize;
+        TRACE("LoRaPacket received, queue %d, heap %d", queueSize, ESP.getFreeHeap());
+
+        uint32_t batchStart = millis();
+        for (uint8_t i = 0; i < LORA_RECEIVE_BATCH && radio.getReceivedQueueSize() > 0; i++) {
+            //Get the first element inside the Received User Packets FiFo
+            AppPacket<LoRaMeshMessage>* packet = radio.getNextAppPacket<LoRaMeshMessage>();
+            decodePacket(packet);
+            //Delete the packet when used. It is very important to call this function to release the memory of the packet.
+            radio.deletePacket(packet);
+            receivedPackets++;
+        }
+        processBatch();
+
+        uint32_t batchTime = millis() - batchStart;
+        receiveBatches++;
+        receiveTime += batchTime;
+        if (batchTime > maxBatchTime)
+            maxBatchTime = batchTime;
+
+        if (millis() - budgetStart >= LORA_RECEIVE_BUDGET && radio.getReceivedQueueSize() > 0) {
+            //Let the routing and the other tasks run before the next batch
+            receiveYields++;
+            vTaskDelay(1);
+            budgetStart = millis();
         }
-        ESP_LOGV(LMS_TAG, "Heap size receive2: %d", ESP.getFreeHeap());
     }
 }
 
+void LoRaMeshService::decodePacket(AppPacket<LoRaMeshMessage>* packet) {
+    decodeFrame(packet->src, packet->dst, (uint8_t*) packet->payload, packet->payloadSize);
+}
+
+void LoRaMeshService::decodeFrame(uint16_t src, uint16_t dst, uint8_t* data, uint32_t size) {
+    //Create a DataMessage from the received frame, fragments are only returned when the message is complete
+    LoRaMeshMessage* frame = (LoRaMeshMessage*) data;
+    DataMessage* message = nullptr;
+    if (size < sizeof(LoRaMeshCompactMessage)) {
+        ESP_LOGW(LMS_TAG, "LoRaPacket too small: %d bytes", size);
+    }
+    else if (frame->appPortDst == LoRaReliableApp) {
+        uint8_t* carried;
+        uint32_t carriedSize;
+        if (reliability.receive(src, frame, size, carried, carriedSize))
+            decodeFrame(src, dst, carried, carriedSize);
+    }
+    else if (frame->appPortDst == LoRaContainerApp) {
+        FrameAddress address = {src, dst};
+        LoRaMeshCoalescer::unpack(frame, size, processContainerEntry, &address);
+    }
+    else if (frame->appPortDst == LoRaFragmentApp) {
+        message = fragmenter.receive(src, dst, frame, size);
+    }
+    else {
+        message = createDataMessage(src, dst, data, size);
+    }
+
+    if (message)
+        addToBatch(message);
+}
+
+void LoRaMeshService::processContainerEntry(uint8_t* entry, uint32_t size, void* arg) {
+    FrameAddress* address = (FrameAddress*) arg;
+    LoRaMeshService& service = LoRaMeshService::getInstance();
+
+    DataMessage* message = service.createDataMessage(address->src, address->dst, entry, size);
+    if (message)
+        service.addToBatch(message);
+}
+
+void LoRaMeshService::addToBatch(DataMessage* message) {
+    //A container can hold more messages than a batch
+    if (receiveBatchSize == LORA_RECEIVE_BATCH)
+        processBatch();
+
+    receiveBatch[receiveBatchSize++] = message;
+}
+
+void LoRaMeshService::processBatch() {
+    if (receiveBatchSize == 0)
+        return;
+
+    MessageManager& manager = MessageManager::getInstance();
+    manager.processReceivedMessages(LoRaMeshPort, receiveBatch, receiveBatchSize);
+
+    //Release the messages, services that still need them have retained them
+    for (uint8_t i = 0; i < receiveBatchSize; i++)
+        manager.pool.release(receiveBatch[i]);
+
+    receivedMessages += receiveBatchSize;
+    receiveBatchSize = 0;
+}
+
+String LoRaMeshService::getReceiveStats() {
+    uint32_t averagePackets = receiveBatches > 0 ? receivedPackets / receiveBatches : 0;
+    uint32_t averageTime = receiveBatches > 0 ? receiveTime / receiveBatches : 0;
+
+    return "Packets received: " + String(receivedPackets) + ", messages " + String(receivedMessages) + "\n" +
+        "Batches: " + String(receiveBatches) + ", avg " + String(averagePackets) + " packets\n" +
+        "Batch time: avg " + String(averageTime) + " ms, max " + String(maxBatchTime) + " ms\n" +
+        "Receive queue: max " + String(maxReceiveQueue) + " packets, yields " + String(receiveYields) + "\n";
+}
+
 /**
  * @brief Function that process the received packets
  *
@@ -107,37 +202,120 @@ void LoRaMeshService::createReceiveMessages() {
     radio.setReceiveAppDataTaskHandle(receiveLoRaMessage_Handle);
 }
 
-LoRaMeshMessage* LoRaMeshService::createLoRaMeshMessage(DataMessage* message) {
-    LoRaMeshMessage* loraMeshMessage = (LoRaMeshMessage*) pvPortMalloc(sizeof(LoRaMeshMessage) + message->messageSize);
+void LoRaMeshService::loopSendPackets() {
+    MessagePool& pool = MessageManager::getInstance().pool;
 
-    if (loraMeshMessage) {
-        loraMeshMessage->appPortDst = message->appPortDst;
-        loraMeshMessage->appPortSrc = message->appPortSrc;
-        loraMeshMessage->messageId = message->messageId;
-        memcpy(loraMeshMessage->dataMessage, message->message, message->messageSize);
+    fragmenter.poll();
+
+    reliability.poll();
+
+    coalescer.poll();
+
+    if (adr.isSampleDue()) {
+        const RoutingTableSnapshot* routingTable = routingSnapshot.acquire();
+        adr.sample(routingTable);
+        routingSnapshot.release(routingTable);
     }
 
-    return loraMeshMessage;
+    if (linkEstimator.isSampleDue()) {
+        const RoutingTableSnapshot* routingTable = routingSnapshot.acquire();
+        linkEstimator.sample(routingTable);
+        routingSnapshot.release(routingTable);
+    }
+
+    while (scheduler.size() > 0) {
+        //Keep the messages in the scheduler while LoRaMesher is busy, so they can still be reordered
+        if (radio.getSendQueueSize() >= LORA_SCHEDULER_RADIO_BACKLOG)
+            return;
+
+#ifdef LORA_RELIABLE_WINDOWED
+        if (SEND_RELIABLE && !reliability.hasSpace())
+            return;
+#endif
+
+        DataMessage* message = scheduler.dequeue(getDutyCycleClasses());
+        if (!message)
+            return;
+
+        transmit(message);
+        pool.release(message);
+
+        TaskHandle_t drainTask = sendDrainTask;
+        if (drainTask)
+            xTaskNotifyGive(drainTask);
+    }
+}
+
+/**
+ * @brief Function that sends the scheduled packets
+ *
+ */
+void processSendPackets(void*) {
+    for (;;) {
+        ESP_LOGV(LMS_TAG, "Stack space unused after entering the task: %d", uxTaskGetStackHighWaterMark(NULL));
+
+        /* Wait for a new message or poll until LoRaMesher has space */
+        ulTaskNotifyTake(pdTRUE, LORA_SCHEDULER_POLL_DELAY / portTICK_PERIOD_MS);
+        LoRaMeshService::getInstance().loopSendPackets();
+    }
 }
 
-DataMessage* LoRaMeshService::createDataMessage(AppPacket<LoRaMeshMessage>* appPacket) {
-    uint32_t messageSize = appPacket->payloadSize - sizeof(LoRaMeshMessage) ;
+/**
+ * @brief Create the Send Messages Task
+ *
+ */
+void LoRaMeshService::createSendMessages() {
+    int res = xTaskCreate(
+        processSendPackets,
+        "Send App Task",
+        4096,
+        (void*) 1,
+        2,
+        &sendLoRaMessage_Handle);
+    if (res != pdPASS) {
+        ESP_LOGE(LMS_TAG, "Send App Task creation gave error: %d", res);
+        sendLoRaMessage_Handle = NULL;
+    }
+}
+
+uint8_t* LoRaMeshService::createLoRaMeshMessage(DataMessage* message, size_t& frameSize) {
+    frameSize = getLoRaMeshHeaderSize(message->appPortDst, message->appPortSrc) + message->messageSize;
+    uint8_t* frame = (uint8_t*) MessageManager::getInstance().pool.alloc(frameSize);
+
+    if (frame) {
+        size_t headerSize = writeLoRaMeshHeader(frame, message->appPortDst, message->appPortSrc, message->messageId);
+        memcpy(frame + headerSize, message->message, message->messageSize);
+    }
+
+    return frame;
+}
+
+DataMessage* LoRaMeshService::createDataMessage(uint16_t src, uint16_t dst, uint8_t* frame, uint32_t frameSize) {
+    appPort appPortDst, appPortSrc;
+    uint8_t messageId;
+    size_t headerSize = readLoRaMeshHeader(frame, frameSize, appPortDst, appPortSrc, messageId);
+    if (headerSize == 0) {
+        ESP_LOGW(LMS_TAG, "Unknown LoRa header 0x%X from %X", frame[0], src);
+        return nullptr;
+    }
+
+    uint32_t messageSize = frameSize - headerSize ;
     uint32_t dataMessageSize = sizeof(DataMessage) + messageSize ;
-    DataMessage* dataMessage = (DataMessage*) pvPortMalloc(dataMessageSize);
+    DataMessage* dataMessage = (DataMessage*) MessageManager::getInstance().pool.alloc(dataMessageSize);
 
     if (dataMessage) {
-        LoRaMeshMessage* message = appPacket->payload;
-
-        dataMessage->appPortDst = message->appPortDst;
-        dataMessage->appPortSrc = message->appPortSrc;
-        dataMessage->messageId = message->messageId;
+        dataMessage->appPortDst = appPortDst;
+        dataMessage->appPortSrc = appPortSrc;
+        dataMessage->messageId = messageId;
 
-        dataMessage->addrSrc = appPacket->src;
-        dataMessage->addrDst = appPacket->dst;
+        dataMessage->addrSrc = src;
+        dataMessage->addrDst = dst;
 
         dataMessage->messageSize = messageSize;
-        ESP_LOGV(LMS_TAG, "LoRaMeshService::createDataMessage %d bytes", messageSize);
-        memcpy(dataMessage->message, message->dataMessage, messageSize);
+        dataMessage->priority = messagePriority::DefaultPriority;
+        dataMessage->deadline = 0;
+        TRACE("LoRaMeshService::createDataMessage %d bytes", messageSize);
+        memcpy(dataMessage->message, frame + headerSize, messageSize);
     }
     return dataMessage;
 }
@@ -149,60 +327,229 @@ uint16_t LoRaMeshService::getLocalAddress() {
 String LoRaMeshService::getRoutingTable() {
     String routingTable = "--- Routing Table ---\n";
 
-    //Set the routing table list that is being used and cannot be accessed (Remember to release use after usage)
+    const RoutingTableSnapshot* snapshot = routingSnapshot.acquire();
+    if (snapshot->truncated > 0) {
+        routingSnapshot.release(snapshot);
+        return getFullRoutingTable(routingTable);
+    }
+
+    routingTable.reserve(routingTable.length() + snapshot->size * 24);
+
+    for (uint16_t i = 0; i < snapshot->size; i++) {
+        const RouteNode& routeNode = snapshot->routes[i];
+        routingTable += String(routeNode.networkNode.address) + " (" + String(routeNode.networkNode.metric) + ") - Via: " + String(routeNode.via) + "\n";
+    }
+
+    if (snapshot->size == 0)
+        routingTable += "No routes";
+
+    routingSnapshot.release(snapshot);
+
+    return routingTable;
+}
+
+String LoRaMeshService::getFullRoutingTable(String& routingTable) {
+    //The table does not fit in the snapshot, copy the list of LoRaMesher
     LM_LinkedList<RouteNode>* routingTableList = radio.routingTableListCopy();
+    if (!routingTableList)
+        return routingTable + "Failed to get routing table copy";
 
     routingTableList->setInUse();
+    routingTable.reserve(routingTable.length() + routingTableList->getLength() * 24);
 
     if (routingTableList->moveToStart()) {
         do {
             RouteNode* routeNode = routingTableList->getCurrent();
-            NetworkNode node = routeNode->networkNode;
-            routingTable += String(node.address) + " (" + String(node.metric) + ") - Via: " + String(routeNode->via) + "\n";
+            routingTable += String(routeNode->networkNode.address) + " (" + String(routeNode->networkNode.metric) + ") - Via: " + String(routeNode->via) + "\n";
         } while (routingTableList->next());
     }
     else {
         routingTable += "No routes";
     }
 
-    //Release routing table list usage.
     routingTableList->releaseInUse();
-    
-    // routingTableList->Clear();
-    delete routingTableList ;
+    delete routingTableList;
 
     return routingTable;
 }
 
-void LoRaMeshService::send(DataMessage* message) {
-    ESP_LOGV(LMS_TAG, "Heap size send: %d", ESP.getFreeHeap()) ;
-    LoRaMeshMessage *loraMeshMessage = createLoRaMeshMessage(message);
-#if SEND_RELIABLE == 0
-    radio.createPacketAndSend(message->addrDst, (uint8_t *)loraMeshMessage,
-                                sizeof(LoRaMeshMessage) + message->messageSize);
-#else
-    radio.sendReliablePacket(message->addrDst, (uint8_t *)loraMeshMessage,
-                             sizeof(LoRaMeshMessage) + message->messageSize);
+bool LoRaMeshService::send(DataMessage* message) {
+    if (sendLoRaMessage_Handle == NULL) {
+        transmit(message);
+        return true;
+    }
+
+    if (!scheduler.enqueue(message))
+        return false;
+
+    xTaskNotifyGive(sendLoRaMessage_Handle);
+    return true;
+}
+
+String LoRaMeshService::getSchedulerStats() {
+    return scheduler.getStats();
+}
+
+String LoRaMeshService::setSchedulerClass(String args) {
+    int trafficClass, weight, limit;
+    if (sscanf(args.c_str(), "%d %d %d", &trafficClass, &weight, &limit) != 3)
+        return "Usage: /setClass <class> <weight> <limit>";
+
+    if (trafficClass < 0 || weight < 0 || limit < 0 || !scheduler.setClass(trafficClass, weight, limit))
+        return "Invalid class, weight or limit";
+
+    return "Class " + String(trafficClass) + " updated";
+}
+
+String LoRaMeshService::getFragmenterStats() {
+    return fragmenter.getStats();
+}
+
+String LoRaMeshService::getReliableStats() {
+    return reliability.getStats();
+}
+
+String LoRaMeshService::getCoalescerStats() {
+    portENTER_CRITICAL(&sendStatsMux);
+    uint32_t frames = framesSent;
+    uint32_t appBytes = appBytesSent;
+    uint32_t airtimeMs = airtimeUsed / 1000;
+    portEXIT_CRITICAL(&sendStatsMux);
+
+    uint32_t goodput = airtimeMs > 0 ? (uint64_t) appBytes * 1000 / airtimeMs : 0;
+
+    return coalescer.getStats() +
+        "Frames sent: " + String(frames) + ", app bytes " + String(appBytes) + "\n" +
+        "Airtime: " + String(airtimeMs) + " ms, goodput " + String(goodput) + " B/s of airtime\n";
+}
+
+void LoRaMeshService::transmit(DataMessage* message) {
+    if (LoRaMeshFragmenter::needsFragmentation(message)) {
+        fragmenter.send(message);
+        return;
+    }
+
+#ifdef LORA_COALESCE_ENABLED
+    // Only with the send task, which flushes the containers
+    if (sendLoRaMessage_Handle != NULL && coalescer.add(message, LoRaMeshScheduler::getClass(message)))
+        return;
 #endif
-    vPortFree(loraMeshMessage);
-    ESP_LOGV(LMS_TAG, "Heap size send 2: %d", ESP.getFreeHeap());
+
+    size_t frameSize;
+    uint8_t* frame = createLoRaMeshMessage(message, frameSize);
+    if (!frame) {
+        ESP_LOGE(LMS_TAG, "Not enough memory to send the message");
+        return;
+    }
+    sendFrame(message->addrDst, frame, frameSize, message->messageSize);
+    MessageManager::getInstance().pool.release(frame);
+    TRACE("LoRaMessage sent to %X, %d bytes, heap %d", message->addrDst, message->messageSize, ESP.getFreeHeap());
 }
 
-bool LoRaMeshService::sendClosestGateway(DataMessage* message) {
-    RouteNode* gatewayNode = radio.getClosestGateway();
+void LoRaMeshService::sendFrame(uint16_t dst, uint8_t* frame, size_t frameSize, uint32_t appBytes, bool reliable) {
+#ifdef LORA_RELIABLE_WINDOWED
+    //The windowed layer sends it back here unreliably, it falls back to LoRaMesher when it is full
+    if (reliable && dst != BROADCAST_ADDR && reliability.send(dst, frame, frameSize, appBytes))
+        return;
+#endif
 
-    if (!gatewayNode) {
-        ESP_LOGE(LMS_TAG, "No gateway found");
-        return false;
+    if (reliable)
+        radio.sendReliablePacket(dst, frame, frameSize);
+    else
+        radio.createPacketAndSend(dst, frame, frameSize);
+
+    uint32_t airtime = LoRaAirtime::getFrameTimeOnAir(frameSize);
+
+    //The receive task sends too, the ACKs and the forwarded frames
+    portENTER_CRITICAL(&sendStatsMux);
+    framesSent++;
+    appBytesSent += appBytes;
+    airtimeUsed += airtime;
+    portEXIT_CRITICAL(&sendStatsMux);
+    dutyCycle.add(airtime);
+
+    uint16_t nextHop = getNextHop(dst);
+    adr.account(nextHop, frameSize);
+    channelPlan.account(nextHop, airtime);
+}
+
+uint8_t LoRaMeshService::getDutyCycleClasses() {
+    static const uint32_t frameAirtime = LoRaAirtime::getFrameTimeOnAir(LORA_DUTY_CYCLE_FRAME);
+
+    // The thresholds grow with the class, the first one deferred defers the rest
+    uint8_t classes = 0;
+    while (classes < LORA_SCHEDULER_CLASSES && dutyCycle.allows(classes, frameAirtime))
+        classes++;
+    return classes;
+}
+
+String LoRaMeshService::getDutyCycleStats() {
+    return dutyCycle.getStats() + "Deferred messages: " + String(scheduler.getDeferred()) + "\n";
+}
+
+String LoRaMeshService::getChannelStats() {
+    const RoutingTableSnapshot* routingTable = routingSnapshot.acquire();
+    String stats = channelPlan.getStats(getLocalAddress(), routingTable);
+    routingSnapshot.release(routingTable);
+    return stats;
+}
+
+void LoRaMeshService::recordReception(uint16_t src, uint8_t received, uint8_t lost) {
+    if (getNextHop(src) == src)
+        linkEstimator.recordReception(src, received, lost);
+}
+
+void LoRaMeshService::recordDelivery(uint16_t dst, uint8_t transmissions, bool delivered) {
+    //The ACKs are end to end, a multi-hop outcome would be charged to the first link alone
+    if (getNextHop(dst) == dst)
+        linkEstimator.recordDelivery(dst, transmissions, delivered);
+}
+
+uint16_t LoRaMeshService::getNextHop(uint16_t dst) {
+    if (dst == BROADCAST_ADDR)
+        return dst;
+
+    const RoutingTableSnapshot* routingTable = routingSnapshot.acquire();
+    const RouteRecord* route = routingTable->index.find(dst);
+    uint16_t via = route ? route->via : dst;
+    bool truncated = routingTable->truncated > 0;
+    routingSnapshot.release(routingTable);
+
+    //The route can be one of those that did not fit in the snapshot
+    if (!route && truncated) {
+        uint16_t nextHop = RoutingTableService::getNextHop(dst);
+        if (nextHop != 0)
+            via = nextHop;
     }
+    return via;
+}
+
+String LoRaMeshService::applyAdrPower() {
+    int8_t power = adr.getNodePower();
+    ConfigService::getInstance().setConfig("loraPower", String(power));
+    return "TX power " + String(power) + " dBm saved, used after a reboot";
+}
 
-    message->addrDst = gatewayNode->networkNode.address;
+bool LoRaMeshService::sendClosestGateway(DataMessage* message) {
+    const RoutingTableSnapshot* routingTable = routingSnapshot.acquire();
+    uint16_t gateway = gatewaySelector.select(message, routingTable);
+    routingSnapshot.release(routingTable);
+
+    if (gateway == 0) {
+        //The snapshot can be older than a gateway that has just appeared
+        RouteNode* gatewayNode = radio.getClosestGateway();
+        if (!gatewayNode) {
+            ESP_LOGE(LMS_TAG, "No gateway found");
+            return false;
+        }
+        gateway = gatewayNode->networkNode.address;
+    }
 
-    ESP_LOGI(LMS_TAG, "Sending message to gateway %X", message->addrDst);
+    message->addrDst = gateway;
 
-    send(message);
+    TRACE("Sending message to gateway %X", message->addrDst);
 
-    return true;
+    return send(message);
 }
 
 bool LoRaMeshService::hasActiveConnections() {
@@ -222,6 +569,7 @@ void LoRaMeshService::standby() {
 }
 
 bool LoRaMeshService::hasGateway() {
+    // Asked LoRaMesher directly, the snapshot holds a bounded number of routes and is rebuilt periodically
     RouteNode* gatewayNode = radio.getClosestGateway();
 
     return gatewayNode != nullptr;
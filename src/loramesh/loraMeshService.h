@@ -14,6 +14,30 @@
 
 #include "loraMeshCommandService.h"
 
+#include "loraMeshScheduler.h"
+
+#include "loraMeshFragmenter.h"
+
+#include "loraMeshCoalescer.h"
+
+#include "loraMeshReliable.h"
+
+#include "loraAirtime.h"
+
+#include "routingSnapshot.h"
+
+#include "gatewaySelector.h"
+
+#include "loraAdr.h"
+
+#include "loraDutyCycle.h"
+
+#include "linkEstimator.h"
+
+#include "channelPlan.h"
+
+#include "configuration/configService.h"
+
 
 class LoRaMeshService: public MessageService {
 
@@ -34,10 +58,120 @@ public:
 
     void loopReceivedPackets();
 
+    void loopSendPackets();
+
     String getRoutingTable();
 
-    void send(DataMessage* message);
+    /**
+     * @brief Get the routing table without copying it, give it back with releaseRoutingTable()
+     *
+     * @return const RoutingTableSnapshot* Snapshot, it does not change while it is held
+     */
+    const RoutingTableSnapshot* acquireRoutingTable() {
+        return routingSnapshot.acquire();
+    }
+
+    void releaseRoutingTable(const RoutingTableSnapshot* snapshot) {
+        routingSnapshot.release(snapshot);
+    }
+
+    String getRoutingStats() {
+        return routingSnapshot.getStats();
+    }
+
+    String getGatewayStats() {
+        return gatewaySelector.getStats();
+    }
+
+    String getAdrStats() {
+        return adr.getStats();
+    }
+
+    String getDutyCycleStats();
+
+    String getChannelStats();
+
+    /**
+     * @brief Account frames received from a node, only the neighbors are estimated
+     *
+     */
+    void recordReception(uint16_t src, uint8_t received, uint8_t lost);
+
+    /**
+     * @brief Account the outcome of a frame sent to a node, only the neighbors are estimated
+     *
+     */
+    void recordDelivery(uint16_t dst, uint8_t transmissions, bool delivered);
+
+    /**
+     * @brief Expected transmissions to deliver a frame to a neighbor
+     *
+     * @return uint16_t ETX * 100
+     */
+    uint16_t getLinkEtx(uint16_t neighbor) {
+        return linkEstimator.getEtx(neighbor);
+    }
+
+    String getLinkStats() {
+        return linkEstimator.getStats();
+    }
+
+    /**
+     * @brief Budget of airtime left in the duty cycle window
+     *
+     * @return uint16_t Permille of the budget
+     */
+    uint16_t getDutyCycleLeft() {
+        return dutyCycle.getRemaining();
+    }
+
+    uint32_t getDeferred() {
+        return scheduler.getDeferred();
+    }
+
+    /**
+     * @brief Store the TX power chosen by the ADR, it is used from the next boot
+     *
+     */
+    String applyAdrPower();
+
+    /**
+     * @brief Queue the message in the scheduler, it is sent when its class is served
+     *
+     * @param message Message
+     * @return true If it has been queued, false if the scheduler dropped it
+     */
+    bool send(DataMessage* message);
+
+    String getSchedulerStats();
+
+    String setSchedulerClass(String args);
+
+    String getFragmenterStats();
+
+    String getReliableStats();
 
+    String getCoalescerStats();
+
+    String getReceiveStats();
+
+    /**
+     * @brief Give a frame to LoRaMesher and account its airtime
+     *
+     * @param dst Destination
+     * @param frame Frame, LoRaMesher copies it
+     * @param frameSize Size of the frame
+     * @param appBytes Application bytes inside the frame, used for the goodput
+     * @param reliable Send it reliably, with the windowed layer or with LoRaMesher
+     */
+    void sendFrame(uint16_t dst, uint8_t* frame, size_t frameSize, uint32_t appBytes, bool reliable = SEND_RELIABLE);
+
+    /**
+     * @brief Send the message to the gateway chosen by the GatewaySelector
+     *
+     * @param message Message, its addrDst is set to the gateway
+     * @return true If there is a gateway and the message has been queued, store it otherwise
+     */
     bool sendClosestGateway(DataMessage* message);
 
     static inline void setGateway() {
@@ -60,6 +194,22 @@ public:
         return radio.queueWaitingSendPacketsLength();
     }
 
+    /**
+     * @brief Messages queued in the scheduler, in LoRaMesher or waiting for their ACK
+     */
+    size_t getSendBacklog() {
+        return scheduler.size() + radio.getSendQueueSize() + radio.queueWaitingSendPacketsLength();
+    }
+
+    /**
+     * @brief Notify a task every time a message is handed to LoRaMesher
+     *
+     * @param task Task, NULL to stop the notifications
+     */
+    void setSendDrainTask(TaskHandle_t task) {
+        sendDrainTask = task;
+    }
+
     void standby();
 
     /**
@@ -74,14 +224,99 @@ public:
 private:
     TaskHandle_t receiveLoRaMessage_Handle = NULL;
 
+    TaskHandle_t sendLoRaMessage_Handle = NULL;
+
+    TaskHandle_t sendDrainTask = NULL;
+
+    LoRaMeshScheduler scheduler;
+
+    LoRaMeshFragmenter fragmenter;
+
+    LoRaMeshCoalescer coalescer;
+
+    LoRaMeshReliable reliability;
+
+    RoutingSnapshot routingSnapshot;
+
+    GatewaySelector gatewaySelector;
+
+    LoRaAdr adr;
+
+    LoRaDutyCycle dutyCycle;
+
+    LinkEstimator linkEstimator;
+
+    ChannelPlan channelPlan;
+
+    uint32_t framesSent = 0;
+
+    uint32_t appBytesSent = 0;
+
+    uint64_t airtimeUsed = 0; //us
+
+    portMUX_TYPE sendStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+    DataMessage* receiveBatch[LORA_RECEIVE_BATCH];
+
+    uint8_t receiveBatchSize = 0;
+
+    uint32_t receivedPackets = 0;
+    uint32_t receivedMessages = 0;
+    uint32_t receiveBatches = 0;
+    uint32_t receiveTime = 0; //ms
+    uint32_t maxBatchTime = 0; //ms
+    uint32_t maxReceiveQueue = 0;
+    uint32_t receiveYields = 0;
+
     LoRaMeshService(): MessageService(appPort::LoRaMesherApp, String("LoRaMesherApp")) {
         commandService = loraMesherCommandService;
     };
 
     void createReceiveMessages();
 
-    LoRaMeshMessage* createLoRaMeshMessage(DataMessage* message);
+    void createSendMessages();
+
+    void transmit(DataMessage* message);
+
+    uint16_t getNextHop(uint16_t dst);
+
+    /**
+     * @brief Append every route of LoRaMesher, for the tables bigger than the snapshot
+     */
+    String getFullRoutingTable(String& routingTable);
+
+    /**
+     * @brief Classes that the duty cycle budget left can serve
+     *
+     * @return uint8_t Classes served, from the interactive one
+     */
+    uint8_t getDutyCycleClasses();
+
+    uint8_t* createLoRaMeshMessage(DataMessage* message, size_t& frameSize);
+
+    DataMessage* createDataMessage(uint16_t src, uint16_t dst, uint8_t* frame, uint32_t frameSize);
+
+    void decodePacket(AppPacket<LoRaMeshMessage>* packet);
+
+    /**
+     * @brief Decode a frame, the frames carried by containers and reliable frames are decoded too
+     *
+     */
+    void decodeFrame(uint16_t src, uint16_t dst, uint8_t* data, uint32_t size);
+
+    struct FrameAddress {
+        uint16_t src;
+        uint16_t dst;
+    };
+
+    void addToBatch(DataMessage* message);
+
+    /**
+     * @brief Hand the decoded messages to the MessageManager in one call and release them
+     *
+     */
+    void processBatch();
 
-    DataMessage* createDataMessage(AppPacket<LoRaMeshMessage>* message);
+    static void processContainerEntry(uint8_t* entry, uint32_t size, void* arg);
 };
 
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string.h>
+
+/**
+ * @brief Fields of a route needed to forward and to choose a gateway, 8 bytes
+ *
+ */
+struct RouteRecord {
+    uint16_t address; //0 is an empty slot
+    uint16_t via;
+    uint8_t metric;
+    uint8_t role;
+    int8_t receivedSNR;
+    uint8_t route; //Position of the full RouteNode in the routing table copy
+};
+
+/**
+ * @brief Fixed capacity hash index from node address to RouteRecord
+ *
+ * Open addressing with linear probing over a power of 2 table, so a lookup reads one or two
+ * adjacent records instead of walking a linked list. Removals shift back the records that follow,
+ * so there are no tombstones and the probe sequences stay short.
+ * It does not allocate nor lock, the owner serializes the writers.
+ *
+ * @tparam Capacity Slots, a power of 2 at least 4/3 of the records kept
+ */
+template <uint16_t Capacity>
+class RouteIndex {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "The RouteIndex capacity must be a power of 2");
+
+public:
+    RouteIndex() {
+        clear();
+    }
+
+    void clear() {
+        memset(records, 0, sizeof(records));
+        count = 0;
+    }
+
+    /**
+     * @brief Add the record, or update the one with the same address
+     *
+     * @return true If it is in the index
+     * @return false If the index is full
+     */
+    bool insert(const RouteRecord& record) {
+        if (record.address == 0)
+            return false;
+
+        uint16_t slot = getSlot(record.address);
+        for (uint16_t i = 0; i < Capacity; i++, slot = (slot + 1) & (Capacity - 1)) {
+            if (records[slot].address == record.address) {
+                records[slot] = record;
+                return true;
+            }
+
+            if (records[slot].address == 0) {
+                // Keep a free slot, the lookups of missing addresses stop on it
+                if (count == Capacity - 1)
+                    return false;
+
+                records[slot] = record;
+                count++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Find the record of an address
+     *
+     * @return const RouteRecord* Record, nullptr if there is no route to the address
+     */
+    const RouteRecord* find(uint16_t address) const {
+        if (address == 0)
+            return nullptr;
+
+        uint16_t slot = getSlot(address);
+        for (uint16_t i = 0; i < Capacity; i++, slot = (slot + 1) & (Capacity - 1)) {
+            if (records[slot].address == address)
+                return &records[slot];
+            if (records[slot].address == 0)
+                return nullptr;
+        }
+        return nullptr;
+    }
+
+    bool remove(uint16_t address) {
+        const RouteRecord* record = find(address);
+        if (!record)
+            return false;
+
+        uint16_t hole = record - records;
+        uint16_t slot = hole;
+        for (;;) {
+            slot = (slot + 1) & (Capacity - 1);
+            if (records[slot].address == 0)
+                break;
+
+            // Move back the records whose home slot is not between the hole and their slot
+            uint16_t home = getSlot(records[slot].address);
+            if (((slot - home) & (Capacity - 1)) >= ((slot - hole) & (Capacity - 1))) {
+                records[hole] = records[slot];
+                hole = slot;
+            }
+        }
+
+        records[hole].address = 0;
+        count--;
+        return true;
+    }
+
+    uint16_t size() const {
+        return count;
+    }
+
+    /**
+     * @brief Slot of the table, to iterate over all the records
+     *
+     * @param slot From 0 to Capacity - 1
+     * @return const RouteRecord& Record, with address 0 if the slot is empty
+     */
+    const RouteRecord& at(uint16_t slot) const {
+        return records[slot];
+    }
+
+    static constexpr uint16_t capacity() {
+        return Capacity;
+    }
+
+private:
+    RouteRecord records[Capacity];
+
+    uint16_t count;
+
+    static constexpr uint8_t getBits(uint32_t value) {
+        return value <= 1 ? 0 : 1 + getBits(value >> 1);
+    }
+
+    static uint16_t getSlot(uint16_t address) {
+        // Fibonacci hashing, the top bits are the best mixed
+        return (uint32_t) (address * 2654435769u) >> (32 - getBits(Capacity));
+    }
+};
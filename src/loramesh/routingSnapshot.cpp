@@ -0,0 +1,171 @@
+#include "routingSnapshot.h"
+
+static const char* RTS_TAG = "RoutingSnapshot";
+
+RoutingSnapshot::RoutingSnapshot() {
+    for (uint8_t i = 0; i < LORA_ROUTING_SNAPSHOT_BUFFERS; i++) {
+        tables[i].version = 0;
+        tables[i].size = 0;
+        tables[i].neighbors = 0;
+        tables[i].truncated = 0;
+        tables[i].readers = 0;
+    }
+    current = &tables[0];
+    rebuilding = false;
+}
+
+const RoutingTableSnapshot* RoutingSnapshot::acquire() {
+    if (isStale(current.load()))
+        rebuild();
+    else
+        hits++;
+
+    for (;;) {
+        RoutingTableSnapshot* snapshot = current.load();
+        snapshot->readers++;
+        //It could have been replaced, and its buffer reused, before the reader was counted
+        if (snapshot == current.load())
+            return snapshot;
+        snapshot->readers--;
+    }
+}
+
+void RoutingSnapshot::release(const RoutingTableSnapshot* snapshot) {
+    const_cast<RoutingTableSnapshot*>(snapshot)->readers--;
+}
+
+String RoutingSnapshot::getStats() {
+    const RoutingTableSnapshot* snapshot = acquire();
+    String stats = "Routing snapshot " + String(snapshot->version) + ", table id " + String(snapshot->routingTableId) +
+        ", " + String(snapshot->size) + " routes, " + String(snapshot->neighbors) + " neighbors, " +
+        String(snapshot->truncated) + " truncated, age " + String(millis() - snapshot->builtAt) + " ms\n" +
+        "Index: " + String(snapshot->index.size()) + " of " + String(snapshot->index.capacity()) + " slots, " +
+        String(indexUpdates) + " updates\n" +
+        "Rebuilds: " + String(rebuilds) + ", reused: " + String(hits) + ", buffers busy: " + String(buffersBusy) + "\n";
+    release(snapshot);
+    return stats;
+}
+
+uint8_t RoutingSnapshot::getRoutingTableId() {
+#if defined(LORAMESHER_BMX)
+    return RoutingTableService::routingTableId;
+#else
+    return 0;
+#endif
+}
+
+bool RoutingSnapshot::isStale(RoutingTableSnapshot* snapshot) {
+    return snapshot->version == 0 || snapshot->routingTableId != getRoutingTableId() ||
+        millis() - snapshot->builtAt > LORA_ROUTING_SNAPSHOT_MAX_AGE;
+}
+
+void RoutingSnapshot::rebuild() {
+    bool expected = false;
+    if (!rebuilding.compare_exchange_strong(expected, true))
+        return; //Another task is rebuilding it, use the current one
+
+    RoutingTableSnapshot* published = current.load();
+    RoutingTableSnapshot* next = nullptr;
+    for (uint8_t i = 0; i < LORA_ROUTING_SNAPSHOT_BUFFERS; i++) {
+        if (&tables[i] != published && tables[i].readers == 0) {
+            next = &tables[i];
+            break;
+        }
+    }
+
+    if (!next) {
+        buffersBusy++;
+        rebuilding = false;
+        return;
+    }
+
+    //Read the id first, a change while copying makes the next reader rebuild it again
+    next->routingTableId = getRoutingTableId();
+    next->size = 0;
+    next->neighbors = 0;
+    next->truncated = 0;
+    next->index = published->index;
+
+    LM_LinkedList<RouteNode>* routingTableList = LoraMesher::getInstance().routingTableListCopy();
+    if (!routingTableList) {
+        ESP_LOGE(RTS_TAG, "Failed to get routing table copy");
+        rebuilding = false;
+        return;
+    }
+
+    //Neighbors and gateways first, the monitor, the link metrics and the gateway selection only use them,
+    //so a table too big for the snapshot drops the routes reached through them
+    routingTableList->setInUse();
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        if (!routingTableList->moveToStart())
+            break;
+
+        do {
+            RouteNode* routeNode = routingTableList->getCurrent();
+            if (!routeNode || isPreferred(routeNode) != (pass == 0))
+                continue;
+
+            if (next->size == LORA_ROUTING_SNAPSHOT_SIZE) {
+                next->truncated++;
+                continue;
+            }
+
+            next->routes[next->size] = *routeNode;
+            if (routeNode->networkNode.address == routeNode->via)
+                next->neighbors++;
+
+            updateIndex(next, next->size++);
+        } while (routingTableList->next());
+    }
+    routingTableList->releaseInUse();
+    delete routingTableList;
+
+    removeStaleRecords(next);
+
+    next->builtAt = millis();
+    next->version = ++version;
+    current = next;
+    rebuilds++;
+
+    rebuilding = false;
+}
+
+bool RoutingSnapshot::isPreferred(const RouteNode* routeNode) {
+    return routeNode->networkNode.address == routeNode->via ||
+        (routeNode->networkNode.role & ROLE_GATEWAY) == ROLE_GATEWAY;
+}
+
+void RoutingSnapshot::updateIndex(RoutingTableSnapshot* snapshot, uint16_t position) {
+    const RouteNode& routeNode = snapshot->routes[position];
+    RouteRecord record = {
+        routeNode.networkNode.address,
+        routeNode.via,
+        routeNode.networkNode.metric,
+        routeNode.networkNode.role,
+        routeNode.receivedSNR,
+        (uint8_t) position
+    };
+
+    const RouteRecord* indexed = snapshot->index.find(record.address);
+    if (indexed && memcmp(indexed, &record, sizeof(RouteRecord)) == 0)
+        return;
+
+    if (!snapshot->index.insert(record))
+        ESP_LOGE(RTS_TAG, "Route index full, %X not indexed", record.address);
+    indexUpdates++;
+}
+
+void RoutingSnapshot::removeStaleRecords(RoutingTableSnapshot* snapshot) {
+    //An updated record points to its route, the others are from routes that are gone
+    uint16_t stale[LORA_ROUTING_INDEX_SIZE];
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < snapshot->index.capacity(); i++) {
+        const RouteRecord& record = snapshot->index.at(i);
+        if (record.address != 0 && (record.route >= snapshot->size || snapshot->routes[record.route].networkNode.address != record.address))
+            stale[count++] = record.address;
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+        snapshot->index.remove(stale[i]);
+    indexUpdates += count;
+}
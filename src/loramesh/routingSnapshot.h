@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "config.h"
+
+#include "LoraMesher.h"
+
+#include "routeIndex.h"
+
+static_assert(LORA_ROUTING_SNAPSHOT_SIZE <= 256, "RouteRecord keeps the route position in 8 bits");
+static_assert(LORA_ROUTING_INDEX_SIZE * 3 >= LORA_ROUTING_SNAPSHOT_SIZE * 4, "The route index needs a load factor under 3/4");
+
+/**
+ * @brief Contiguous copy of the routing table, it never changes once published
+ *
+ */
+struct RoutingTableSnapshot {
+    uint32_t version;
+    uint8_t routingTableId;
+    uint32_t builtAt;
+    uint16_t size;
+    uint16_t neighbors;
+    uint16_t truncated; //Routes that did not fit
+    RouteNode routes[LORA_ROUTING_SNAPSHOT_SIZE];
+    RouteIndex<LORA_ROUTING_INDEX_SIZE> index;
+
+    std::atomic<uint16_t> readers;
+
+    /**
+     * @brief Route to an address, without walking the table
+     *
+     * @return const RouteNode* Route, nullptr if there is none
+     */
+    const RouteNode* find(uint16_t address) const {
+        const RouteRecord* record = index.find(address);
+        return record ? &routes[record->route] : nullptr;
+    }
+};
+
+/**
+ * @brief Routing table shared by the monitor, the display and the commands
+ *
+ * The snapshot is rebuilt from routingTableListCopy only when the routingTableId of LoRaMesher
+ * changes, or when it is older than LORA_ROUTING_SNAPSHOT_MAX_AGE to refresh the link metrics.
+ * It is built in a spare buffer and published with an atomic pointer swap, so the readers do not
+ * take any lock nor allocate. A buffer is only reused when no reader holds it.
+ * The address index is carried over from the published snapshot, only the routes that changed are
+ * written to it.
+ * It holds LORA_ROUTING_SNAPSHOT_SIZE routes, the neighbors and gateways first. The readers that need
+ * every route fall back to LoRaMesher when truncated is not 0, so the lookups are only constant time
+ * up to that many routes.
+ */
+class RoutingSnapshot {
+public:
+    RoutingSnapshot();
+
+    /**
+     * @brief Get the current snapshot, rebuilding it if the routing table changed
+     *
+     * @return const RoutingTableSnapshot* Snapshot, give it back with release()
+     */
+    const RoutingTableSnapshot* acquire();
+
+    void release(const RoutingTableSnapshot* snapshot);
+
+    String getStats();
+
+private:
+    RoutingTableSnapshot tables[LORA_ROUTING_SNAPSHOT_BUFFERS];
+
+    std::atomic<RoutingTableSnapshot*> current;
+
+    std::atomic<bool> rebuilding;
+
+    uint32_t version = 0;
+
+    uint32_t rebuilds = 0;
+
+    uint32_t indexUpdates = 0;
+
+    uint32_t hits = 0;
+
+    uint32_t buffersBusy = 0;
+
+    static uint8_t getRoutingTableId();
+
+    bool isStale(RoutingTableSnapshot* snapshot);
+
+    void rebuild();
+
+    static bool isPreferred(const RouteNode* routeNode);
+
+    void updateIndex(RoutingTableSnapshot* snapshot, uint16_t position);
+
+    void removeStaleRecords(RoutingTableSnapshot* snapshot);
+};
@@ -4,6 +4,7 @@
 
 #include <ArduinoJson.h>
 
+#include "msgPackWriter.h"
 
 #pragma pack(1)
 
@@ -31,6 +32,18 @@ enum appPort: uint8_t {
     SensorApp = 14,
     MetadataApp = 15,
     MonApp = 16,
+    LoRaFragmentApp = 17,
+    LoRaContainerApp = 18,
+    LoRaReliableApp = 19,
+};
+
+//Outbound traffic classes, used to schedule the LoRa transmissions
+enum messagePriority: uint8_t {
+    DefaultPriority = 0, //Chosen from the appPortSrc
+    InteractivePriority = 1,
+    SensorPriority = 2,
+    MonitorPriority = 3,
+    BulkPriority = 4,
 };
 
 class DataMessageGeneric {
@@ -41,11 +54,23 @@ public:
     uint16_t addrSrc;
     uint16_t addrDst;
     uint32_t messageSize; //Message Size of the payload no include header
+    // Initialized for every message built with new or placement new, even with a user-provided constructor.
+    // The messages built in raw pool or heap memory set them by hand
+    messagePriority priority = DefaultPriority; //Local only, it is not sent over LoRa
+    uint32_t deadline = 0; //Local only, millis() after which the queues drop it, 0 never
 
     uint32_t getDataMessageSize() {
         return sizeof(DataMessageGeneric) + messageSize;
     }
 
+    void setTTL(uint32_t ttl) {
+        deadline = ttl == 0 ? 0 : (millis() + ttl) | 1;
+    }
+
+    bool isExpired() {
+        return deadline != 0 && (int32_t) (millis() - deadline) >= 0;
+    }
+
     void serialize(JsonObject& doc) {
         // doc["appPortDst"] = appPortDst;
         // doc["appPortSrc"] = appPortSrc;
@@ -55,6 +80,19 @@ public:
         doc["messageSize"] = messageSize;
     }
 
+    static const uint8_t ENCODED_HEADER_SIZE = 5;
+
+    /**
+     * @brief Write the header as ENCODED_HEADER_SIZE MessagePack values, the appPortSrc first
+     */
+    void encode(MsgPackWriter& writer) {
+        writer.writeUnsigned(appPortSrc);
+        writer.writeUnsigned(messageId);
+        writer.writeUnsigned(addrSrc);
+        writer.writeUnsigned(addrDst);
+        writer.writeUnsigned(messageSize);
+    }
+
     void deserialize(JsonObject& doc) {
         appPortDst = (appPort) doc["appPortDst"];
         appPortSrc = (appPort) doc["appPortSrc"];
@@ -0,0 +1,92 @@
+#include "duplicateCache.h"
+
+static_assert((DUPLICATE_CACHE_SIZE & (DUPLICATE_CACHE_SIZE - 1)) == 0, "DUPLICATE_CACHE_SIZE must be a power of 2");
+
+bool DuplicateCache::checkAndAdd(DataMessage* message) {
+    uint32_t key = getKey(message);
+    uint32_t fingerprint = getFingerprint(message);
+    uint32_t now = millis();
+
+    // Fibonacci hashing, the top bits are the best mixed
+    uint32_t start = key * 2654435769u;
+    start = (start >> 16) & (DUPLICATE_CACHE_SIZE - 1);
+
+    portENTER_CRITICAL(&cacheMux);
+
+    Entry* freeEntry = nullptr;
+    Entry* oldestEntry = nullptr;
+    for (uint8_t i = 0; i < DUPLICATE_CACHE_PROBE; i++) {
+        Entry* entry = &entries[(start + i) & (DUPLICATE_CACHE_SIZE - 1)];
+
+        if (!entry->used || now - entry->timestamp > window) {
+            if (!freeEntry)
+                freeEntry = entry;
+            continue;
+        }
+
+        // The window runs from the first copy, a message repeated periodically is not suppressed for ever
+        if (entry->key == key && entry->fingerprint == fingerprint) {
+            hits++;
+            portEXIT_CRITICAL(&cacheMux);
+            return true;
+        }
+
+        if (!oldestEntry || now - entry->timestamp > now - oldestEntry->timestamp)
+            oldestEntry = entry;
+    }
+
+    Entry* candidate = freeEntry;
+    if (!candidate) {
+        // Every entry of the probe window is alive, replace the oldest one
+        candidate = oldestEntry;
+        evictions++;
+    }
+
+    candidate->key = key;
+    candidate->fingerprint = fingerprint;
+    candidate->timestamp = now;
+    candidate->used = true;
+    misses++;
+
+    portEXIT_CRITICAL(&cacheMux);
+    return false;
+}
+
+void DuplicateCache::setWindow(uint32_t windowMs) {
+    window = windowMs;
+}
+
+void DuplicateCache::clear() {
+    portENTER_CRITICAL(&cacheMux);
+    for (size_t i = 0; i < DUPLICATE_CACHE_SIZE; i++)
+        entries[i].used = false;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    portEXIT_CRITICAL(&cacheMux);
+}
+
+String DuplicateCache::getStats() {
+    return "Duplicates dropped: " + String(hits) + "\n" +
+        "Unique messages: " + String(misses) + "\n" +
+        "Evictions: " + String(evictions) + "\n" +
+        "Window: " + String(window) + " ms\n";
+}
+
+uint32_t DuplicateCache::getKey(DataMessage* message) {
+    return ((uint32_t) message->addrSrc << 16) | ((uint32_t) message->appPortSrc << 8) | message->messageId;
+}
+
+uint32_t DuplicateCache::getFingerprint(DataMessage* message) {
+    // FNV-1a over the destination and the payload
+    uint32_t hash = 2166136261u;
+
+    hash = (hash ^ (message->addrDst & 0xFF)) * 16777619u;
+    hash = (hash ^ (message->addrDst >> 8)) * 16777619u;
+    hash = (hash ^ message->appPortDst) * 16777619u;
+
+    for (uint32_t i = 0; i < message->messageSize; i++)
+        hash = (hash ^ message->message[i]) * 16777619u;
+
+    return hash;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "dataMessage.h"
+
+#include "config.h"
+
+/**
+ * @brief Bounded cache of the messages received recently, used to drop duplicates and loops
+ *
+ * Messages are keyed on (addrSrc, appPortSrc, messageId) plus a fingerprint of the payload, so
+ * services that always send the same messageId are not mistaken for duplicates.
+ * Only the messages received from LoRa are checked, retransmissions and forwarding loops only
+ * happen there, and sources like the MQTT downlinks do not number their messages.
+ * The table is open addressed with a fixed probe window: a new entry reuses an empty or expired
+ * slot of the window, or the oldest one, so it never allocates.
+ */
+class DuplicateCache {
+public:
+    /**
+     * @brief Check if the message has been seen inside the time window and remember it
+     *
+     * @param message Message received
+     * @return true If it is a duplicate
+     * @return false If it is the first time it is seen
+     */
+    bool checkAndAdd(DataMessage* message);
+
+    void setWindow(uint32_t windowMs);
+
+    uint32_t getWindow() { return window; }
+
+    void clear();
+
+    String getStats();
+
+private:
+    struct Entry {
+        uint32_t key;
+        uint32_t fingerprint;
+        uint32_t timestamp;
+        bool used;
+    };
+
+    Entry entries[DUPLICATE_CACHE_SIZE] = {};
+
+    uint32_t window = DUPLICATE_CACHE_WINDOW;
+
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t evictions = 0;
+
+    portMUX_TYPE cacheMux = portMUX_INITIALIZER_UNLOCKED;
+
+    static uint32_t getKey(DataMessage* message);
+
+    static uint32_t getFingerprint(DataMessage* message);
+};
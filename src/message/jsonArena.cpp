@@ -0,0 +1,72 @@
+#include "jsonArena.h"
+
+JsonArena::JsonArena(uint8_t* buffer, size_t size): buffer(buffer), capacity(size) {
+}
+
+void* JsonArena::allocate(size_t size) {
+    size_t blockSize = sizeof(BlockHeader) + align(size);
+    if (blockSize > capacity - used) {
+        failures++;
+        return nullptr;
+    }
+
+    BlockHeader* header = (BlockHeader*) (buffer + used);
+    header->size = size;
+
+    last = used;
+    used += blockSize;
+    if (used > highWater)
+        highWater = used;
+
+    return header + 1;
+}
+
+void JsonArena::deallocate(void* ptr) {
+    // Only the last block gives its memory back, the rest is freed by reset
+    if (!ptr || !isLast(ptr))
+        return;
+
+    used = last;
+    last = SIZE_MAX;
+}
+
+void* JsonArena::reallocate(void* ptr, size_t newSize) {
+    if (!ptr)
+        return allocate(newSize);
+
+    BlockHeader* header = ((BlockHeader*) ptr) - 1;
+
+    if (isLast(ptr)) {
+        size_t blockSize = sizeof(BlockHeader) + align(newSize);
+        if (blockSize > capacity - last) {
+            failures++;
+            return nullptr;
+        }
+
+        header->size = newSize;
+        used = last + blockSize;
+        if (used > highWater)
+            highWater = used;
+
+        return ptr;
+    }
+
+    void* newPtr = allocate(newSize);
+    if (newPtr)
+        memcpy(newPtr, ptr, header->size < newSize ? header->size : newSize);
+
+    return newPtr;
+}
+
+void JsonArena::reset() {
+    used = 0;
+    last = SIZE_MAX;
+}
+
+size_t JsonArena::align(size_t size) {
+    return (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+}
+
+bool JsonArena::isLast(void* ptr) {
+    return last != SIZE_MAX && (uint8_t*) ptr == buffer + last + sizeof(BlockHeader);
+}
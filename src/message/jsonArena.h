@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <ArduinoJson.h>
+
+/**
+ * @brief ArduinoJson allocator that carves the document out of a caller-owned buffer
+ *
+ * Allocations are bumped from the start of the buffer and only the last block can be freed or
+ * resized in place, which is how a JsonDocument grows its pools. reset() drops everything at once,
+ * so a document built for every publish never touches the heap.
+ * When the buffer is full allocate returns nullptr and the document reports overflowed().
+ */
+class JsonArena: public ArduinoJson::Allocator {
+public:
+    JsonArena(uint8_t* buffer, size_t size);
+
+    void* allocate(size_t size) override;
+
+    void deallocate(void* ptr) override;
+
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    /**
+     * @brief Free every block, the documents using the arena must be destroyed before
+     */
+    void reset();
+
+    size_t getUsed() { return used; }
+
+    size_t getHighWater() { return highWater; }
+
+    size_t getCapacity() { return capacity; }
+
+    uint32_t getFailures() { return failures; }
+
+private:
+    struct BlockHeader {
+        size_t size;
+    };
+
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used = 0;
+    size_t last = SIZE_MAX;
+
+    size_t highWater = 0;
+    uint32_t failures = 0;
+
+    static size_t align(size_t size);
+
+    bool isLast(void* ptr);
+};
@@ -3,6 +3,145 @@
 static const char* MANAGER_TAG = "MANAGER";
 
 void MessageManager::init() {
+    createSendWorker(LoRaMeshPort);
+    createSendWorker(WiFiPort);
+    createSendWorker(MqttPort);
+
+#ifdef STORE_FORWARD_ENABLED
+    if (storeForward.begin(&storeBackend))
+        createReplayWorker();
+    else
+        ESP_LOGE(MANAGER_TAG, "Store and forward log not available");
+#endif
+}
+
+void MessageManager::createSendWorker(messagePort port) {
+    sendQueues[port] = xQueueCreate(MESSAGE_SEND_QUEUE_SIZE, sizeof(DataMessage*));
+    if (sendQueues[port] == NULL) {
+        ESP_LOGE(MANAGER_TAG, "Send queue %d creation failed", port);
+        return;
+    }
+
+    BaseType_t res = xTaskCreatePinnedToCore(
+        sendLoop,
+        "Send Message Task",
+        MESSAGE_SEND_TASK_STACK,
+        (void*) (uintptr_t) port,
+        MESSAGE_SEND_TASK_PRIORITY,
+        &sendMessageManager_TaskHandles[port],
+        MESSAGE_SEND_TASK_CORE);
+    if (res != pdPASS) {
+        ESP_LOGE(MANAGER_TAG, "Send task %d creation gave error: %d", port, res);
+        vQueueDelete(sendQueues[port]);
+        sendQueues[port] = NULL;
+    }
+}
+
+void MessageManager::sendLoop(void* parameters) {
+    messagePort port = (messagePort) (uintptr_t) parameters;
+    MessageManager& manager = MessageManager::getInstance();
+    DataMessage* message;
+
+    for (;;) {
+        if (xQueueReceive(manager.sendQueues[port], &message, portMAX_DELAY) == pdTRUE) {
+            ESP_LOGV(MANAGER_TAG, "Stack space unused after entering the task: %d", uxTaskGetStackHighWaterMark(NULL));
+            if (message->isExpired()) {
+                TRACE("Message %X:%d expired in send queue %d", message->addrSrc, message->messageId, port);
+                manager.sendExpired[port]++;
+            }
+            else {
+                manager.dispatchMessage(port, message);
+                manager.sendDone[port]++;
+            }
+            manager.pool.release(message);
+        }
+    }
+}
+
+void MessageManager::createReplayWorker() {
+    BaseType_t res = xTaskCreate(
+        replayLoop,
+        "Replay Message Task",
+        STORE_FORWARD_TASK_STACK,
+        (void*) 1,
+        1,
+        &replayMessageManager_TaskHandle);
+    if (res != pdPASS) {
+        ESP_LOGE(MANAGER_TAG, "Replay task creation gave error: %d", res);
+    }
+}
+
+void MessageManager::replayLoop(void* parameters) {
+    MessageManager& manager = MessageManager::getInstance();
+
+    // The cursor is saved once the send worker has taken every replayed message from the queue and handed it
+    // to MqttService, which publishes it or stores it again. A reset before then replays them instead of
+    // losing them, only the messages still in the outbox of the MQTT client are not covered
+    bool commitPending = false;
+    uint32_t commitAfter = 0;
+
+    for (;;) {
+        vTaskDelay(STORE_FORWARD_REPLAY_INTERVAL / portTICK_PERIOD_MS);
+
+        xQueueHandle queue = manager.sendQueues[MqttPort];
+
+        if (commitPending &&
+            (int32_t) (manager.sendDone[MqttPort] + manager.sendExpired[MqttPort] - commitAfter) >= 0) {
+            manager.storeForward.commit();
+            commitPending = false;
+        }
+
+        if (!canReplay())
+            continue;
+
+        // Rate limited, the link has just come back and the live traffic has to go through too
+        uint8_t replayed = 0;
+        while (replayed < STORE_FORWARD_REPLAY_BATCH && (!queue || uxQueueSpacesAvailable(queue) > 0)) {
+            size_t size = manager.storeForward.peek();
+            if (size == 0)
+                break;
+
+            DataMessage* message = (DataMessage*) manager.pool.alloc(size);
+            if (!message) {
+                ESP_LOGW(MANAGER_TAG, "Not enough memory to replay a stored message");
+                break;
+            }
+
+            if (manager.storeForward.pop((uint8_t*) message, size)) {
+                TRACE("Replaying stored message %X:%d", message->addrSrc, message->messageId);
+                SendMessageStatus status = manager.sendMessage(MqttPort, message);
+                if (status != MessageQueued && status != MessageSent)
+                    manager.storeForward.store(message);
+                replayed++;
+            }
+
+            manager.pool.release(message);
+        }
+
+        if (replayed == 0)
+            continue;
+
+        if (queue) {
+            // The queue is FIFO, the batch is out once as many messages have left it as had entered it
+            commitAfter = manager.sendQueued[MqttPort];
+            commitPending = true;
+        }
+        else {
+            // Without a queue sendMessage has already dispatched them
+            manager.storeForward.commit();
+        }
+    }
+}
+
+bool MessageManager::canReplay() {
+    return MqttService::getInstance().isDeviceConnected() || LoRaMeshService::getInstance().hasGateway();
+}
+
+void MessageManager::storeMessage(DataMessage* message) {
+#ifdef STORE_FORWARD_ENABLED
+    if (MessageManager::getInstance().storeForward.store(message))
+        TRACE("Message %X:%d stored until a gateway is reachable", message->addrSrc, message->messageId);
+#endif
 }
 
 void MessageManager::addMessageService(MessageService* service) {
@@ -18,6 +157,16 @@ void MessageManager::addMessageService(MessageService* service) {
     if (!added) {
         services.push_back(service);
     }
+
+    if (servicesByPort[service->serviceId] != nullptr) {
+        ESP_LOGW(MANAGER_TAG, "Service %d already added, replacing it", service->serviceId);
+    }
+    servicesByPort[service->serviceId] = service;
+
+    if (service->schema) {
+        ESP_LOGI(MANAGER_TAG, "Service %s uses the schema %s, %d bytes", service->serviceName.c_str(),
+            service->schema->name, service->schema->payloadSize);
+    }
 }
 
 String MessageManager::getAvailableCommands() {
@@ -32,25 +181,21 @@ String MessageManager::getAvailableCommands() {
 }
 
 String MessageManager::executeCommand(uint8_t serviceId, uint8_t commandId, String args) {
-    for (auto service : services) {
-        if (service->serviceId == serviceId) {
-            return service->commandService->executeCommand(commandId, args);
-        }
+    MessageService* service = servicesByPort[serviceId];
+    if (service) {
+        return service->commandService->executeCommand(commandId, args);
     }
 
     return "Service not found";
 }
 
 String MessageManager::executeCommand(uint8_t serviceId, String command) {
-    String result = "";
-
-    for (auto service : services) {
-        if (service->serviceId == serviceId) {
-            result += service->commandService->executeCommand(command);
-        }
+    MessageService* service = servicesByPort[serviceId];
+    if (service) {
+        return service->commandService->executeCommand(command);
     }
 
-    return result;
+    return "";
 }
 
 String MessageManager::executeCommand(String command) {
@@ -72,15 +217,58 @@ String MessageManager::executeCommand(String command) {
 }
 
 void MessageManager::getJSON(DataMessage* message, String &json) {
-    printDataMessageHeader("JSON", message);
+    JsonDocument doc;
+    if (!serialize(message, doc)) {
+        json = "{\"Empty\":\"true\"}";
+        return;
+    }
 
-    for (auto service : services) {
-        if (service->serviceId == message->appPortSrc) {
-            return service->getJSON(message, json);
+    serializeJson(doc, json);
+}
+
+size_t MessageManager::encode(DataMessage* message, messageCodec codec, JsonDocument& doc, char* buffer, size_t size) {
+    MessageService* service = servicesByPort[message->appPortSrc];
+    if (codec == MsgPackCodec && service) {
+        // Straight from the packed message, without building the document
+        MsgPackWriter writer((uint8_t*) buffer, size);
+        if (service->encode(message, writer)) {
+            if (writer.overflowed()) {
+                ESP_LOGE(MANAGER_TAG, "Encoded message too big, buffer %d bytes", size);
+                return 0;
+            }
+            return writer.getLength();
         }
     }
-    ESP_LOGE(MANAGER_TAG, "Service Not Found");
-    json = "{\"Empty\":\"true\"}";
+
+    if (!serialize(message, doc))
+        return 0;
+
+    if (doc.overflowed()) {
+        ESP_LOGE(MANAGER_TAG, "Not enough memory to build the document");
+        return 0;
+    }
+
+    size_t length = codec == MsgPackCodec ? measureMsgPack(doc) : measureJson(doc);
+    if (length >= size) {
+        ESP_LOGE(MANAGER_TAG, "Encoded message too big: %d bytes, buffer %d bytes", length, size);
+        return 0;
+    }
+
+    if (codec == MsgPackCodec)
+        return serializeMsgPack(doc, buffer, size);
+
+    return serializeJson(doc, buffer, size);
+}
+
+bool MessageManager::serialize(DataMessage* message, JsonDocument& doc) {
+    MessageService* service = servicesByPort[message->appPortSrc];
+    if (!service) {
+        ESP_LOGE(MANAGER_TAG, "Service Not Found");
+        return false;
+    }
+
+    service->serialize(message, doc);
+    return true;
 }
 
 DataMessage* MessageManager::getDataMessage(String json) {
@@ -97,10 +285,9 @@ DataMessage* MessageManager::getDataMessage(String json) {
 
     uint8_t serviceId = data["appPortSrc"];
 
-    for (auto service : services) {
-        if (service->serviceId == serviceId) {
-            return service->getDataMessage(data);
-        }
+    MessageService* service = servicesByPort[serviceId];
+    if (service) {
+        return service->getDataMessage(data);
     }
 
     ESP_LOGE(MANAGER_TAG, "Service Not Found");
@@ -108,44 +295,115 @@ DataMessage* MessageManager::getDataMessage(String json) {
     return nullptr;
 }
 
-String MessageManager::printDataMessageHeader(String title, DataMessage* message) {
-    DynamicJsonDocument doc(1024);
+void MessageManager::processReceivedMessage(messagePort port, DataMessage* message) {
+    TRACE("Received %X:%d -> %X:%d id %d size %d", message->addrSrc, message->appPortSrc,
+        message->addrDst, message->appPortDst, message->messageId, message->messageSize);
 
-    doc["title"] = title;
+    if (port == LoRaMeshPort && duplicates.checkAndAdd(message)) {
+        TRACE("Duplicated message from %X id %d, dropped", message->addrSrc, message->messageId);
+        return;
+    }
 
-    JsonObject data = doc.createNestedObject("data");
+    if (message->addrDst != 0 && message->addrDst != LoRaMeshService::getInstance().getLocalAddress()) {
+        TRACE("Message for %X not for me", message->addrDst);
+        if (port == MqttPort) {
+            sendMessage(LoRaMeshPort, message);
+        }
+        return;
+    }
 
-    message->serialize(data);
+    MessageService* service = servicesByPort[message->appPortDst];
+    if (!service)
+        return;
 
-    String json;
-    serializeJson(doc, json);
+    const MessageSchema* schema = service->getSchema(message);
+    if (schema && !schema->validate(message)) {
+        ESP_LOGW(MANAGER_TAG, "Message from %X of %d bytes does not match the schema %s, dropped", message->addrSrc,
+            message->messageSize, schema->name);
+        return;
+    }
 
-    ESP_LOGI(MANAGER_TAG, "%s", json.c_str());
+    service->processReceivedMessage(port, message);
+}
 
-    return json;
+void MessageManager::processReceivedMessages(messagePort port, DataMessage** messages, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        processReceivedMessage(port, messages[i]);
 }
 
-void MessageManager::processReceivedMessage(messagePort port, DataMessage* message) {
-    printDataMessageHeader("Received", message);
+SendMessageStatus MessageManager::sendMessage(messagePort port, DataMessage* message) {
+    message->setTTL(ttls[LoRaMeshScheduler::getClass(message)]);
 
-    // TODO: Add a list to track the messages already received to avoid loops and duplicates
+    if (port >= PORT_COUNT || sendQueues[port] == NULL) {
+        dispatchMessage(port, message);
+        return MessageSent;
+    }
 
-    if (message->addrDst != 0 && message->addrDst != LoRaMeshService::getInstance().getLocalAddress()) {
-        ESP_LOGI(MANAGER_TAG, "Message not for me");
-        if (port == MqttPort) {
-            sendMessage(LoRaMeshPort, message);
+    DataMessage* queuedMessage = message;
+    if (pool.owns(message)) {
+        pool.retain(message);
+    }
+    else {
+        queuedMessage = (DataMessage*) pool.alloc(message->getDataMessageSize());
+        if (!queuedMessage) {
+            sendDropped[port]++;
+            return MessageNoMemory;
         }
-        return;
+        memcpy(queuedMessage, message, message->getDataMessageSize());
     }
 
-    for (auto service : services) {
-        if (service->serviceId == message->appPortDst) {
-            service->processReceivedMessage(port, message);
-        }
+    if (xQueueSend(sendQueues[port], &queuedMessage, 0) != pdPASS) {
+        ESP_LOGW(MANAGER_TAG, "Send queue %d full, message dropped", port);
+        pool.release(queuedMessage);
+        sendDropped[port]++;
+        return MessageQueueFull;
+    }
+
+    sendQueued[port]++;
+    return MessageQueued;
+}
+
+String MessageManager::setDuplicateWindow(String args) {
+    int window;
+    if (sscanf(args.c_str(), "%d", &window) != 1)
+        return "Usage: /dupWindow <ms>";
+
+    if (window <= 0 || window > DUPLICATE_CACHE_MAX_WINDOW)
+        return "Invalid window, from 1 to " + String(DUPLICATE_CACHE_MAX_WINDOW) + " ms";
+
+    duplicates.setWindow(window);
+    return "Duplicate window: " + String(duplicates.getWindow()) + " ms";
+}
+
+String MessageManager::getSendStats() {
+    String stats = "";
+    for (uint8_t port = 0; port < PORT_COUNT; port++) {
+        if (sendQueues[port] == NULL)
+            continue;
+
+        stats += "Port " + String(port) + ": waiting " + String(uxQueueMessagesWaiting(sendQueues[port])) +
+            ", queued " + String(sendQueued[port]) + ", sent " + String(sendDone[port]) +
+            ", dropped " + String(sendDropped[port]) + ", expired " + String(sendExpired[port]) + "\n";
     }
+    return stats;
+}
+
+bool MessageManager::setTTL(uint8_t trafficClass, uint32_t ttl) {
+    if (trafficClass >= BulkPriority)
+        return false;
+
+    ttls[trafficClass] = ttl;
+    return true;
+}
+
+String MessageManager::getTTLs() {
+    String result = "";
+    for (uint8_t i = 0; i < BulkPriority; i++)
+        result += "Class " + String(i) + ": " + (ttls[i] == 0 ? String("never") : String(ttls[i]) + " ms") + "\n";
+    return result;
 }
 
-void MessageManager::sendMessage(messagePort port, DataMessage* message) {
+void MessageManager::dispatchMessage(messagePort port, DataMessage* message) {
     switch (port) {
         case LoRaMeshPort:
             sendMessageLoRaMesher(message);
@@ -172,12 +430,13 @@ void MessageManager::sendMessageLoRaMesher(DataMessage* message) {
 void MessageManager::sendMessageMqtt(DataMessage* message) {
     MqttService& mqtt = MqttService::getInstance();
     if (mqtt.writeToMqtt(message)) {
-        ESP_LOGI(MANAGER_TAG, "Message sent to MQTT");
+        TRACE("Message %X:%d sent to MQTT", message->addrSrc, message->messageId);
         return;
     }
 
     LoRaMeshService& mesher = LoRaMeshService::getInstance();
-    mesher.sendClosestGateway(message);
+    if (!mesher.sendClosestGateway(message))
+        storeMessage(message);
 }
 
 void MessageManager::sendMessageWiFi(DataMessage* message) {
@@ -189,12 +448,13 @@ void MessageManager::sendMessageWiFi(DataMessage* message) {
 
     if (wifi.isConnected()) {
         ESP_LOGE(MANAGER_TAG, "Error sending message to WiFi");
-        //TODO: Retry adding it into a queue and send it later or send to closest gateway 
+        storeMessage(message);
         return;
     }
     else
         ESP_LOGE(MANAGER_TAG, "WiFi not connected");
 
     LoRaMeshService& mesher = LoRaMeshService::getInstance();
-    mesher.sendClosestGateway(message);
+    if (!mesher.sendClosestGateway(message))
+        storeMessage(message);
 }
@@ -8,12 +8,27 @@
 
 #include "messageService.h"
 
+#include "messagePool.h"
+
+#include "duplicateCache.h"
+
+#include "storeForward.h"
+
+#include "helpers/traceLog.h"
+
 #include "loramesh/loraMeshService.h"
 
 #include "mqtt/mqttService.h"
 
 #include "wifi/wifiServerService.h"
 
+enum SendMessageStatus: uint8_t {
+    MessageSent = 0, // The port has no worker, it was sent by the caller
+    MessageQueued = 1,
+    MessageQueueFull = 2,
+    MessageNoMemory = 3,
+};
+
 class MessageManager {
 public:
     /**
@@ -27,7 +42,23 @@ public:
 
     xQueueHandle xProcessQueue;
 
-    xQueueHandle xSendQueue;
+    /**
+     * @brief Buffers shared by the DataMessages of the LoRa, MQTT and monitor pipeline
+     *
+     */
+    MessagePool pool;
+
+    /**
+     * @brief Messages received recently, to drop retransmissions and forwarding loops
+     *
+     */
+    DuplicateCache duplicates;
+
+    /**
+     * @brief Uplinks that could not be sent, replayed when MQTT or a gateway is reachable again
+     *
+     */
+    StoreForward storeForward;
 
     void init();
 
@@ -35,7 +66,48 @@ public:
 
     void processReceivedMessage(messagePort port, DataMessage* message);
 
-    void sendMessage(messagePort port, DataMessage* message);
+    /**
+     * @brief Process a batch of received messages in order
+     *
+     * @param port Port they were received from
+     * @param messages Messages, the caller keeps its references
+     * @param count Number of messages
+     */
+    void processReceivedMessages(messagePort port, DataMessage** messages, size_t count);
+
+    /**
+     * @brief Queue the message to the send worker of the port, it does not block
+     *
+     * Messages from the pool are shared with the worker, so they must not be modified after this call,
+     * any other message is copied into the pool. The deadline is set from the TTL of its class, and
+     * every queue drops the message once it has expired.
+     *
+     * @param port Port
+     * @param message Message
+     * @return SendMessageStatus MessageQueued, or the reason why it was not queued
+     */
+    SendMessageStatus sendMessage(messagePort port, DataMessage* message);
+
+    String getSendStats();
+
+    /**
+     * @brief Set the time window of the duplicate cache from a command
+     *
+     * @param args Window in ms, from 1 to DUPLICATE_CACHE_MAX_WINDOW
+     * @return String New window, or why it was rejected
+     */
+    String setDuplicateWindow(String args);
+
+    /**
+     * @brief Set the time the messages of a class can wait in the queues
+     *
+     * @param trafficClass Class, from 0 (interactive) to 3 (bulk)
+     * @param ttl Time in ms, 0 never expires
+     * @return true If the class is valid
+     */
+    bool setTTL(uint8_t trafficClass, uint32_t ttl);
+
+    String getTTLs();
 
     String getAvailableCommands();
 
@@ -47,9 +119,23 @@ public:
 
     void getJSON(DataMessage* message, String&);
 
+    /**
+     * @brief Encode the message straight into a buffer, without intermediate Strings
+     *
+     * MsgPackCodec uses the positional encoder of the service and only builds the document when the
+     * service has none.
+     *
+     * @param message Message
+     * @param codec Codec
+     * @param doc Empty document used to build the message, usually backed by a JsonArena
+     * @param buffer Output buffer
+     * @param size Size of the buffer
+     * @return size_t Bytes written, 0 if the service is not found or the message does not fit
+     */
+    size_t encode(DataMessage* message, messageCodec codec, JsonDocument& doc, char* buffer, size_t size);
+
     DataMessage* getDataMessage(String json);
 
-    String printDataMessageHeader(String title, DataMessage* message);
 
 private:
 
@@ -57,10 +143,50 @@ private:
 
     std::vector<MessageService*> services;
 
-    TaskHandle_t sendMessageManager_TaskHandle = NULL;
+    /**
+     * @brief Services indexed by their serviceId (appPort), filled in addMessageService
+     *
+     */
+    MessageService* servicesByPort[UINT8_MAX + 1] = {nullptr};
+
+    static const uint8_t PORT_COUNT = messagePort::MqttPort + 1;
+
+    xQueueHandle sendQueues[PORT_COUNT] = {NULL};
+
+    TaskHandle_t sendMessageManager_TaskHandles[PORT_COUNT] = {NULL};
+
+    uint32_t sendQueued[PORT_COUNT] = {0};
+
+    uint32_t sendDropped[PORT_COUNT] = {0};
+
+    uint32_t sendDone[PORT_COUNT] = {0};
+
+    uint32_t sendExpired[PORT_COUNT] = {0};
+
+    uint32_t ttls[BulkPriority] = MESSAGE_TTLS;
 
     TaskHandle_t receiveMessageManager_TaskHandle = NULL;
 
+    LittleFSStoreBackend storeBackend;
+
+    TaskHandle_t replayMessageManager_TaskHandle = NULL;
+
+    void createSendWorker(messagePort port);
+
+    static void sendLoop(void* parameters);
+
+    void createReplayWorker();
+
+    static void replayLoop(void* parameters);
+
+    static bool canReplay();
+
+    static void storeMessage(DataMessage* message);
+
+    void dispatchMessage(messagePort port, DataMessage* message);
+
+    bool serialize(DataMessage* message, JsonDocument& doc);
+
     //TODO: Fix that to a specific sender
     static void sendMessageLoRaMesher(DataMessage* message);
 
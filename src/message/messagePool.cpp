@@ -0,0 +1,176 @@
+#include "messagePool.h"
+
+static const char* POOL_TAG = "MessagePool";
+
+static_assert(MESSAGE_POOL_SLOTS + MESSAGE_POOL_LARGE_SLOTS <= 256, "The free lists keep the slot index in 8 bits");
+static_assert(MESSAGE_POOL_LARGE_SLOT_SIZE >= MESSAGE_POOL_SLOT_SIZE, "The large slots must be the biggest ones");
+
+MessagePool::MessagePool() {
+    classes[0].memory = &smallSlots[0][0];
+    classes[0].slotSize = MESSAGE_POOL_SLOT_SIZE;
+    classes[0].slots = MESSAGE_POOL_SLOTS;
+    classes[0].refCount = refCount;
+    classes[0].freeSlots = freeSlots;
+
+    classes[1].memory = &largeSlots[0][0];
+    classes[1].slotSize = MESSAGE_POOL_LARGE_SLOT_SIZE;
+    classes[1].slots = MESSAGE_POOL_LARGE_SLOTS;
+    classes[1].refCount = refCount + MESSAGE_POOL_SLOTS;
+    classes[1].freeSlots = freeSlots + MESSAGE_POOL_SLOTS;
+
+    for (SlotClass& slotClass : classes) {
+        for (size_t i = 0; i < slotClass.slots; i++) {
+            slotClass.refCount[i] = 0;
+            slotClass.freeSlots[i] = slotClass.slots - 1 - i;
+        }
+        slotClass.freeCount = slotClass.slots;
+    }
+}
+
+void* MessagePool::alloc(size_t size) {
+    SlotClass* slotClass = nullptr;
+    if (size <= MESSAGE_POOL_SLOT_SIZE)
+        slotClass = &classes[0];
+    else if (size <= MESSAGE_POOL_LARGE_SLOT_SIZE)
+        slotClass = &classes[1];
+
+    portENTER_CRITICAL(&poolMux);
+    if (slotClass && slotClass->freeCount > 0) {
+        uint8_t slot = slotClass->freeSlots[--slotClass->freeCount];
+        slotClass->refCount[slot] = 1;
+        slotClass->allocations++;
+
+        size_t inUse = slotClass->slots - slotClass->freeCount;
+        if (inUse > slotClass->highWater)
+            slotClass->highWater = inUse;
+
+        portEXIT_CRITICAL(&poolMux);
+        return slotClass->memory + slot * slotClass->slotSize;
+    }
+
+    if (slotClass)
+        slotClass->exhausted++;
+    else {
+        oversized++;
+        if (size > largestOversized)
+            largestOversized = size;
+    }
+    portEXIT_CRITICAL(&poolMux);
+
+    HeapHeader* header = (HeapHeader*) pvPortMalloc(sizeof(HeapHeader) + size);
+    if (!header) {
+        ESP_LOGE(POOL_TAG, "Not enough memory to allocate %d bytes", size);
+        return nullptr;
+    }
+
+    header->refCount = 1;
+
+    portENTER_CRITICAL(&poolMux);
+    heapAllocations++;
+    portEXIT_CRITICAL(&poolMux);
+
+    ESP_LOGW(POOL_TAG, "Allocated %d bytes in the heap", size);
+    return header + 1;
+}
+
+void MessagePool::retain(void* buffer) {
+    if (!buffer)
+        return;
+
+    SlotClass* slotClass = getSlotClass(buffer);
+
+    portENTER_CRITICAL(&poolMux);
+    if (slotClass)
+        slotClass->refCount[slotIndex(slotClass, buffer)]++;
+    else
+        (((HeapHeader*) buffer) - 1)->refCount++;
+    portEXIT_CRITICAL(&poolMux);
+}
+
+void MessagePool::release(void* buffer) {
+    if (!buffer)
+        return;
+
+    SlotClass* slotClass = getSlotClass(buffer);
+
+    if (slotClass) {
+        int slot = slotIndex(slotClass, buffer);
+        portENTER_CRITICAL(&poolMux);
+        if (slotClass->refCount[slot] > 0 && --slotClass->refCount[slot] == 0)
+            slotClass->freeSlots[slotClass->freeCount++] = slot;
+        portEXIT_CRITICAL(&poolMux);
+        return;
+    }
+
+    HeapHeader* header = ((HeapHeader*) buffer) - 1;
+
+    portENTER_CRITICAL(&poolMux);
+    bool lastReference = --header->refCount == 0;
+    portEXIT_CRITICAL(&poolMux);
+
+    if (lastReference)
+        vPortFree(header);
+}
+
+bool MessagePool::owns(const void* buffer) {
+    return getSlotClass(buffer) != nullptr;
+}
+
+size_t MessagePool::slotsInUse() {
+    portENTER_CRITICAL(&poolMux);
+    size_t inUse = 0;
+    for (const SlotClass& slotClass : classes)
+        inUse += slotClass.slots - slotClass.freeCount;
+    portEXIT_CRITICAL(&poolMux);
+    return inUse;
+}
+
+String MessagePool::getStats() {
+    portENTER_CRITICAL(&poolMux);
+    SlotClass small = classes[0];
+    SlotClass large = classes[1];
+    uint32_t heapAllocs = heapAllocations;
+    uint32_t oversizedCount = oversized;
+    size_t largest = largestOversized;
+    portEXIT_CRITICAL(&poolMux);
+
+    return "Pool slots in use: " + String(small.slots - small.freeCount) + "/" + String(small.slots) +
+        " of " + String(small.slotSize) + " bytes (max " + String(small.highWater) + "), " +
+        String(large.slots - large.freeCount) + "/" + String(large.slots) +
+        " of " + String(large.slotSize) + " bytes (max " + String(large.highWater) + ")\n" +
+        "Pool allocations: " + String(small.allocations) + " of " + String(small.slotSize) + " bytes, " +
+        String(large.allocations) + " of " + String(large.slotSize) + " bytes\n" +
+        "Heap allocations: " + String(heapAllocs) + " (up to " + String(small.slotSize) + " bytes " +
+        String(small.exhausted) + ", up to " + String(large.slotSize) + " bytes " + String(large.exhausted) +
+        ", bigger " + String(oversizedCount) + ", largest " + String(largest) + " bytes)\n";
+}
+
+void MessagePool::resetStats() {
+    portENTER_CRITICAL(&poolMux);
+    for (SlotClass& slotClass : classes) {
+        slotClass.allocations = 0;
+        slotClass.exhausted = 0;
+        slotClass.highWater = slotClass.slots - slotClass.freeCount;
+    }
+    heapAllocations = 0;
+    oversized = 0;
+    largestOversized = 0;
+    portEXIT_CRITICAL(&poolMux);
+}
+
+MessagePool::SlotClass* MessagePool::getSlotClass(const void* buffer) {
+    for (SlotClass& slotClass : classes) {
+        if (slotIndex(&slotClass, buffer) >= 0)
+            return &slotClass;
+    }
+    return nullptr;
+}
+
+int MessagePool::slotIndex(const SlotClass* slotClass, const void* buffer) {
+    const uint8_t* ptr = (const uint8_t*) buffer;
+
+    if (ptr < slotClass->memory || ptr >= slotClass->memory + slotClass->slots * slotClass->slotSize)
+        return -1;
+
+    return (ptr - slotClass->memory) / slotClass->slotSize;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+/**
+ * @brief Fixed-size, reference counted buffers for the DataMessage pipeline
+ *
+ * The slots are reserved statically, so getting and returning a message does not touch the heap.
+ * There are two slot sizes, the requests bigger than MESSAGE_POOL_SLOT_SIZE, like the monitor frames
+ * and the reassembled fragments, take a large slot. Requests bigger than a large slot, or made while
+ * every slot of their size is busy, fall back to pvPortMalloc and are counted per size, so in steady
+ * state the heap allocations should not move.
+ *
+ * A buffer starts with one reference. Every consumer that keeps it after returning must call retain()
+ * and later release(). The memory is reused when the last reference is released.
+ */
+class MessagePool {
+public:
+    MessagePool();
+
+    /**
+     * @brief Get a buffer of at least size bytes
+     *
+     * @param size Size in bytes, including the DataMessage header
+     * @return void* Buffer with one reference, nullptr if there is no memory left
+     */
+    void* alloc(size_t size);
+
+    /**
+     * @brief Add a reference to a buffer obtained with alloc
+     *
+     * @param buffer Buffer
+     */
+    void retain(void* buffer);
+
+    /**
+     * @brief Drop a reference to a buffer obtained with alloc, the buffer is reused when it reaches 0
+     *
+     * @param buffer Buffer
+     */
+    void release(void* buffer);
+
+    /**
+     * @brief If the buffer is one of the pool slots
+     *
+     * @param buffer Buffer
+     * @return true If it is inside the pool
+     * @return false If it was allocated in the heap
+     */
+    bool owns(const void* buffer);
+
+    size_t slotsInUse();
+
+    String getStats();
+
+    void resetStats();
+
+private:
+    struct HeapHeader {
+        uint32_t refCount;
+    };
+
+    /**
+     * @brief Slots of one size, with their free list and counters
+     *
+     */
+    struct SlotClass {
+        uint8_t* memory;
+        size_t slotSize;
+        size_t slots;
+        uint8_t* refCount;
+        uint8_t* freeSlots;
+        size_t freeCount;
+        uint32_t allocations = 0;
+        uint32_t exhausted = 0;
+        size_t highWater = 0;
+    };
+
+    alignas(4) uint8_t smallSlots[MESSAGE_POOL_SLOTS][MESSAGE_POOL_SLOT_SIZE];
+
+    alignas(4) uint8_t largeSlots[MESSAGE_POOL_LARGE_SLOTS][MESSAGE_POOL_LARGE_SLOT_SIZE];
+
+    uint8_t refCount[MESSAGE_POOL_SLOTS + MESSAGE_POOL_LARGE_SLOTS];
+
+    uint8_t freeSlots[MESSAGE_POOL_SLOTS + MESSAGE_POOL_LARGE_SLOTS];
+
+    SlotClass classes[2];
+
+    portMUX_TYPE poolMux = portMUX_INITIALIZER_UNLOCKED;
+
+    uint32_t heapAllocations = 0;
+    uint32_t oversized = 0;
+    size_t largestOversized = 0;
+
+    SlotClass* getSlotClass(const void* buffer);
+
+    int slotIndex(const SlotClass* slotClass, const void* buffer);
+};
@@ -0,0 +1,101 @@
+#include "messageSchema.h"
+
+static uint64_t readUnsigned(const uint8_t* data, uint8_t size) {
+    uint64_t value = 0;
+    memcpy(&value, data, size);
+    return value;
+}
+
+static int64_t readSigned(const uint8_t* data, uint8_t size) {
+    uint8_t shift = 64 - 8 * size;
+    return ((int64_t) (readUnsigned(data, size) << shift)) >> shift;
+}
+
+void MessageSchema::serialize(DataMessage* message, JsonObject& doc) const {
+    message->serialize(doc);
+
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        const SchemaField& field = fields[i];
+        const uint8_t* data = message->message + field.offset;
+
+        switch (field.kind) {
+            case FloatField:
+                if (field.size == sizeof(float)) {
+                    float value;
+                    memcpy(&value, data, sizeof(value));
+                    doc[field.name] = value;
+                }
+                else {
+                    double value;
+                    memcpy(&value, data, sizeof(value));
+                    doc[field.name] = value;
+                }
+                break;
+            case SignedField:
+                if (field.size <= sizeof(int32_t))
+                    doc[field.name] = (int32_t) readSigned(data, field.size);
+                else
+                    doc[field.name] = readSigned(data, field.size);
+                break;
+            default:
+                if (field.size <= sizeof(uint32_t))
+                    doc[field.name] = (uint32_t) readUnsigned(data, field.size);
+                else
+                    doc[field.name] = readUnsigned(data, field.size);
+                break;
+        }
+    }
+}
+
+void MessageSchema::deserialize(DataMessage* message, JsonObject& doc) const {
+    message->deserialize(doc);
+    message->messageSize = payloadSize;
+
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        const SchemaField& field = fields[i];
+        uint8_t* data = message->message + field.offset;
+
+        if (field.kind == FloatField && field.size == sizeof(float)) {
+            float value = doc[field.name].as<float>();
+            memcpy(data, &value, sizeof(value));
+        }
+        else if (field.kind == FloatField) {
+            double value = doc[field.name].as<double>();
+            memcpy(data, &value, sizeof(value));
+        }
+        else {
+            // Little endian, the low bytes hold the value for every size
+            uint64_t value = field.kind == SignedField ? (uint64_t) doc[field.name].as<int64_t>() : doc[field.name].as<uint64_t>();
+            memcpy(data, &value, field.size);
+        }
+    }
+}
+
+void MessageSchema::encode(DataMessage* message, MsgPackWriter& writer) const {
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        const SchemaField& field = fields[i];
+        const uint8_t* data = message->message + field.offset;
+
+        if (field.kind == FloatField && field.size == sizeof(float)) {
+            float value;
+            memcpy(&value, data, sizeof(value));
+            writer.writeFloat(value);
+        }
+        else if (field.kind == FloatField) {
+            double value;
+            memcpy(&value, data, sizeof(value));
+            writer.writeDouble(value);
+        }
+        else if (field.kind == SignedField)
+            writer.writeSigned(readSigned(data, field.size));
+        else
+            writer.writeUnsigned(readUnsigned(data, field.size));
+    }
+}
+
+DataMessage* MessageSchema::create(JsonObject& doc) const {
+    DataMessage* message = (DataMessage*) ::operator new(sizeof(DataMessageGeneric) + payloadSize);
+    memset(message, 0, sizeof(DataMessageGeneric) + payloadSize);
+    deserialize(message, doc);
+    return message;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <ArduinoJson.h>
+
+#include <stddef.h>
+
+#include <type_traits>
+
+#include "dataMessage.h"
+
+#include "msgPackWriter.h"
+
+enum SchemaFieldKind: uint8_t {
+    UnsignedField = 0, //Also the enums, all of them are unsigned
+    SignedField = 1,
+    FloatField = 2,
+};
+
+/**
+ * @brief Field of a message payload, the JSON key and how it is stored
+ */
+struct SchemaField {
+    const char* name;
+    uint8_t size;
+    SchemaFieldKind kind;
+    uint16_t offset; //From the start of the payload
+};
+
+template<typename T>
+constexpr SchemaFieldKind schemaFieldKind() {
+    return std::is_floating_point<T>::value ? FloatField : (std::is_signed<T>::value ? SignedField : UnsignedField);
+}
+
+/**
+ * @brief If the fields follow each other from offset without gaps and end at size
+ */
+constexpr bool schemaCoversPayload(const SchemaField* fields, size_t count, size_t offset, size_t size) {
+    return count == 0 ? offset == size :
+        fields[0].offset == offset && schemaCoversPayload(fields + 1, count - 1, offset + fields[0].size, size);
+}
+
+/**
+ * @brief Description of a packed message, generated with MESSAGE_SCHEMA
+ *
+ * The fields follow the declaration order after DataMessageGeneric, the members of nested structs are
+ * listed one by one. The wire format is the packed struct itself, so decoding a received message is a
+ * size check and a cast.
+ * A schema with a tail only describes the fixed start of the payload, the rest is read by the service.
+ */
+struct MessageSchema {
+    const char* name;
+    const SchemaField* fields;
+    uint8_t fieldCount;
+    uint16_t payloadSize;
+    bool tail;
+
+    /**
+     * @brief Add the header and the fields of the message to the JSON object
+     */
+    void serialize(DataMessage* message, JsonObject& doc) const;
+
+    /**
+     * @brief Read the header and the fields of the message from the JSON object, sets the messageSize
+     */
+    void deserialize(DataMessage* message, JsonObject& doc) const;
+
+    /**
+     * @brief Create a message from the JSON object, it is deleted by the caller
+     */
+    DataMessage* create(JsonObject& doc) const;
+
+    /**
+     * @brief Write the fields positionally as MessagePack values, fieldCount values in declaration order
+     */
+    void encode(DataMessage* message, MsgPackWriter& writer) const;
+
+    /**
+     * @brief If a received message has the size of the schema, or is longer when there is a tail
+     */
+    bool validate(DataMessage* message) const {
+        return tail ? message->messageSize >= payloadSize : message->messageSize == payloadSize;
+    }
+};
+
+#define SCHEMA_FIELD(Message, field) SCHEMA_FIELD_AS(Message, field, #field)
+
+#define SCHEMA_FIELD_AS(Message, field, key) \
+    {key, sizeof(((Message*) 0)->field), schemaFieldKind<decltype(((Message*) 0)->field)>(), \
+        offsetof(Message, field) - sizeof(DataMessageGeneric)}
+
+// The messages derive from DataMessageGeneric, offsetof is conditionally supported there but GCC handles it
+#define MESSAGE_SCHEMA_DEFINE(Message, tail, ...) \
+    _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Winvalid-offsetof\"") \
+    static constexpr SchemaField Message##SchemaFields[] = {__VA_ARGS__}; \
+    _Pragma("GCC diagnostic pop") \
+    static_assert(schemaCoversPayload(Message##SchemaFields, sizeof(Message##SchemaFields) / sizeof(SchemaField), 0, \
+        sizeof(Message) - sizeof(DataMessageGeneric)), #Message " schema does not match its packed layout"); \
+    static constexpr MessageSchema Message##Schema = {#Message, Message##SchemaFields, \
+        sizeof(Message##SchemaFields) / sizeof(SchemaField), sizeof(Message) - sizeof(DataMessageGeneric), tail}
+
+/**
+ * @brief Declare the fields of a message once, it defines Message##Schema
+ *
+ * Fails to compile if the fields are not in order or do not cover the whole packed payload of the message.
+ */
+#define MESSAGE_SCHEMA(Message, ...) MESSAGE_SCHEMA_DEFINE(Message, false, __VA_ARGS__)
+
+/**
+ * @brief Same as MESSAGE_SCHEMA for a message that ends with a flexible array, received messages can be longer
+ */
+#define MESSAGE_SCHEMA_WITH_TAIL(Message, ...) MESSAGE_SCHEMA_DEFINE(Message, true, __VA_ARGS__)
@@ -4,10 +4,18 @@
 
 #include "dataMessage.h"
 
+#include "messageSchema.h"
+
 #include "commands/commandService.h"
 
 static const char* MS_TAG = "MessageService";
 
+//Encodings of the messages sent to the server
+enum messageCodec: uint8_t {
+    JsonCodec = 0,
+    MsgPackCodec = 1, //Positional array from encode(), a map of the JSON document if there is none
+};
+
 class MessageService {
 public:
     MessageService(uint8_t id, String name) {
@@ -17,16 +25,61 @@ public:
     virtual void processReceivedMessage(messagePort port, DataMessage* message) {
         ESP_LOGE(MS_TAG, "processReceivedMessage not implemented for service %s", serviceName.c_str());
     };
-    virtual void getJSON(DataMessage* message, String &json) {
-        ESP_LOGE(MS_TAG, "getJSON not implemented for service %s", serviceName.c_str());
+    /**
+     * @brief Fill the document with the message, it is encoded afterwards with the codec of the topic
+     *
+     * @param message Message
+     * @param doc Document
+     */
+    virtual void serialize(DataMessage* message, JsonDocument& doc) {
+        if (schema) {
+            JsonObject data = doc.createNestedObject("data");
+            schema->serialize(message, data);
+            return;
+        }
+        ESP_LOGE(MS_TAG, "serialize not implemented for service %s", serviceName.c_str());
+    };
+    /**
+     * @brief Write the message as one MessagePack array, the header and then the values in schema order
+     *
+     * The field names are not sent, scripts/mqttMsgPackBridge.py knows the layout of every appPort.
+     *
+     * @return true If the message has been written, false to send it as a map of the JSON document
+     */
+    virtual bool encode(DataMessage* message, MsgPackWriter& writer) {
+        const MessageSchema* messageSchema = getSchema(message);
+        if (!messageSchema || messageSchema->tail)
+            return false;
+
+        writer.writeArray(DataMessageGeneric::ENCODED_HEADER_SIZE + messageSchema->fieldCount);
+        message->encode(writer);
+        messageSchema->encode(message, writer);
+        return true;
     };
     TaskHandle_t receiveMessage_TaskHandle = NULL;
     xQueueHandle xQueueReceived;
     uint8_t serviceId;
     String serviceName;
     CommandService* commandService;
+    /**
+     * @brief Schema of the messages of the service, if they all have the same layout
+     *
+     * It is used by default to serialize, to create the messages from JSON and to drop the received
+     * messages with a wrong size.
+     */
+    const MessageSchema* schema = nullptr;
+    /**
+     * @brief Schema of a message, the services with several layouts choose it from the message
+     *
+     * @return const MessageSchema* Schema, nullptr if the message is not described by one
+     */
+    virtual const MessageSchema* getSchema(DataMessage* message) {
+        return schema;
+    }
     String toString() { return "Id: " + String(serviceId) + " - " + serviceName; }
     virtual DataMessage* getDataMessage(JsonObject data) {
+        if (schema)
+            return schema->create(data);
         ESP_LOGE(MS_TAG, "getDataMessage not implemented for service %s", serviceName.c_str());
         return nullptr;
     };
@@ -0,0 +1,99 @@
+#include "msgPackWriter.h"
+
+void MsgPackWriter::writeArray(uint32_t count) {
+    if (count <= 15)
+        write(0x90 | count);
+    else if (count <= UINT16_MAX)
+        writeBigEndian(0xdc, count, 2);
+    else
+        writeBigEndian(0xdd, count, 4);
+}
+
+void MsgPackWriter::writeUnsigned(uint64_t value) {
+    if (value <= 0x7f)
+        write(value);
+    else if (value <= UINT8_MAX)
+        writeBigEndian(0xcc, value, 1);
+    else if (value <= UINT16_MAX)
+        writeBigEndian(0xcd, value, 2);
+    else if (value <= UINT32_MAX)
+        writeBigEndian(0xce, value, 4);
+    else
+        writeBigEndian(0xcf, value, 8);
+}
+
+void MsgPackWriter::writeSigned(int64_t value) {
+    if (value >= 0)
+        writeUnsigned(value);
+    else if (value >= -32)
+        write((uint8_t) (int8_t) value);
+    else if (value >= INT8_MIN)
+        writeBigEndian(0xd0, (uint8_t) value, 1);
+    else if (value >= INT16_MIN)
+        writeBigEndian(0xd1, (uint16_t) value, 2);
+    else if (value >= INT32_MIN)
+        writeBigEndian(0xd2, (uint32_t) value, 4);
+    else
+        writeBigEndian(0xd3, (uint64_t) value, 8);
+}
+
+void MsgPackWriter::writeFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    writeBigEndian(0xca, bits, 4);
+}
+
+void MsgPackWriter::writeDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    writeBigEndian(0xcb, bits, 8);
+}
+
+void MsgPackWriter::writeString(const char* value, size_t valueLength) {
+    writeHeader(valueLength, 0xa0, 31, 0xd9, 0xda, 0xdb);
+    write((const uint8_t*) value, valueLength);
+}
+
+void MsgPackWriter::writeBinary(const uint8_t* data, size_t dataLength) {
+    writeHeader(dataLength, 0, 0, 0xc4, 0xc5, 0xc6);
+    write(data, dataLength);
+}
+
+void MsgPackWriter::writeNil() {
+    write(0xc0);
+}
+
+void MsgPackWriter::write(uint8_t value) {
+    if (length >= size) {
+        overflow = true;
+        return;
+    }
+    buffer[length++] = value;
+}
+
+void MsgPackWriter::write(const uint8_t* data, size_t dataLength) {
+    if (size - length < dataLength) {
+        overflow = true;
+        return;
+    }
+    memcpy(buffer + length, data, dataLength);
+    length += dataLength;
+}
+
+void MsgPackWriter::writeBigEndian(uint8_t type, uint64_t value, uint8_t bytes) {
+    write(type);
+    for (int8_t i = bytes - 1; i >= 0; i--)
+        write((uint8_t) (value >> (8 * i)));
+}
+
+void MsgPackWriter::writeHeader(uint32_t count, uint8_t fixType, uint8_t fixMax, uint8_t type8, uint8_t type16, uint8_t type32) {
+    // fixMax 0 means there is no fix format, bin has none
+    if (fixMax > 0 && count <= fixMax)
+        write(fixType | count);
+    else if (count <= UINT8_MAX)
+        writeBigEndian(type8, count, 1);
+    else if (count <= UINT16_MAX)
+        writeBigEndian(type16, count, 2);
+    else
+        writeBigEndian(type32, count, 4);
+}
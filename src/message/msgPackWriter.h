@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Writes MessagePack straight into a caller-owned buffer
+ *
+ * Each value uses the smallest encoding that holds it. Nothing is allocated, when the buffer is full the
+ * writer stops and reports overflowed().
+ */
+class MsgPackWriter {
+public:
+    MsgPackWriter(uint8_t* buffer, size_t size): buffer(buffer), size(size) {}
+
+    /**
+     * @brief Start an array, the next count values are its elements
+     */
+    void writeArray(uint32_t count);
+
+    void writeUnsigned(uint64_t value);
+
+    void writeSigned(int64_t value);
+
+    void writeFloat(float value);
+
+    void writeDouble(double value);
+
+    void writeString(const char* value, size_t length);
+
+    void writeBinary(const uint8_t* data, size_t length);
+
+    void writeNil();
+
+    size_t getLength() { return length; }
+
+    bool overflowed() { return overflow; }
+
+private:
+    uint8_t* buffer;
+    size_t size;
+    size_t length = 0;
+    bool overflow = false;
+
+    void write(uint8_t value);
+
+    void write(const uint8_t* data, size_t dataLength);
+
+    /**
+     * @brief Type byte followed by the value big endian
+     */
+    void writeBigEndian(uint8_t type, uint64_t value, uint8_t bytes);
+
+    void writeHeader(uint32_t count, uint8_t fixType, uint8_t fixMax, uint8_t type8, uint8_t type16, uint8_t type32);
+};
@@ -0,0 +1,99 @@
+#include "storeBackend.h"
+
+#include <LittleFS.h>
+
+#include "config.h"
+
+static const char* STORE_TAG = "StoreBackend";
+
+bool LittleFSStoreBackend::begin() {
+    if (!LittleFS.begin(true)) {
+        ESP_LOGE(STORE_TAG, "LittleFS mount failed");
+        return false;
+    }
+
+    if (!LittleFS.exists(STORE_FORWARD_DIR) && !LittleFS.mkdir(STORE_FORWARD_DIR)) {
+        ESP_LOGE(STORE_TAG, "Could not create %s", STORE_FORWARD_DIR);
+        return false;
+    }
+
+    ESP_LOGI(STORE_TAG, "LittleFS mounted, %d of %d bytes used", LittleFS.usedBytes(), LittleFS.totalBytes());
+    return true;
+}
+
+bool LittleFSStoreBackend::append(uint32_t segment, const uint8_t* data, size_t size) {
+    File file = LittleFS.open(getPath(segment), FILE_APPEND);
+    if (!file)
+        return false;
+
+    size_t written = file.write(data, size);
+    file.close();
+    return written == size;
+}
+
+size_t LittleFSStoreBackend::read(uint32_t segment, size_t offset, uint8_t* data, size_t size) {
+    File file = LittleFS.open(getPath(segment), FILE_READ);
+    if (!file)
+        return 0;
+
+    size_t bytesRead = 0;
+    if (file.seek(offset))
+        bytesRead = file.read(data, size);
+    file.close();
+    return bytesRead;
+}
+
+bool LittleFSStoreBackend::remove(uint32_t segment) {
+    return LittleFS.remove(getPath(segment));
+}
+
+bool LittleFSStoreBackend::getRange(uint32_t& first, uint32_t& last) {
+    File dir = LittleFS.open(STORE_FORWARD_DIR);
+    if (!dir || !dir.isDirectory())
+        return false;
+
+    bool found = false;
+    for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+        char* end;
+        uint32_t segment = strtoul(file.name(), &end, 16);
+        if (strcmp(end, ".log") != 0)
+            continue;
+
+        if (!found || segment < first)
+            first = segment;
+        if (!found || segment > last)
+            last = segment;
+        found = true;
+    }
+    return found;
+}
+
+bool LittleFSStoreBackend::writeState(const uint8_t* data, size_t size) {
+    // Write a copy and rename it, the rename is atomic in LittleFS
+    File file = LittleFS.open(STORE_FORWARD_DIR "/state.tmp", FILE_WRITE);
+    if (!file)
+        return false;
+
+    size_t written = file.write(data, size);
+    file.close();
+    if (written != size)
+        return false;
+
+    return LittleFS.rename(STORE_FORWARD_DIR "/state.tmp", STORE_FORWARD_DIR "/state");
+}
+
+size_t LittleFSStoreBackend::readState(uint8_t* data, size_t size) {
+    File file = LittleFS.open(STORE_FORWARD_DIR "/state", FILE_READ);
+    if (!file)
+        return 0;
+
+    size_t bytesRead = file.read(data, size);
+    file.close();
+    return bytesRead;
+}
+
+String LittleFSStoreBackend::getPath(uint32_t segment) {
+    char path[32];
+    snprintf(path, sizeof(path), STORE_FORWARD_DIR "/%08lx.log", (unsigned long) segment);
+    return String(path);
+}
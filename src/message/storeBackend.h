@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <map>
+#include <vector>
+
+/**
+ * @brief Storage of the store and forward log
+ *
+ * The log is split in numbered segments that are only appended to, read and removed, so the
+ * backend never rewrites data in place. The segments always form a contiguous range of ids.
+ * A small state blob keeps the replay cursor.
+ */
+class StoreBackend {
+public:
+    virtual ~StoreBackend() {}
+
+    virtual bool begin() = 0;
+
+    /**
+     * @brief Append data at the end of a segment, creating it if needed
+     *
+     * @return true If all the data has been written and synced
+     */
+    virtual bool append(uint32_t segment, const uint8_t* data, size_t size) = 0;
+
+    /**
+     * @brief Read data of a segment
+     *
+     * @return size_t Bytes read, less than size at the end of the segment
+     */
+    virtual size_t read(uint32_t segment, size_t offset, uint8_t* data, size_t size) = 0;
+
+    virtual bool remove(uint32_t segment) = 0;
+
+    /**
+     * @brief Get the ids of the first and the last segment stored
+     *
+     * @return true If there is at least one segment
+     */
+    virtual bool getRange(uint32_t& first, uint32_t& last) = 0;
+
+    /**
+     * @brief Replace the state blob, the old one must survive if it fails
+     */
+    virtual bool writeState(const uint8_t* data, size_t size) = 0;
+
+    virtual size_t readState(uint8_t* data, size_t size) = 0;
+};
+
+/**
+ * @brief Backend in LittleFS, one file per segment inside STORE_FORWARD_DIR
+ *
+ * LittleFS is copy on write, a file only changes when it is closed, so a reset in the middle of an
+ * append leaves at most a torn record at the end of the segment.
+ */
+class LittleFSStoreBackend: public StoreBackend {
+public:
+    bool begin() override;
+
+    bool append(uint32_t segment, const uint8_t* data, size_t size) override;
+
+    size_t read(uint32_t segment, size_t offset, uint8_t* data, size_t size) override;
+
+    bool remove(uint32_t segment) override;
+
+    bool getRange(uint32_t& first, uint32_t& last) override;
+
+    bool writeState(const uint8_t* data, size_t size) override;
+
+    size_t readState(uint8_t* data, size_t size) override;
+
+private:
+    static String getPath(uint32_t segment);
+};
+
+/**
+ * @brief Backend in RAM, it does not survive a reset, used to test the log on the host
+ *
+ * failAfter makes the appends fail once that many bytes have been written, to emulate a torn write.
+ */
+class RamStoreBackend: public StoreBackend {
+public:
+    size_t failAfter = SIZE_MAX;
+
+    bool begin() override { return true; }
+
+    bool append(uint32_t segment, const uint8_t* data, size_t size) override {
+        std::vector<uint8_t>& file = segments[segment];
+        size_t written = size < failAfter ? size : failAfter;
+        file.insert(file.end(), data, data + written);
+        failAfter -= written;
+        return written == size;
+    }
+
+    size_t read(uint32_t segment, size_t offset, uint8_t* data, size_t size) override {
+        auto it = segments.find(segment);
+        if (it == segments.end() || offset >= it->second.size())
+            return 0;
+        size_t available = it->second.size() - offset;
+        if (size > available)
+            size = available;
+        memcpy(data, it->second.data() + offset, size);
+        return size;
+    }
+
+    bool remove(uint32_t segment) override {
+        return segments.erase(segment) > 0;
+    }
+
+    bool getRange(uint32_t& first, uint32_t& last) override {
+        if (segments.empty())
+            return false;
+        first = segments.begin()->first;
+        last = segments.rbegin()->first;
+        return true;
+    }
+
+    bool writeState(const uint8_t* data, size_t size) override {
+        state.assign(data, data + size);
+        return true;
+    }
+
+    size_t readState(uint8_t* data, size_t size) override {
+        if (size > state.size())
+            size = state.size();
+        memcpy(data, state.data(), size);
+        return size;
+    }
+
+private:
+    std::map<uint32_t, std::vector<uint8_t>> segments;
+
+    std::vector<uint8_t> state;
+};
@@ -0,0 +1,231 @@
+#include "storeForward.h"
+
+#include <stddef.h>
+
+static const char* SF_TAG = "StoreForward";
+
+#define STORE_RECORD_MAGIC 0x5F5A
+#define STORE_CURSOR_MAGIC 0x5F43A001
+
+static_assert(STORE_FORWARD_SEGMENT_SIZE <= UINT16_MAX, "STORE_FORWARD_SEGMENT_SIZE must fit in the record size");
+
+bool StoreForward::begin(StoreBackend* storeBackend) {
+    if (!storeBackend->begin())
+        return false;
+
+    storeMutex = xSemaphoreCreateMutex();
+
+    uint32_t first = 0, last = 0;
+    bool hasSegments = storeBackend->getRange(first, last);
+
+    Cursor cursor;
+    bool hasCursor = storeBackend->readState((uint8_t*) &cursor, sizeof(Cursor)) == sizeof(Cursor) &&
+        cursor.magic == STORE_CURSOR_MAGIC &&
+        cursor.checksum == getChecksum((uint8_t*) &cursor, offsetof(Cursor, checksum));
+
+    // Write in a new segment, the last one may end with a torn record
+    writeSegment = hasSegments ? last + 1 : 0;
+    if (hasCursor && cursor.segment >= writeSegment)
+        writeSegment = cursor.segment + 1;
+    writeOffset = 0;
+    bootSegment = writeSegment;
+
+    readSegment = hasSegments ? first : writeSegment;
+    readOffset = 0;
+    if (hasCursor && cursor.segment >= readSegment && cursor.segment < writeSegment) {
+        // The segments before the cursor were replayed before the reset
+        while (readSegment < cursor.segment)
+            storeBackend->remove(readSegment++);
+        readOffset = cursor.offset;
+    }
+    cursorChanged = true;
+
+    backend = storeBackend;
+
+    ESP_LOGI(SF_TAG, "Store and forward log from segment %d:%d to %d", readSegment, readOffset, writeSegment);
+    return true;
+}
+
+bool StoreForward::store(DataMessage* message) {
+    if (!backend)
+        return false;
+
+    size_t size = message->getDataMessageSize();
+    if (sizeof(RecordHeader) + size > STORE_FORWARD_SEGMENT_SIZE) {
+        ESP_LOGW(SF_TAG, "Message of %d bytes too big to be stored", size);
+        return false;
+    }
+
+    RecordHeader header;
+    header.magic = STORE_RECORD_MAGIC;
+    header.size = size;
+    header.checksum = getChecksum((uint8_t*) message, size);
+
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+
+    if (writeOffset + sizeof(RecordHeader) + size > STORE_FORWARD_SEGMENT_SIZE) {
+        writeSegment++;
+        writeOffset = 0;
+    }
+
+    if (writeOffset == 0) {
+        while (writeSegment - readSegment >= STORE_FORWARD_SEGMENTS)
+            dropOldestSegment();
+    }
+
+    bool written = backend->append(writeSegment, (uint8_t*) &header, sizeof(RecordHeader)) &&
+        backend->append(writeSegment, (uint8_t*) message, size);
+
+    if (written) {
+        writeOffset += sizeof(RecordHeader) + size;
+        stored++;
+    }
+    else {
+        // The segment may end with a torn record now, continue in a new one
+        writeErrors++;
+        writeSegment++;
+        writeOffset = 0;
+    }
+
+    xSemaphoreGive(storeMutex);
+
+    if (!written)
+        ESP_LOGE(SF_TAG, "Error storing message %X:%d", message->addrSrc, message->messageId);
+
+    return written;
+}
+
+size_t StoreForward::peek() {
+    if (!backend)
+        return 0;
+
+    RecordHeader header;
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+    size_t size = peekLocked(header);
+    xSemaphoreGive(storeMutex);
+    return size;
+}
+
+bool StoreForward::pop(uint8_t* buffer, size_t size) {
+    if (!backend)
+        return false;
+
+    RecordHeader header;
+    bool valid = false;
+
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+
+    size_t messageSize = peekLocked(header);
+    if (messageSize > 0 && messageSize <= size) {
+        valid = backend->read(readSegment, readOffset + sizeof(RecordHeader), buffer, messageSize) == messageSize &&
+            getChecksum(buffer, messageSize) == header.checksum;
+
+        if (!valid) {
+            damagedRecords++;
+        }
+        else if (readSegment >= bootSegment && ((DataMessage*) buffer)->isExpired()) {
+            expired++;
+            valid = false;
+        }
+        else {
+            replayed++;
+        }
+
+        readOffset += sizeof(RecordHeader) + messageSize;
+        cursorChanged = true;
+    }
+
+    xSemaphoreGive(storeMutex);
+    return valid;
+}
+
+void StoreForward::commit() {
+    if (!backend)
+        return;
+
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+
+    if (cursorChanged) {
+        Cursor cursor;
+        cursor.magic = STORE_CURSOR_MAGIC;
+        cursor.segment = readSegment;
+        cursor.offset = readOffset;
+        cursor.checksum = getChecksum((uint8_t*) &cursor, offsetof(Cursor, checksum));
+
+        if (backend->writeState((uint8_t*) &cursor, sizeof(Cursor)))
+            cursorChanged = false;
+        else
+            writeErrors++;
+    }
+
+    xSemaphoreGive(storeMutex);
+}
+
+String StoreForward::getStats() {
+    if (!backend)
+        return "Store and forward disabled\n";
+
+    uint32_t segments = writeSegment - readSegment + (writeOffset > 0 ? 1 : 0);
+
+    return "Stored: " + String(stored) + "\n" +
+        "Replayed: " + String(replayed) + "\n" +
+        "Segments in use: " + String(segments) + " of " + String(STORE_FORWARD_SEGMENTS) + "\n" +
+        "Dropped segments: " + String(droppedSegments) + "\n" +
+        "Damaged records: " + String(damagedRecords) + "\n" +
+        "Expired: " + String(expired) + "\n" +
+        "Write errors: " + String(writeErrors) + "\n";
+}
+
+size_t StoreForward::peekLocked(RecordHeader& header) {
+    for (;;) {
+        if (readSegment == writeSegment && readOffset >= writeOffset) {
+            if (writeOffset > 0) {
+                // Everything has been replayed, give the flash of the segment back
+                backend->remove(writeSegment);
+                writeSegment++;
+                writeOffset = 0;
+                readSegment = writeSegment;
+                readOffset = 0;
+                cursorChanged = true;
+            }
+            return 0;
+        }
+
+        size_t headerSize = backend->read(readSegment, readOffset, (uint8_t*) &header, sizeof(RecordHeader));
+        if (headerSize == sizeof(RecordHeader) && header.magic == STORE_RECORD_MAGIC &&
+            readOffset + sizeof(RecordHeader) + header.size <= STORE_FORWARD_SEGMENT_SIZE)
+            return header.size;
+
+        // End of the segment, or a torn record left by a reset
+        if (headerSize != 0)
+            damagedRecords++;
+
+        if (readSegment == writeSegment) {
+            readOffset = writeOffset;
+            continue;
+        }
+
+        nextReadSegment();
+    }
+}
+
+void StoreForward::nextReadSegment() {
+    backend->remove(readSegment);
+    readSegment++;
+    readOffset = 0;
+    cursorChanged = true;
+}
+
+void StoreForward::dropOldestSegment() {
+    ESP_LOGW(SF_TAG, "Log full, dropping segment %d", readSegment);
+    nextReadSegment();
+    droppedSegments++;
+}
+
+uint32_t StoreForward::getChecksum(const uint8_t* data, size_t size) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
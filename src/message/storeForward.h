@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "dataMessage.h"
+
+#include "storeBackend.h"
+
+#include "config.h"
+
+/**
+ * @brief Append-only log of the uplinks that could not be sent, replayed when a gateway is back
+ *
+ * Every record is a header with a checksum followed by the DataMessage. The log is split in
+ * segments of STORE_FORWARD_SEGMENT_SIZE bytes: a segment is removed once it has been replayed,
+ * and the oldest one is dropped when STORE_FORWARD_SEGMENTS are in use, so the flash used is
+ * bounded and every block is written once per lap.
+ * After a reset the writes go to a new segment, and a torn record at the end of a segment only
+ * makes the reader skip to the next one. The replay cursor is saved by commit(), the messages read
+ * after the last commit are replayed again after a reset.
+ */
+class StoreForward {
+public:
+    /**
+     * @brief Open the log and restore the replay cursor
+     *
+     * @param backend Storage, it must outlive the log
+     * @return true If the log can be used
+     */
+    bool begin(StoreBackend* backend);
+
+    /**
+     * @brief Append a message at the end of the log
+     *
+     * @param message Message
+     * @return true If it has been stored
+     */
+    bool store(DataMessage* message);
+
+    /**
+     * @brief Get the size of the next message, skipping the damaged records
+     *
+     * @return size_t Size of the DataMessage, 0 if the log is empty
+     */
+    size_t peek();
+
+    /**
+     * @brief Read the next message and move the cursor after it
+     *
+     * Messages stored since the last reset are dropped when their deadline has passed, the older
+     * ones are kept because millis() has restarted.
+     *
+     * @param buffer Buffer of at least peek() bytes
+     * @param size Size of the buffer
+     * @return true If the message has been read, false if it was damaged or expired
+     */
+    bool pop(uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Save the replay cursor
+     *
+     */
+    void commit();
+
+    bool isEmpty() { return peek() == 0; }
+
+    String getStats();
+
+private:
+    struct RecordHeader {
+        uint16_t magic;
+        uint16_t size;
+        uint32_t checksum;
+    };
+
+    struct Cursor {
+        uint32_t magic;
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t checksum;
+    };
+
+    StoreBackend* backend = nullptr;
+
+    SemaphoreHandle_t storeMutex = NULL;
+
+    uint32_t firstSegment = 0;
+
+    uint32_t readSegment = 0;
+    uint32_t readOffset = 0;
+
+    uint32_t writeSegment = 0;
+    uint32_t writeOffset = 0;
+
+    uint32_t bootSegment = 0;
+
+    bool cursorChanged = false;
+
+    uint32_t stored = 0;
+    uint32_t replayed = 0;
+    uint32_t droppedSegments = 0;
+    uint32_t damagedRecords = 0;
+    uint32_t expired = 0;
+    uint32_t writeErrors = 0;
+
+    size_t peekLocked(RecordHeader& header);
+
+    void nextReadSegment();
+
+    void dropOldestSegment();
+
+    static uint32_t getChecksum(const uint8_t* data, size_t size);
+};
@@ -11,4 +11,49 @@ monCommandService::monCommandService() {
     //     [this](String args) {
     //     return String(Led::getInstance().ledOff(strtol(args.c_str(), NULL, 16)));
     // }));
+
+    addCommand(Command("/poolStats", "Get the message pool allocation counters", MonCommand::getPoolStats, 1,
+        [this](String args) {
+        return MessageManager::getInstance().pool.getStats();
+    }));
+
+    addCommand(Command("/dupStats", "Get the duplicated messages counters", MonCommand::getDuplicateStats, 1,
+        [this](String args) {
+        return MessageManager::getInstance().duplicates.getStats();
+    }));
+
+    addCommand(Command("/dupWindow", "Set the duplicated messages time window in ms", MonCommand::setDuplicateWindow, 1,
+        [this](String args) {
+        return MessageManager::getInstance().setDuplicateWindow(args);
+    }));
+
+    addCommand(Command("/sendStats", "Get the send queues counters", MonCommand::getSendStats, 1,
+        [this](String args) {
+        return MessageManager::getInstance().getSendStats();
+    }));
+
+    addCommand(Command("/trace", "Dump and clear the trace ring", MonCommand::getTrace, 1,
+        [this](String args) {
+        return TraceLog::getInstance().dump();
+    }));
+
+    addCommand(Command("/traceStats", "Get the trace ring counters", MonCommand::getTraceStats, 1,
+        [this](String args) {
+        return TraceLog::getInstance().getStats();
+    }));
+
+    addCommand(Command("/storeStats", "Get the store and forward log counters", MonCommand::getStoreStats, 1,
+        [this](String args) {
+        return MessageManager::getInstance().storeForward.getStats();
+    }));
+
+    addCommand(Command("/setTTL", "Set the ms a class of messages can wait in the queues, 0 never expires", MonCommand::setTTL, 1,
+        [this](String args) {
+        int trafficClass, ttl;
+        if (sscanf(args.c_str(), "%d %d", &trafficClass, &ttl) == 2 &&
+            (trafficClass < 0 || ttl < 0 || !MessageManager::getInstance().setTTL(trafficClass, ttl)))
+            return String("Invalid class or TTL");
+
+        return MessageManager::getInstance().getTTLs();
+    }));
 }
@@ -4,6 +4,8 @@
 
 #include "commands/commandService.h"
 
+#include "monServiceMessage.h"
+
 class monCommandService: public CommandService {
 public:
     monCommandService();
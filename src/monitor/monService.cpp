@@ -18,31 +18,36 @@ void MonService::init() {
   createSendingTask();
 }
 
-void MonService::getJSON(DataMessage *message, String &json) {
+void MonService::serialize(DataMessage *message, JsonDocument &doc) {
   monMessage *bm = (monMessage *)message;
-  StaticJsonDocument<3072> doc;
   JsonObject data = doc.createNestedObject("RT") ;
 
 #if defined(MON_MQTT_ONE_MESSAGE)
-    ESP_LOGD(MON_TAG, "getJSON: Serializing monOneMessage (ID: %d)", message->messageId);
+    TRACE("serialize: monOneMessage (ID: %d)", message->messageId);
     monOneMessage *mon = (monOneMessage *)message ;
     mon->serialize(data); // Assumes monOneMessage::serialize is correct
-    ESP_LOGD(MON_TAG, "getJSON: monOneMessage serialization complete.");
 #else
   // Legacy path - keep for completeness if MON_MQTT_ONE_MESSAGE might be undefined
   if ((bm->RTcount == MONCOUNT_MONONEMESSAGE) || (bm->messageSize != 17)) {
-    ESP_LOGD(MON_TAG, "getJSON: Serializing monOneMessage (ID: %d)", message->messageId);
+    TRACE("serialize: monOneMessage (ID: %d)", message->messageId);
     monOneMessage *mon = (monOneMessage *)message ;
     mon->serialize(data);
-     ESP_LOGD(MON_TAG, "getJSON: monOneMessage serialization complete.");
   } else {
-    ESP_LOGI(MON_TAG, "getJSON: monMessage->serialize"); // Legacy path
+    TRACE("serialize: monMessage (ID: %d)", message->messageId); // Legacy path
     bm->serialize(data);
   }
 #endif
+}
 
-  serializeJson(doc, json);
-  ESP_LOGD(MON_TAG, "getJSON: Final JSON string generated (first 100 chars): %.100s", json.c_str());
+bool MonService::encode(DataMessage *message, MsgPackWriter &writer) {
+#if !defined(MON_MQTT_ONE_MESSAGE)
+  // The legacy monMessage keeps the JSON map
+  monMessage *bm = (monMessage *)message;
+  if ((bm->RTcount != MONCOUNT_MONONEMESSAGE) && (bm->messageSize == 17))
+    return false;
+#endif
+  ((monOneMessage *)message)->encode(writer);
+  return true;
 }
 
 DataMessage *MonService::getDataMessage(JsonObject data) {
@@ -55,7 +60,11 @@ DataMessage *MonService::getDataMessage(JsonObject data) {
     if(data["number_of_neighbors"].is<int>()) {
         num_neighbors = data["number_of_neighbors"].as<int>();
     }
-    uint32_t calculated_messageSize = sizeof(monOneMessage) + sizeof(routing_entry) * num_neighbors;
+    uint16_t sensorDataSize = 0;
+    if (data["sensorData"].is<const char*>()) {
+        sensorDataSize = strlen(data["sensorData"].as<const char*>()) + 1;
+    }
+    uint32_t calculated_messageSize = monOneMessage::getMessageStructSize(num_neighbors, sensorDataSize);
     uint32_t payloadSize = calculated_messageSize - sizeof(DataMessageGeneric);
 
     monOneMessage* mon = (monOneMessage*) pvPortMalloc(calculated_messageSize);
@@ -64,7 +73,7 @@ DataMessage *MonService::getDataMessage(JsonObject data) {
          return nullptr;
     }
     new (mon) monOneMessage(); // Placement new to initialize members
-    mon->deserialize(data);    // Assumes deserialize handles sensorDataJson
+    mon->deserialize(data);
     mon->messageSize = payloadSize;
     return ((DataMessage *)mon);
 #else
@@ -121,11 +130,12 @@ void MonService::createSendingTask() {
 
 #if defined(MON_MQTT_ONE_MESSAGE)
 
-monOneMessage* MonService::createMONPayloadMessage(int number_of_neighbors) {
-    uint32_t messageStructSize = sizeof(monOneMessage) + sizeof(routing_entry) * number_of_neighbors;
+monOneMessage* MonService::createMONPayloadMessage(int number_of_neighbors, const String& sensorData) {
+    uint16_t sensorDataSize = sensorData.length() + 1;
+    uint32_t messageStructSize = monOneMessage::getMessageStructSize(number_of_neighbors, sensorDataSize);
     uint32_t payloadSize = messageStructSize - sizeof(DataMessageGeneric);
 
-    monOneMessage* MONMessage = (monOneMessage*) pvPortMalloc(messageStructSize);
+    monOneMessage* MONMessage = (monOneMessage*) MessageManager::getInstance().pool.alloc(messageStructSize);
 
     if (!MONMessage) {
         ESP_LOGE(MON_TAG, "Failed to allocate memory for monOneMessage (size: %d)!", messageStructSize);
@@ -139,7 +149,10 @@ monOneMessage* MonService::createMONPayloadMessage(int number_of_neighbors) {
     MONMessage->uptime = millis();
     MONMessage->TxQ = LoraMesher::getInstance().getSendQueueSize();
     MONMessage->RxQ = LoraMesher::getInstance().getReceivedQueueSize();
+    MONMessage->dutyCycleLeft = LoRaMeshService::getInstance().getDutyCycleLeft();
+    MONMessage->deferred = LoRaMeshService::getInstance().getDeferred();
     MONMessage->number_of_neighbors = number_of_neighbors;
+    MONMessage->setSensorData(sensorData.c_str(), sensorDataSize);
 
     #if defined(LORAMESHER_BMX)
     MONMessage->routingTableId = RoutingTableService::routingTableId;
@@ -215,67 +228,47 @@ void MonService::sendingLoopOneMessage(void *parameter) {
       ESP_LOGD(MON_TAG, "Stack HWM before RT processing: %d", uxHighWaterMark);
 
       RoutingTableService::printRoutingTable();
-      LM_LinkedList<RouteNode>* routingTableList = LoRaMeshService::getInstance().radio.routingTableListCopy();
-      if (routingTableList) {
-            uint16_t neighborCount = 0;
-            routingTableList->setInUse();
-            if (routingTableList->moveToStart()) {
-                do {
-                    RouteNode *rtn = routingTableList->getCurrent();
-                    if (rtn && rtn->networkNode.address == rtn->via) {
-                        neighborCount++;
-                    }
-                } while (routingTableList->next());
-                 ESP_LOGI(MON_TAG, "Found %d neighbors.", neighborCount);
-            } else {
-                 ESP_LOGD(MON_TAG, "Routing table copy is empty.");
-            }
-
-            monServiceInstance->monMessageId++;
-            monOneMessage *MONMessage = monServiceInstance->createMONPayloadMessage(neighborCount);
-            ESP_LOGD(MON_TAG, "createMONPayloadMessage returned: 0x%X", (uint32_t)MONMessage);
-
-            if (MONMessage) {
-                MONMessage->messageId = monServiceInstance->monMessageId;
-
-                if (neighborCount > 0) {
-                    routingTableList->moveToStart();
-                    int i = 0;
-                    do {
-                        RouteNode *rtn = routingTableList->getCurrent();
-                        if (rtn && rtn->networkNode.address == rtn->via && i < neighborCount) {
-                            MONMessage->rt[i++] = {
-                            rtn->networkNode.address,
-                            rtn->receivedSNR,
-                            rtn->SRTT,
-                            rtn->networkNode.metric
-                            };
-                        } else if (rtn && rtn->networkNode.address == rtn->via && i >= neighborCount) {
-                            ESP_LOGW(MON_TAG, "Neighbor count mismatch during RT population! Expected %d, got more.", neighborCount);
-                            break;
-                        }
-                    } while (routingTableList->next());
-                }
-
-                // Assign the potentially cleaned sensor data
-                MONMessage->sensorDataJson = monServiceInstance->currentSensorJsonData;
-                ESP_LOGD(MON_TAG, "Sensor Data assigned to MONMessage: '%s'", MONMessage->sensorDataJson.c_str());
-
-                ESP_LOGI(MON_TAG, "About to call MessageManager::getInstance().sendMessage(messagePort::MqttPort, ...); ID: %d", MONMessage->messageId);
-                MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage *)MONMessage);
-
-                // Memory MUST be freed by MM/MQTTService. Do NOT free here.
-                ESP_LOGW(MON_TAG, "Memory Warning: Ensure MONMessage (ID: %d) is freed by MM or MQTT!", MONMessage->messageId);
-            } else {
-                ESP_LOGE(MON_TAG, "Failed to create MONPayloadMessage, skipping send.");
-                 monServiceInstance->monMessageId--;
-            }
-            routingTableList->releaseInUse();
-            delete routingTableList;
-            routingTableList = nullptr;
+      const RoutingTableSnapshot* routingTable = LoRaMeshService::getInstance().acquireRoutingTable();
+      uint16_t neighborCount = routingTable->neighbors;
+      if (routingTable->size > 0) {
+           ESP_LOGI(MON_TAG, "Found %d neighbors.", neighborCount);
+      } else {
+           ESP_LOGD(MON_TAG, "Routing table is empty.");
+      }
+
+      monServiceInstance->monMessageId++;
+      monOneMessage *MONMessage = monServiceInstance->createMONPayloadMessage(neighborCount, monServiceInstance->currentSensorJsonData);
+      ESP_LOGD(MON_TAG, "createMONPayloadMessage returned: 0x%X", (uint32_t)MONMessage);
+
+      if (MONMessage) {
+          MONMessage->messageId = monServiceInstance->monMessageId;
+
+          int i = 0;
+          for (uint16_t r = 0; r < routingTable->size && i < neighborCount; r++) {
+              const RouteNode &rtn = routingTable->routes[r];
+              if (rtn.networkNode.address == rtn.via) {
+                  MONMessage->rt[i++] = {
+                  rtn.networkNode.address,
+                  rtn.receivedSNR,
+                  rtn.SRTT,
+                  rtn.networkNode.metric,
+                  LoRaMeshService::getInstance().getLinkEtx(rtn.via)
+                  };
+              }
+          }
+
+          ESP_LOGD(MON_TAG, "Sensor Data assigned to MONMessage: '%s'", MONMessage->getSensorData());
+
+          ESP_LOGI(MON_TAG, "About to call MessageManager::getInstance().sendMessage(messagePort::MqttPort, ...); ID: %d", MONMessage->messageId);
+          MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage *)MONMessage);
+
+          // The send worker keeps its own reference, drop ours
+          MessageManager::getInstance().pool.release(MONMessage);
       } else {
-            ESP_LOGE(MON_TAG, "Failed to get routing table copy.");
+          ESP_LOGE(MON_TAG, "Failed to create MONPayloadMessage, skipping send.");
+           monServiceInstance->monMessageId--;
       }
+      LoRaMeshService::getInstance().releaseRoutingTable(routingTable);
       ESP_LOGD(MON_TAG, "Free heap at end of loop: %d", esp_get_free_heap_size());
       vTaskDelay(MON_SENDING_EVERY / portTICK_PERIOD_MS);
     }
@@ -298,29 +291,16 @@ void MonService::sendingLoop(void *parameter) {
       ESP_LOGD(MON_TAG, "Stack space unused after entering the task: %d (Legacy Format)", uxHighWaterMark);
 
       RoutingTableService::printRoutingTable();
-      LM_LinkedList<RouteNode>* routingTableList = LoRaMeshService::getInstance().radio.routingTableListCopy();
-
-      if (routingTableList) {
-            routingTableList->setInUse();
-            if (routingTableList->moveToStart()) {
-                monService.monMessageId++;
-                uint16_t monMessagecount = 0 ;
-                do {
-                RouteNode *rtn = routingTableList->getCurrent() ;
-                if (rtn) {
-                     monService.createAndSendMessage(++monMessagecount, rtn);
-                }
-                } while (routingTableList->next());
-            }
-            else {
-                ESP_LOGD(MON_TAG, "No routes (Legacy Format)") ;
-            }
-            routingTableList->releaseInUse();
-            delete routingTableList; // Delete the copy
-            routingTableList = nullptr;
-       } else {
-            ESP_LOGE(MON_TAG, "Failed to get routing table copy (Legacy Format).");
-       }
+      const RoutingTableSnapshot* routingTable = LoRaMeshService::getInstance().acquireRoutingTable();
+      if (routingTable->size > 0) {
+          monService.monMessageId++;
+          for (uint16_t r = 0; r < routingTable->size; r++)
+              monService.createAndSendMessage(r + 1, &routingTable->routes[r]);
+      }
+      else {
+          ESP_LOGD(MON_TAG, "No routes (Legacy Format)") ;
+      }
+      LoRaMeshService::getInstance().releaseRoutingTable(routingTable);
 
       vTaskDelay(MON_SENDING_EVERY / portTICK_PERIOD_MS);
       ESP_LOGD(MON_TAG, "Free heap: %d (Legacy Format)", esp_get_free_heap_size());
@@ -328,7 +308,7 @@ void MonService::sendingLoop(void *parameter) {
   }
 }
 
-void MonService::createAndSendMessage(uint16_t mcount, RouteNode *rtn) {
+void MonService::createAndSendMessage(uint16_t mcount, const RouteNode *rtn) {
   ESP_LOGV(MON_TAG, "Sending mon data %d (Legacy Format)", this->monMessageId) ;
   monMessage *message = new monMessage();
   if (!message) {
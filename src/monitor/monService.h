@@ -18,7 +18,8 @@ public:
   }
   void init();
   monCommandService *monCommandService_ = new monCommandService();
-  void getJSON(DataMessage *message, String &json) ;
+  void serialize(DataMessage *message, JsonDocument &doc) ;
+  bool encode(DataMessage *message, MsgPackWriter &writer);
   DataMessage *getDataMessage(JsonObject data);
   void processReceivedMessage(messagePort port, DataMessage *message);
 private:
@@ -32,10 +33,10 @@ private:
   void createSendingTask();
 #if defined(MON_MQTT_ONE_MESSAGE)
   static void sendingLoopOneMessage(void *pvParameters); // Accept parameter
-  monOneMessage *createMONPayloadMessage(int number_of_neighbors) ;
+  monOneMessage *createMONPayloadMessage(int number_of_neighbors, const String &sensorData) ;
 #else
   static void sendingLoop(void *pvParameters); // Accept parameter
-  void createAndSendMessage(uint16_t mcount, RouteNode *);
+  void createAndSendMessage(uint16_t mcount, const RouteNode *);
 #endif
   TaskHandle_t sending_TaskHandle = NULL;
   bool running;
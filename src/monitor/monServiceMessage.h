@@ -9,6 +9,17 @@
 
 #pragma pack(push, 1)
 
+enum MonCommand: uint8_t {
+  getPoolStats = 1,
+  getDuplicateStats = 2,
+  setDuplicateWindow = 3,
+  getSendStats = 4,
+  getTrace = 5,
+  getTraceStats = 6,
+  getStoreStats = 7,
+  setTTL = 8,
+};
+
 class monMessage: public DataMessageGeneric {
 public:
   uint16_t RTcount = 0;
@@ -50,6 +61,7 @@ struct routing_entry {
   int8_t RxSNR ;
   unsigned long SRTT ;
   uint8_t metric ;
+  uint16_t ETX ; // Expected transmissions * 100
 };
 
 class monOneMessage: public DataMessageGeneric {
@@ -60,11 +72,30 @@ public:
   uint16_t RxQ ;
   uint32_t number_of_neighbors ;
   uint8_t routingTableId ;
-  String sensorDataJson = "{}"; // Default value constructor
+  uint16_t dutyCycleLeft = 1000; // Permille of the airtime budget left
+  uint32_t deferred = 0; // LoRa messages held back by the duty cycle
+  uint16_t sensorDataSize = 0; // Sensor JSON stored after rt[], including the '\0'
   GPSMessage gpsData; // Ensure GPSMessage has default constructor
 
   routing_entry rt[] ;
 
+  static uint32_t getMessageStructSize(uint32_t neighbors, uint16_t sensorSize) {
+    return sizeof(monOneMessage) + sizeof(routing_entry) * neighbors + sensorSize;
+  }
+
+  // The sensor data is kept inline so the message can be copied, queued and sent over LoRa
+  const char *getSensorData() {
+    if (sensorDataSize == 0) return "{}";
+    return (const char *)&rt[number_of_neighbors];
+  }
+
+  void setSensorData(const char *sensorData, uint16_t size) {
+    char *dst = (char *)&rt[number_of_neighbors];
+    memcpy(dst, sensorData, size - 1);
+    dst[size - 1] = '\0';
+    sensorDataSize = size;
+  }
+
   void operator delete(void *ptr) {
     ESP_LOGI("monOneMessage", "Custom delete operator called");
     vPortFree(ptr);
@@ -78,10 +109,12 @@ public:
     doc["RxQ"] = RxQ ;
     doc["number_of_neighbors"] = number_of_neighbors ;
     doc["routingTableId"] = routingTableId ;
+    doc["dutyCycleLeft"] = dutyCycleLeft ;
+    doc["deferred"] = deferred ;
 
     // Log value just before adding to JSON
-    ESP_LOGD("monOneMessageSerialize", "Serializing sensorDataJson: '%s'", sensorDataJson.c_str());
-    doc["sensorData"] = sensorDataJson;
+    ESP_LOGD("monOneMessageSerialize", "Serializing sensorData: '%s'", getSensorData());
+    doc["sensorData"] = getSensorData();
 
     JsonObject gpsObj = doc["gps"].to<JsonObject>();
     gpsData.serialize(gpsObj);
@@ -93,6 +126,33 @@ public:
       entry["RxSNR"] = rt[i].RxSNR ;
       entry["SRTT"] = rt[i].SRTT ;
       entry["metric"] = rt[i].metric ;
+      entry["ETX"] = rt[i].ETX ;
+    }
+  }
+
+  // Same values as serialize, positional: header, counters, sensorData, gps array and an array per route
+  void encode(MsgPackWriter &writer) {
+    writer.writeArray(DataMessageGeneric::ENCODED_HEADER_SIZE + 11);
+    ((DataMessageGeneric *)(this))->encode(writer);
+    writer.writeUnsigned(RTcount);
+    writer.writeUnsigned(uptime);
+    writer.writeUnsigned(TxQ);
+    writer.writeUnsigned(RxQ);
+    writer.writeUnsigned(number_of_neighbors);
+    writer.writeUnsigned(routingTableId);
+    writer.writeUnsigned(dutyCycleLeft);
+    writer.writeUnsigned(deferred);
+    writer.writeString(getSensorData(), strlen(getSensorData()));
+    gpsData.encode(writer);
+
+    writer.writeArray(number_of_neighbors);
+    for (int i = 0; i < number_of_neighbors ; i++) {
+      writer.writeArray(5);
+      writer.writeUnsigned(rt[i].neighbor);
+      writer.writeSigned(rt[i].RxSNR);
+      writer.writeUnsigned(rt[i].SRTT);
+      writer.writeUnsigned(rt[i].metric);
+      writer.writeUnsigned(rt[i].ETX);
     }
   }
 
@@ -103,7 +163,8 @@ public:
     if (doc["TxQ"].is<uint16_t>()) TxQ = doc["TxQ"] ;
     if (doc["RxQ"].is<uint16_t>()) RxQ  = doc["RxQ"] ;
     if (doc["routingTableId"].is<uint8_t>()) routingTableId = doc["routingTableId"] ;
-    if (doc["sensorData"].is<const char*>()) sensorDataJson = doc["sensorData"].as<String>();
+    if (doc["dutyCycleLeft"].is<uint16_t>()) dutyCycleLeft = doc["dutyCycleLeft"] ;
+    if (doc["deferred"].is<uint32_t>()) deferred = doc["deferred"] ;
 
     if (doc["gps"].is<JsonObjectConst>()) {
       JsonObjectConst gpsObj = doc["gps"];
@@ -124,11 +185,18 @@ public:
           if (entry["RxSNR"].is<int8_t>()) rt[i].RxSNR = entry["RxSNR"];
           if (entry["SRTT"].is<unsigned long>()) rt[i].SRTT = entry["SRTT"];
           if (entry["metric"].is<uint8_t>()) rt[i].metric = entry["metric"];
+          if (entry["ETX"].is<uint16_t>()) rt[i].ETX = entry["ETX"];
         }
       }
     } else {
       number_of_neighbors = 0;
     }
+
+    // Needs the buffer sized with getMessageStructSize(number_of_neighbors, strlen(sensorData) + 1)
+    if (doc["sensorData"].is<const char*>()) {
+      const char *sensorData = doc["sensorData"];
+      setSensorData(sensorData, strlen(sensorData) + 1);
+    }
   }
 };
 
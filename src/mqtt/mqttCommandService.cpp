@@ -7,4 +7,14 @@ MqttCommandService::MqttCommandService() {
         [this](String args) {
         return MqttService::getInstance().writeToMqtt(args) ? "Message sent" : "Device not connected";
     }));
+
+    addCommand(Command("/setCodec", "Set the uplink codec of an appPort, args: <appPort> <json|msgpack>", MqttMessageType::setCodec, 1,
+        [this](String args) {
+        return MqttService::getInstance().setCodec(args);
+    }));
+
+    addCommand(Command("/mqttStats", "Print the publish sizes and memory usage", MqttMessageType::getPublishStats, 1,
+        [this](String args) {
+        return MqttService::getInstance().getPublishStats();
+    }));
 }
\ No newline at end of file
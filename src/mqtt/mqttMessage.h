@@ -7,7 +7,9 @@
 #pragma pack(1)
 
 enum MqttMessageType: uint8_t {
-    mqttMessage = 1
+    mqttMessage = 1,
+    setCodec = 2,
+    getPublishStats = 3
 };
 
 class MqttMessage: public DataMessageGeneric {
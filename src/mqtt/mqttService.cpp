@@ -5,6 +5,7 @@ static const char* MQTT_TAG = "MQTT";
 void MqttService::initMqtt(String lclName) {
     ESP_LOGI(MQTT_TAG, "Initializing mqtt");
     localName = lclName;
+    publishMutex = xSemaphoreCreateMutex();
     mqtt_service_init(lclName.c_str());
     receiveQueue = xQueueCreate(10, sizeof(MQTTQueueMessageV2*));
     createMqttTask();
@@ -37,19 +38,20 @@ void MqttService::MqttLoop(void*) {
 }
 
 void MqttService::processMQTTMessage() {
-    if (xQueueReceive(receiveQueue, &mqttMessageReceiveV2, portMAX_DELAY) == pdTRUE) {
+    MQTTQueueMessageV2* mqttMessageReceive;
+    if (xQueueReceive(receiveQueue, &mqttMessageReceive, portMAX_DELAY) == pdTRUE) {
         ESP_LOGV(MQTT_TAG, "Message received from mqtt queue");
-        ESP_LOGV(MQTT_TAG, "Topic: %s", mqttMessageReceiveV2.topic.c_str());
-        processReceivedMessageFromMQTT(mqttMessageReceiveV2.topic, mqttMessageReceiveV2.body);
+        ESP_LOGV(MQTT_TAG, "Topic: %s", mqttMessageReceive->topic.c_str());
+        if ((int32_t) (millis() - mqttMessageReceive->deadline) >= 0) {
+            TRACE("MQTT message expired in the receive queue");
+            receiveExpired++;
+        }
+        else
+            processReceivedMessageFromMQTT(mqttMessageReceive->topic, mqttMessageReceive->body);
+        delete mqttMessageReceive;
     }
 }
 
-bool MqttService::sendMqttMessage(MQTTQueueMessageV2* message) {
-    ESP_LOGV(MQTT_TAG, "Sending message to MQTT, topic %s", message->topic.c_str());
-    mqtt_service_send(message->topic.c_str(), message->body.c_str(), 0);
-    return true;
-}
-
 bool MqttService::connect() {
     if (!WiFiServerService::getInstance().connectWiFi()) {
         ESP_LOGW(MQTT_TAG, "No WiFi connection");
@@ -87,18 +89,93 @@ bool MqttService::writeToMqtt(DataMessage* message) {
         ESP_LOGW(MQTT_TAG, "No Mqtt device connected");
         return false;
     }
-    MQTTQueueMessageV2* mqttMessageSend = new MQTTQueueMessageV2();
-    MessageManager::getInstance().getJSON(message, mqttMessageSend->body);
-    mqttMessageSend->topic = String(MQTT_TOPIC_OUT) + String(message->addrSrc);
-    sendMqttMessage(mqttMessageSend);
-    delete mqttMessageSend;
+
+    messageCodec codec = codecs[message->appPortSrc];
+
+    char topic[32];
+    snprintf(topic, sizeof(topic), "%s%d", codec == MsgPackCodec ? MQTT_TOPIC_OUT_BIN : MQTT_TOPIC_OUT, message->addrSrc);
+
+    xSemaphoreTake(publishMutex, portMAX_DELAY);
+
+    uint32_t freeBefore = ESP.getFreeHeap();
+    size_t length;
+    {
+        JsonDocument doc(&publishArena);
+        length = MessageManager::getInstance().encode(message, codec, doc, publishBuffer, sizeof(publishBuffer));
+    }
+    publishArena.reset();
+
+    if (length == 0) {
+        encodeErrors++;
+        xSemaphoreGive(publishMutex);
+        ESP_LOGE(MQTT_TAG, "Error encoding message");
+        return false;
+    }
+
+    // The payload may contain zeros, it is always published with its length
+    TRACE("Sending message from %X to MQTT, %d bytes, codec %d", message->addrSrc, length, codec);
+    mqtt_service_send(topic, publishBuffer, length);
+
+    published++;
+    if (length > maxPublishSize)
+        maxPublishSize = length;
+    updatePublishHeap(freeBefore);
+
+    xSemaphoreGive(publishMutex);
     return true;
 }
 
+void MqttService::updatePublishHeap(uint32_t freeBefore) {
+    // The outbox copy made by esp_mqtt is the only allocation left in the publish path
+    uint32_t freeAfter = ESP.getFreeHeap();
+    if (freeAfter < freeBefore && freeBefore - freeAfter > maxPublishHeap)
+        maxPublishHeap = freeBefore - freeAfter;
+}
+
+String MqttService::getPublishStats() {
+    return "Published: " + String(published) + ", encode errors: " + String(encodeErrors) + "\n" +
+        "Largest body: " + String(maxPublishSize) + "/" + String(MQTT_MAX_PACKET_SIZE) + " bytes\n" +
+        "Document arena: max " + String(publishArena.getHighWater()) + "/" + String(publishArena.getCapacity()) +
+        " bytes, failures " + String(publishArena.getFailures()) + "\n" +
+        "Heap used by a publish: max " + String(maxPublishHeap) + " bytes\n" +
+        "Downlinks expired in the receive queue: " + String(receiveExpired) + "\n" +
+        "Heap free: " + String(ESP.getFreeHeap()) + ", min " + String(ESP.getMinFreeHeap()) + " bytes\n";
+}
+
 bool MqttService::writeToMqtt(String message) {
     return false;
 }
 
+String MqttService::setCodec(String args) {
+    int separator = args.indexOf(' ');
+    if (separator < 0)
+        return "Usage: /setCodec <appPort> <json|msgpack>";
+
+    int appPort = args.substring(0, separator).toInt();
+    String codecName = args.substring(separator + 1);
+    codecName.trim();
+
+    if (appPort <= 0 || appPort > UINT8_MAX)
+        return "Invalid appPort";
+
+    if (codecName == "json")
+        setCodec(appPort, JsonCodec);
+    else if (codecName == "msgpack")
+        setCodec(appPort, MsgPackCodec);
+    else
+        return "Unknown codec " + codecName;
+
+    return "AppPort " + String(appPort) + " codec set to " + codecName;
+}
+
+void MqttService::setCodec(uint8_t appPort, messageCodec codec) {
+    codecs[appPort] = codec;
+}
+
+messageCodec MqttService::getCodec(uint8_t appPort) {
+    return codecs[appPort];
+}
+
 void MqttService::processReceivedMessageFromMQTT(String& topic, String& payload) {
     ESP_LOGI(MQTT_TAG, "Message arrived on topic: %s", topic.c_str());
     DataMessage* message = MessageManager::getInstance().getDataMessage(payload);
@@ -157,7 +234,7 @@ static void mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_
             ESP_LOGI(MQTT_TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
             break;
         case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(MQTT_TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+            TRACE("MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
             break;
         case MQTT_EVENT_DATA:
             {
@@ -189,7 +266,7 @@ void MqttService::mqtt_app_start(const char* client_id) {
     const esp_mqtt_client_config_t mqtt_cfg = {
       .uri = uri.c_str(),
       .client_id = client_id,
-      .buffer_size = 2048} ;
+      .buffer_size = MQTT_MAX_PACKET_SIZE} ;
     client = esp_mqtt_client_init(&mqtt_cfg);
     /* The last argument may be used to pass data to the event handler, in this example mqtt_event_handler */
     // esp_mqtt_client_register_event(client, esp_mqtt_event_id_t::MQTT_EVENT_ANY, mqtt_event_handler, NULL);
@@ -209,15 +286,16 @@ void MqttService::mqtt_service_subscribe(const char* topic) {
 void MqttService::mqtt_service_send(const char* topic, const char* data, int len) {
     int msg_id;
     msg_id = esp_mqtt_client_publish(client, topic, data, len, 2, 0);
-    ESP_LOGI(MQTT_TAG, "sent publish successful, msg_id %d", msg_id);
+    TRACE("MQTT publish msg_id %d", msg_id);
 }
 
 void MqttService::process_message(const char* topic, const char* payload) {
-    // MQTTQueueMessageV2* mqttMessageReceive = new MQTTQueueMessageV2();
-    MQTTQueueMessageV2 mqttMessageReceive ;
-    mqttMessageReceive.topic = String(topic) ;
-    mqttMessageReceive.body = String(payload) ;
+    MQTTQueueMessageV2* mqttMessageReceive = new MQTTQueueMessageV2();
+    mqttMessageReceive->topic = String(topic) ;
+    mqttMessageReceive->body = String(payload) ;
+    mqttMessageReceive->deadline = millis() + MQTT_RECEIVE_TTL;
     if (xQueueSend(receiveQueue, &mqttMessageReceive, portMAX_DELAY) != pdPASS) {
         ESP_LOGE(MQTT_TAG, "Error sending to queue");
+        delete mqttMessageReceive;
     }
 }
@@ -10,6 +10,8 @@
 
 #include "message/messageManager.h"
 
+#include "message/jsonArena.h"
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -38,6 +40,7 @@
 struct MQTTQueueMessageV2 {
   String topic;
   String body;
+  uint32_t deadline;
 } ;
 
 class MqttService: public MessageService {
@@ -56,6 +59,10 @@ public:
     bool isDeviceConnected();
     bool writeToMqtt(DataMessage* message);
     bool writeToMqtt(String message);
+    String setCodec(String args);
+    void setCodec(uint8_t appPort, messageCodec codec);
+    messageCodec getCodec(uint8_t appPort);
+    String getPublishStats();
     MqttCommandService* mqttCommandService = new MqttCommandService();
     virtual void processReceivedMessage(messagePort port, DataMessage* message);
     void inline process_message(const char* topic, const char* payload);
@@ -66,13 +73,27 @@ public:
 private:
     MqttService(): MessageService(appPort::MQTTApp, String("MQTT")) {
         commandService = mqttCommandService;
+        for (size_t i = 0; i <= UINT8_MAX; i++)
+            codecs[i] = MQTT_DEFAULT_CODEC;
     };
+    messageCodec codecs[UINT8_MAX + 1];
+
+    // Messages are encoded in place: the document lives in the arena and the body in publishBuffer
+    SemaphoreHandle_t publishMutex = NULL;
+    char publishBuffer[MQTT_MAX_PACKET_SIZE];
+    uint8_t arenaBuffer[MQTT_JSON_ARENA_SIZE];
+    JsonArena publishArena = JsonArena(arenaBuffer, sizeof(arenaBuffer));
+
+    uint32_t published = 0;
+    uint32_t encodeErrors = 0;
+    size_t maxPublishSize = 0;
+    uint32_t maxPublishHeap = 0;
+    uint32_t receiveExpired = 0;
+    void updatePublishHeap(uint32_t freeBefore);
     void createMqttTask();
     static void MqttLoop(void*);
     TaskHandle_t mqtt_TaskHandle = NULL;
     QueueHandle_t receiveQueue;
-    MQTTQueueMessageV2 mqttMessageReceiveV2;
-    bool sendMqttMessage(MQTTQueueMessageV2* message);
     void processMQTTMessage();
     void mqtt_app_start(const char* client_id);
     void mqtt_service_send(const char* topic, const char* data, int len);
@@ -23,18 +23,12 @@ void Metadata::stopMetadata() {
     running = false;
 }
 
-String Metadata::getJSON(DataMessage* message) {
+void Metadata::serialize(DataMessage* message, JsonDocument& doc) {
     MetadataMessage* metadataMessage = (MetadataMessage*) message;
-    DynamicJsonDocument doc(1024);
     JsonObject jsonObj = doc.to<JsonObject>();
     JsonObject dataObj = jsonObj.createNestedObject("data");
 
     getJSONDataObject(dataObj, metadataMessage);
-
-    String json;
-    serializeJson(doc, json);
-
-    return json;
 }
 
 
@@ -76,8 +70,6 @@ void Metadata::createAndSendMetadata() {
 
     // uint8_t metadataSize = 1; //TODO: This should be dynamic with an array of sensors
     // uint16_t metadataSensorSize = metadataSize * sizeof(MetadataSensorMessage);
-    uint16_t messageWithHeaderSize = sizeof(MetadataMessage);// + metadataSensorSize;
-
     MetadataMessage* message = new MetadataMessage();
 
     message->appPortDst = appPort::MQTTApp;
@@ -86,7 +78,7 @@ void Metadata::createAndSendMetadata() {
     message->addrDst = 0;
     message->messageId = metadataId;
 
-    message->messageSize = messageWithHeaderSize - sizeof(DataMessageGeneric);
+    message->messageSize = MetadataMessageSchema.payloadSize;
     message->gps = GPSService::getInstance().getGPSMessage();
     message->metadataSendTimeInterval = METADATA_UPDATE_DELAY;
     message->batteryPercentage = Battery::getInstance().getVoltagePercentage();
@@ -31,13 +31,14 @@ public:
 
     void createAndSendMetadata();
 
-    String getJSON(DataMessage* message);
+    void serialize(DataMessage* message, JsonDocument& doc);
 
     MetadataCommandService* metadataCommandService = new MetadataCommandService();
 
 private:
     Metadata(): MessageService(MetadataApp, "Metadata") {
         commandService = metadataCommandService;
+        schema = &MetadataMessageSchema;
     };
 
     TaskHandle_t metadata_TaskHandle = NULL;
@@ -4,6 +4,8 @@
 
 #include "message/dataMessage.h"
 
+#include "message/messageSchema.h"
+
 #include "gps/gpsMessage.h"
 
 #include "sensor/metadata/metadataSensorMessage.h"
@@ -47,3 +49,18 @@ public:
 };
 
 #pragma pack()
+
+// The JSON stays hand-written, the gps object and the ISO timestamp are built by GPSMessage::serialize
+MESSAGE_SCHEMA(MetadataMessage,
+    SCHEMA_FIELD(MetadataMessage, gps.latitude),
+    SCHEMA_FIELD(MetadataMessage, gps.longitude),
+    SCHEMA_FIELD(MetadataMessage, gps.altitude),
+    SCHEMA_FIELD(MetadataMessage, gps.satellites),
+    SCHEMA_FIELD(MetadataMessage, gps.hour),
+    SCHEMA_FIELD(MetadataMessage, gps.minute),
+    SCHEMA_FIELD(MetadataMessage, gps.second),
+    SCHEMA_FIELD(MetadataMessage, gps.day),
+    SCHEMA_FIELD(MetadataMessage, gps.month),
+    SCHEMA_FIELD(MetadataMessage, gps.year),
+    SCHEMA_FIELD(MetadataMessage, metadataSendTimeInterval),
+    SCHEMA_FIELD(MetadataMessage, batteryPercentage));
@@ -15,14 +15,10 @@ void SensorService::init() {
 #endif
 }
 
-String SensorService::getJSON(DataMessage* message) {
+void SensorService::serialize(DataMessage* message, JsonDocument& doc) {
     SensorCommandMessage* sensorMessage = (SensorCommandMessage*) message;
-    StaticJsonDocument<2000> doc;
     JsonObject root = doc.to<JsonObject>();
     sensorMessage->serialize(root);
-    String json;
-    serializeJson(doc, json);
-    return json;
 }
 
 DataMessage* SensorService::getDataMessage(JsonObject data) {
@@ -42,17 +38,20 @@ DataMessage* SensorService::getDataMessage(JsonObject data) {
 DataMessage* SensorService::getMeasurementMessage(JsonObject data) {
     MeasurementMessage* measurement = new MeasurementMessage();
     measurement->deserialize(data);
-    measurement->messageSize = sizeof(MeasurementMessage) - sizeof(DataMessageGeneric);
+    measurement->messageSize = MeasurementMessageSchema.payloadSize;
     return ((DataMessage*) measurement);
 }
 
 DataMessage* SensorService::getCalibrateMessage(JsonObject data) {
-    MeasurementMessage* measurement = new MeasurementMessage();
-    measurement->deserialize(data);
-    measurement->messageSize = sizeof(MeasurementMessage) - sizeof(DataMessageGeneric);
-    return ((DataMessage*) measurement);
+    return CalibrateMessageSchema.create(data);
 }
 
+const MessageSchema* SensorService::getSchema(DataMessage* message) {
+    // The calibrate commands only carry the command, the rest are measurements
+    if (message->messageSize > 0 && ((SensorCommandMessage*) message)->sensorCommand == SensorCommand::Data)
+        return &MeasurementMessageSchema;
+    return &CalibrateMessageSchema;
+}
 
 void SensorService::processReceivedMessage(messagePort port, DataMessage* message) {
     SensorCommandMessage* sensorMessage = (SensorCommandMessage*) message;
@@ -140,7 +139,7 @@ void SensorService::createAndSendMessage() {
     message->addrSrc = LoraMesher::getInstance().getLocalAddress();
     message->addrDst = 0;
     message->messageId = sensorMessageId;
-    message->messageSize = sizeof(MeasurementMessage) - sizeof(DataMessageGeneric);
+    message->messageSize = MeasurementMessageSchema.payloadSize;
     // Send the message
     MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*) message);
     // Delete the message
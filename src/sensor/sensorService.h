@@ -38,10 +38,12 @@ public:
 
     void init();
 
-    String getJSON(DataMessage* message);
+    void serialize(DataMessage* message, JsonDocument& doc);
 
     DataMessage* getDataMessage(JsonObject data);
 
+    const MessageSchema* getSchema(DataMessage* message);
+
     void processReceivedMessage(messagePort port, DataMessage* message);
 
     void sensorsOn();
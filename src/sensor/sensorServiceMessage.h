@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include "message/dataMessage.h"
+#include "message/messageSchema.h"
 #include "gps/gpsMessage.h"
 #include "types/PHSensor/PHSensorMessage.h"
 #include "types/SHT4x/SHT4xAirSensorMessage.h"
@@ -52,6 +53,11 @@ public:
     }
 };
 
+class CalibrateMessage: public DataMessageGeneric {
+public:
+    SensorCommand sensorCommand;
+};
+
 class SensorCommandMessage: public DataMessageGeneric {
 public:
     SensorCommand sensorCommand;
@@ -62,23 +68,56 @@ public:
                 ((MeasurementMessage*) (this))->serialize(doc);
                 break;
             case SensorCommand::Calibrate:
-                // Call the base class serialize function
-                ((DataMessageGeneric*) (this))->serialize(doc);
-                doc["sensorCommand"] = sensorCommand;
+                serializeCalibrate(doc);
                 break;
         }
     }
+    void serializeCalibrate(JsonObject& doc);
     void deserialize(JsonObject& doc) {
         switch ((SensorCommand) doc["sensorCommand"]) {
             case SensorCommand::Data:
                 break;
             case SensorCommand::Calibrate:
-                // Call the base class deserialize function
-                ((DataMessageGeneric*) (this))->deserialize(doc);
+                deserializeCalibrate(doc);
                 break;
         }
         // Add the derived class data to the JSON object
         sensorCommand = doc["sensorCommand"];
     }
+    void deserializeCalibrate(JsonObject& doc);
 };
 #pragma pack()
+
+// The JSON of a measurement stays hand-written, Telegraf expects the gps object, the ISO timestamp and
+// the array of measurements built by serializeDataSerialize
+MESSAGE_SCHEMA(MeasurementMessage,
+    SCHEMA_FIELD(MeasurementMessage, sensorCommand),
+    SCHEMA_FIELD(MeasurementMessage, gps.latitude),
+    SCHEMA_FIELD(MeasurementMessage, gps.longitude),
+    SCHEMA_FIELD(MeasurementMessage, gps.altitude),
+    SCHEMA_FIELD(MeasurementMessage, gps.satellites),
+    SCHEMA_FIELD(MeasurementMessage, gps.hour),
+    SCHEMA_FIELD(MeasurementMessage, gps.minute),
+    SCHEMA_FIELD(MeasurementMessage, gps.second),
+    SCHEMA_FIELD(MeasurementMessage, gps.day),
+    SCHEMA_FIELD(MeasurementMessage, gps.month),
+    SCHEMA_FIELD(MeasurementMessage, gps.year),
+    SCHEMA_FIELD(MeasurementMessage, phSensorMessage.temperature),
+    SCHEMA_FIELD(MeasurementMessage, phSensorMessage.ph),
+    SCHEMA_FIELD(MeasurementMessage, sht4xAirSensorMessage.temperature),
+    SCHEMA_FIELD(MeasurementMessage, sht4xAirSensorMessage.humidity),
+    SCHEMA_FIELD(MeasurementMessage, soilSensorMessage.temperature),
+    SCHEMA_FIELD(MeasurementMessage, soilSensorMessage.moisture),
+    SCHEMA_FIELD(MeasurementMessage, soilSensorMessage.conductivity),
+    SCHEMA_FIELD(MeasurementMessage, waterLevelSensorMessage.distance));
+
+MESSAGE_SCHEMA(CalibrateMessage,
+    SCHEMA_FIELD(CalibrateMessage, sensorCommand));
+
+inline void SensorCommandMessage::serializeCalibrate(JsonObject& doc) {
+    CalibrateMessageSchema.serialize((DataMessage*) this, doc);
+}
+
+inline void SensorCommandMessage::deserializeCalibrate(JsonObject& doc) {
+    CalibrateMessageSchema.deserialize((DataMessage*) this, doc);
+}
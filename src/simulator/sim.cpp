@@ -29,21 +29,19 @@ String Sim::stop() {
     return "Sim Off";
 }
 
-String Sim::getJSON(DataMessage* message) {
+void Sim::serialize(DataMessage* message, JsonDocument& doc) {
     SimMessage* simMessage = (SimMessage*) message;
-    StaticJsonDocument<2048> doc;
     JsonObject data = doc.createNestedObject("data");
     simMessage->serialize(data);
-    String json;
-    serializeJson(doc, json);
-    return json;
+}
+
+bool Sim::encode(DataMessage* message, MsgPackWriter& writer) {
+    ((SimMessage*) message)->encode(writer);
+    return true;
 }
 
 DataMessage* Sim::getDataMessage(JsonObject data) {
-    SimMessage* simMessage = new SimMessage();
-    simMessage->deserialize(data);
-    simMessage->messageSize = sizeof(SimMessage) - sizeof(DataMessageGeneric);
-    return ((DataMessage*) simMessage);
+    return SimMessageSchema.create(data);
 }
 
 void Sim::processReceivedMessage(messagePort port, DataMessage* message) {
@@ -72,7 +70,7 @@ void Sim::createSimTask() {
 
 void Sim::simLoop(void* pvParameters) {
     ESP_LOGV(SIM_TAG, "Simulator started");
-    Sim sim = Sim::getInstance();
+    Sim& sim = Sim::getInstance();
     for (;;) {
         sim.sendStartSimMessage();
         vTaskDelay(HELLO_PACKETS_DELAY * 15 * 1000 / portTICK_PERIOD_MS); // Wait 4 minutes to propagate all the network status
@@ -82,14 +80,14 @@ void Sim::simLoop(void* pvParameters) {
             while (LoraMesher::getInstance().getClosestGateway() == nullptr) {
                 vTaskDelay(1000 / portTICK_PERIOD_MS); // Wait 1 second
             }
-            sim.sendPacketsToServer(PACKET_COUNT, PACKET_SIZE, PACKET_DELAY);
+            sim.sendPacketsToServer(PACKET_COUNT, PACKET_SIZE, sim.offeredLoad);
         }
         else {
             vTaskDelay(60000 * 10 / portTICK_PERIOD_MS); // Wait 10 minutes to avoid other messages to propagate
             vTaskDelay(PACKET_DELAY * PACKET_COUNT / portTICK_PERIOD_MS);
         }
 #else
-        sim.sendPacketsToServer(PACKET_COUNT, PACKET_SIZE, PACKET_DELAY);
+        sim.sendPacketsToServer(PACKET_COUNT, PACKET_SIZE, sim.offeredLoad);
 #endif
         ESP_LOGV(SIM_TAG, "Simulator stopped");
         while (LoRaMeshService::getInstance().hasActiveConnections()) {
@@ -126,7 +124,7 @@ void Sim::sendAllData() {
             simMessage = createSimMessage(state);
             MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*) simMessage);
             delete state;
-            vPortFree(simMessage);
+            MessageManager::getInstance().pool.release(simMessage);
             // If wifi connected wait 1 second, else wait 40 seconds
             if (WiFi.status() == WL_CONNECTED)
                 vTaskDelay(2000 / portTICK_PERIOD_MS); // Wait 10 milliseconds
@@ -143,9 +141,11 @@ void Sim::sendAllData() {
 
 SimMessage* Sim::createSimMessage(LM_State* state) {
     uint32_t messageSize = sizeof(SimMessage) + sizeof(SimMessageState);
-    SimMessage* simMessage = (SimMessage*) pvPortMalloc(messageSize);
+    SimMessage* simMessage = (SimMessage*) MessageManager::getInstance().pool.alloc(messageSize);
     simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
     simMessage->simCommand = SimCommand::Message;
+    simMessage->priority = messagePriority::BulkPriority;
+    simMessage->deadline = 0;
     memcpy(simMessage->payload, state, sizeof(SimMessageState));
     simMessage->appPortDst = appPort::MQTTApp;
     simMessage->appPortSrc = appPort::SimApp;
@@ -155,28 +155,95 @@ SimMessage* Sim::createSimMessage(LM_State* state) {
     return simMessage;
 }
 
-void Sim::sendPacketsToServer(size_t packetCount, size_t packetSize, size_t delayMs) {
+void Sim::sendPacketsToServer(size_t packetCount, size_t packetSize, uint16_t offeredLoad) {
     SimMessage* simPayloadMessage = createSimPayloadMessage(packetSize);
+    uint32_t simMessageSize = simPayloadMessage->getDataMessageSize();
+    MessagePool& pool = MessageManager::getInstance().pool;
+    LoRaMeshService& loRaMeshService = LoRaMeshService::getInstance();
+
+    uint32_t frameSize = getLoRaMeshHeaderSize(simPayloadMessage->appPortDst, simPayloadMessage->appPortSrc) + simPayloadMessage->messageSize;
+    uint32_t airtime = LoRaAirtime::getFrameTimeOnAir(frameSize);
+    uint32_t interval = offeredLoad > 0 ? airtime / offeredLoad : 0; // us * 1000 / permille = ms
+    ESP_LOGI(SIM_TAG, "Simulator offering %d permille, %d us on air every %d ms", offeredLoad, airtime, interval);
+
+    loRaMeshService.setSendDrainTask(xTaskGetCurrentTaskHandle());
+
+    uint32_t start = millis();
+    uint32_t nextSend = start;
     for (size_t i = 0; i < packetCount; i++) {
-        simPayloadMessage->messageId = i;
-        ESP_LOGV(SIM_TAG, "Simulator sending packet %d", i);
-        MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*) simPayloadMessage);
-        vTaskDelay(delayMs / portTICK_PERIOD_MS); // Wait delayMs milliseconds
-        // Wait until the previous packet has been sent
-        while (LoRaMeshService::getInstance().queueWaitingSendPacketsLength() > 3) {
-            ESP_LOGV(SIM_TAG, "Simulator waiting for packet to be sent");
-            vTaskDelay(20000 / portTICK_PERIOD_MS); // Wait 20 additional seconds before sending the next packet
+        // Wake on the packet slot, a drain notification only wakes it earlier to check again
+        while ((int32_t) (nextSend - millis()) > 0)
+            waitSendDrain(nextSend - millis());
+
+        // Hold the packet while the mesh has not drained the previous ones
+        uint32_t heldStart = millis();
+        if (loRaMeshService.getSendBacklog() > SIM_MAX_BACKLOG) {
+            packetsHeld++;
+            while (loRaMeshService.getSendBacklog() > SIM_MAX_BACKLOG) {
+                ESP_LOGV(SIM_TAG, "Simulator waiting for packet to be sent");
+                waitSendDrain(SIM_BACKLOG_POLL);
+            }
+            heldTime += millis() - heldStart;
+        }
+
+        // The queued message is shared with the send worker, use a new one for each packet
+        SimMessage* packet = (SimMessage*) pool.alloc(simMessageSize);
+        if (!packet) {
+            ESP_LOGE(SIM_TAG, "Not enough memory for packet %d", i);
+            break;
         }
+        memcpy(packet, simPayloadMessage, simMessageSize);
+        packet->messageId = i;
+        ESP_LOGV(SIM_TAG, "Simulator sending packet %d", i);
+        MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*) packet);
+        pool.release(packet);
+
+        packetsSent++;
+        airtimeOffered += airtime;
+
+        // A held packet moves the schedule, the load is not recovered with a burst
+        nextSend += interval;
+        if ((int32_t) (nextSend - millis()) < 0)
+            nextSend = millis();
+
         ESP_LOGV(SIM_TAG, "FREE HEAP: %d", ESP.getFreeHeap());
     }
-    vPortFree(simPayloadMessage);
+
+    loRaMeshService.setSendDrainTask(NULL);
+    sendTime += millis() - start;
+
+    ESP_LOGI(SIM_TAG, "%s", getStats().c_str());
+    MessageManager::getInstance().pool.release(simPayloadMessage);
+}
+
+void Sim::waitSendDrain(uint32_t timeoutMs) {
+    ulTaskNotifyTake(pdTRUE, timeoutMs / portTICK_PERIOD_MS + 1);
+}
+
+String Sim::setOfferedLoad(String args) {
+    int load = args.toInt();
+    if (load <= 0 || load > 1000)
+        return "Offered load must be between 1 and 1000 permille";
+
+    offeredLoad = load;
+    return "Offered load " + String(offeredLoad) + " permille";
+}
+
+String Sim::getStats() {
+    uint32_t achievedLoad = sendTime > 0 ? airtimeOffered / sendTime : 0; // us / ms = permille
+
+    return "Offered load " + String(offeredLoad) + " permille, achieved " + String(achievedLoad) + " permille\n" +
+        "Packets sent " + String(packetsSent) + " in " + String(sendTime) + " ms, held " + String(packetsHeld) +
+        " for " + String(heldTime) + " ms\n";
 }
 
 SimMessage* Sim::createSimPayloadMessage(size_t packetSize) {
     uint32_t messageSize = sizeof(SimMessage) + sizeof(SimPayloadMessage) + packetSize;
-    SimMessage* simMessage = (SimMessage*) pvPortMalloc(messageSize);
+    SimMessage* simMessage = (SimMessage*) MessageManager::getInstance().pool.alloc(messageSize);
     simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
     simMessage->simCommand = SimCommand::Payload;
+    simMessage->priority = messagePriority::BulkPriority;
+    simMessage->deadline = 0;
     simMessage->appPortDst = appPort::MQTTApp;
     simMessage->appPortSrc = appPort::SimApp;
     simMessage->addrSrc = LoraMesher::getInstance().getLocalAddress();
@@ -196,7 +263,7 @@ SimMessage* Sim::createSimPayloadMessage(size_t packetSize) {
 
 SimMessage* Sim::createSimMessage(SimCommand command) {
     SimMessage* simMessage = new SimMessage();
-    simMessage->messageSize = sizeof(SimMessage) - sizeof(DataMessageGeneric);
+    simMessage->messageSize = SimMessageSchema.payloadSize;
     simMessage->simCommand = command;
     simMessage->appPortDst = appPort::MQTTApp;
     simMessage->appPortSrc = appPort::SimApp;
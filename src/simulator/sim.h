@@ -16,6 +16,8 @@
 
 #include "LoraMesher.h"
 
+#include "loramesh/loraAirtime.h"
+
 // #include "sensor/temperature-onewire/temperature.h"
 
 // #include "sensor/dht22/dht22.h"
@@ -41,17 +43,34 @@ public:
 
     String stop();
 
-    String getJSON(DataMessage* message);
+    void serialize(DataMessage* message, JsonDocument& doc);
 
     DataMessage* getDataMessage(JsonObject data);
 
+    bool encode(DataMessage* message, MsgPackWriter& writer);
+
     void processReceivedMessage(messagePort port, DataMessage* message);
 
-    void sendPacketsToServer(size_t packetCount, size_t packetSize, size_t delayMs);
+    /**
+     * @brief Send the packets to the server at a target offered load
+     *
+     * Packets are spaced by their time on air divided by the offered load, and held while the send
+     * backlog is over SIM_MAX_BACKLOG, so the goodput measured is the mesh one and not the pacing one.
+     *
+     * @param packetCount Packets to send
+     * @param packetSize Payload bytes of each packet
+     * @param offeredLoad Permille of the airtime offered
+     */
+    void sendPacketsToServer(size_t packetCount, size_t packetSize, uint16_t offeredLoad);
+
+    String setOfferedLoad(String args);
+
+    String getStats();
 
 private:
     Sim(): MessageService(SimApp, "Sim") {
         commandService = simCommandService;
+        schema = &SimMessageSchema;
     };
 
     TaskHandle_t sim_TaskHandle = NULL;
@@ -62,6 +81,16 @@ private:
 
     bool running = false;
 
+    uint16_t offeredLoad = SIM_OFFERED_LOAD;
+
+    uint32_t packetsSent = 0;
+    uint32_t packetsHeld = 0;
+    uint32_t heldTime = 0; //ms
+    uint32_t sendTime = 0; //ms
+    uint64_t airtimeOffered = 0; //us
+
+    void waitSendDrain(uint32_t timeoutMs);
+
     void sendAllData();
 
     SimMessage* createSimMessage(LM_State* state);
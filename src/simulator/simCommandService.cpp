@@ -11,4 +11,14 @@ SimCommandService::SimCommandService() {
         [this](String args) {
         return String(Sim::getInstance().stop());
     }));
+
+    addCommand(Command("/simLoad", "Set the permille of airtime offered by the Sim", SimCommand::SetOfferedLoad, 1,
+        [this](String args) {
+        return Sim::getInstance().setOfferedLoad(args);
+    }));
+
+    addCommand(Command("/simStats", "Get the offered and achieved load of the Sim", SimCommand::GetSimStats, 1,
+        [this](String args) {
+        return Sim::getInstance().getStats();
+    }));
 }
\ No newline at end of file
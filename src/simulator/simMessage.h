@@ -4,6 +4,8 @@
 
 #include "message/dataMessage.h"
 
+#include "message/messageSchema.h"
+
 #include "LoraMesher.h"
 
 #include "config.h"
@@ -18,6 +20,8 @@ enum SimCommand: uint8_t {
     StartingSimulation = 4,
     EndedSimulation = 5, // StartedSimulationStatus
     EndedSimulationStatus = 6,
+    SetOfferedLoad = 7,
+    GetSimStats = 8,
 };
 
 
@@ -54,6 +58,33 @@ public:
         doc["SeqId"] = state.packetHeader.seq_id;
         doc["Num"] = state.packetHeader.number;
     }
+
+    /**
+     * @brief Same values as serializeState, as an array that ends with the array of the packet header
+     */
+    void encodeState(MsgPackWriter& writer) {
+        writer.writeArray(11);
+        writer.writeUnsigned(state.id);
+        writer.writeUnsigned(state.type);
+        writer.writeUnsigned(state.receivedQueueSize);
+        writer.writeUnsigned(state.sentQueueSize);
+        writer.writeUnsigned(state.receivedUserQueueSize);
+        writer.writeUnsigned(state.q_WRPSize);
+        writer.writeUnsigned(state.q_WSPSize);
+        writer.writeUnsigned(state.routingTableSize);
+        writer.writeUnsigned(state.secondsSinceStart);
+        writer.writeUnsigned(state.freeMemoryAllocation);
+
+        writer.writeArray(8);
+        writer.writeUnsigned(state.packetHeader.type);
+        writer.writeUnsigned(state.packetHeader.id);
+        writer.writeUnsigned(state.packetHeader.packetSize);
+        writer.writeUnsigned(state.packetHeader.src);
+        writer.writeUnsigned(state.packetHeader.dst);
+        writer.writeUnsigned(state.packetHeader.via);
+        writer.writeUnsigned(state.packetHeader.seq_id);
+        writer.writeUnsigned(state.packetHeader.number);
+    }
 };
 
 class SimPayloadMessage {
@@ -76,6 +107,18 @@ public:
             doc["payload"] = payload[packetSize - 1];
         }
     }
+
+    /**
+     * @brief packetSize and the payload, binary instead of an array of numbers
+     */
+    void encodePayload(MsgPackWriter& writer) {
+        writer.writeUnsigned(packetSize);
+
+        if (UPLOAD_PAYLOAD == true)
+            writer.writeBinary(payload, packetSize);
+        else
+            writer.writeUnsigned(payload[packetSize - 1]);
+    }
 };
 
 class SimMessage: public DataMessageGeneric {
@@ -109,6 +152,21 @@ public:
         }
     }
 
+    /**
+     * @brief Header, simCommand, and the state array or the packetSize and payload
+     */
+    void encode(MsgPackWriter& writer) {
+        uint8_t tail = simCommand == SimCommand::Message ? 1 : (simCommand == SimCommand::Payload ? 2 : 0);
+        writer.writeArray(DataMessageGeneric::ENCODED_HEADER_SIZE + 1 + tail);
+        ((DataMessageGeneric*) (this))->encode(writer);
+        writer.writeUnsigned(simCommand);
+
+        if (simCommand == SimCommand::Message)
+            ((SimMessageState*) this->payload)->encodeState(writer);
+        else if (simCommand == SimCommand::Payload)
+            ((SimPayloadMessage*) this->payload)->encodePayload(writer);
+    }
+
     void deserialize(JsonObject& doc) {
         // Call the base class deserialize function
         ((DataMessageGeneric*) (this))->deserialize(doc);
@@ -118,4 +176,8 @@ public:
     }
 };
 
-#pragma pack()
\ No newline at end of file
+#pragma pack()
+
+// Only the command is fixed, the state or the payload that follows depends on it
+MESSAGE_SCHEMA_WITH_TAIL(SimMessage,
+    SCHEMA_FIELD(SimMessage, simCommand));
\ No newline at end of file
@@ -0,0 +1,355 @@
+#pragma once
+
+// Arduino core shim of the native environment, only what the modules built on the host use
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// Pins of the ttgo-t-beam variant used by config.h
+#define SDA 21
+#define SCL 22
+#define LORA_SCK 5
+#define LORA_MISO 19
+#define LORA_MOSI 27
+#define LORA_CS 18
+#define LORA_RST 23
+#define LORA_IRQ 26
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+class StringSumHelper;
+
+/**
+ * @brief Arduino String on top of std::string, with the conversions and methods used by the firmware
+ */
+class String {
+public:
+    String() {}
+
+    String(const char* value) {
+        if (value)
+            buffer = value;
+    }
+
+    String(const String& value) = default;
+
+    String(char value): buffer(1, value) {}
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value &&
+        !std::is_same<T, bool>::value, int>::type = 0>
+    explicit String(T value, unsigned char base = DEC) {
+        if (std::is_signed<T>::value && value < 0 && base == DEC) {
+            buffer = "-";
+            appendUnsigned(-(unsigned long long) (long long) value, base);
+        }
+        else {
+            appendUnsigned((unsigned long long) (typename std::make_unsigned<T>::type) value, base);
+        }
+    }
+
+    explicit String(bool value): String((int) value) {}
+
+    explicit String(double value, unsigned int decimals = 2) {
+        char text[64];
+        snprintf(text, sizeof(text), "%.*f", decimals, value);
+        buffer = text;
+    }
+
+    explicit String(float value, unsigned int decimals = 2): String((double) value, decimals) {}
+
+    String& operator=(const String& value) = default;
+
+    String& operator=(const char* value) {
+        buffer = value ? value : "";
+        return *this;
+    }
+
+    const char* c_str() const { return buffer.c_str(); }
+
+    unsigned int length() const { return buffer.length(); }
+
+    bool isEmpty() const { return buffer.empty(); }
+
+    bool reserve(unsigned int size) {
+        buffer.reserve(size);
+        return true;
+    }
+
+    bool concat(const String& value) {
+        buffer += value.buffer;
+        return true;
+    }
+
+    bool concat(const char* value) {
+        if (value)
+            buffer += value;
+        return value != nullptr;
+    }
+
+    bool concat(char value) {
+        buffer += value;
+        return true;
+    }
+
+    String& operator+=(const String& value) {
+        concat(value);
+        return *this;
+    }
+
+    String& operator+=(const char* value) {
+        concat(value);
+        return *this;
+    }
+
+    String& operator+=(char value) {
+        concat(value);
+        return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, char>::value, int>::type = 0>
+    String& operator+=(T value) {
+        concat(String(value));
+        return *this;
+    }
+
+    char operator[](unsigned int index) const { return index < buffer.length() ? buffer[index] : 0; }
+
+    char charAt(unsigned int index) const { return (*this)[index]; }
+
+    bool equals(const String& value) const { return buffer == value.buffer; }
+
+    bool equalsIgnoreCase(const String& value) const {
+        if (buffer.length() != value.buffer.length())
+            return false;
+        for (size_t i = 0; i < buffer.length(); i++)
+            if (tolower((unsigned char) buffer[i]) != tolower((unsigned char) value.buffer[i]))
+                return false;
+        return true;
+    }
+
+    bool operator==(const String& value) const { return buffer == value.buffer; }
+
+    bool operator==(const char* value) const { return buffer == (value ? value : ""); }
+
+    bool operator!=(const String& value) const { return !(*this == value); }
+
+    bool operator!=(const char* value) const { return !(*this == value); }
+
+    bool operator<(const String& value) const { return buffer < value.buffer; }
+
+    bool startsWith(const String& prefix) const { return buffer.compare(0, prefix.buffer.length(), prefix.buffer) == 0; }
+
+    bool endsWith(const String& suffix) const {
+        return buffer.length() >= suffix.buffer.length() &&
+            buffer.compare(buffer.length() - suffix.buffer.length(), suffix.buffer.length(), suffix.buffer) == 0;
+    }
+
+    int indexOf(char value, unsigned int from = 0) const { return position(buffer.find(value, from)); }
+
+    int indexOf(const String& value, unsigned int from = 0) const { return position(buffer.find(value.buffer, from)); }
+
+    int lastIndexOf(char value) const { return position(buffer.rfind(value)); }
+
+    int lastIndexOf(const String& value) const { return position(buffer.rfind(value.buffer)); }
+
+    String substring(unsigned int from) const { return substring(from, buffer.length()); }
+
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to)
+            std::swap(from, to);
+        if (from >= buffer.length())
+            return String();
+        return String(buffer.substr(from, std::min<size_t>(to, buffer.length()) - from).c_str());
+    }
+
+    void remove(unsigned int index) { remove(index, (unsigned int) -1); }
+
+    void remove(unsigned int index, unsigned int count) {
+        if (index < buffer.length())
+            buffer.erase(index, count);
+    }
+
+    void trim() {
+        size_t start = buffer.find_first_not_of(" \t\r\n");
+        size_t end = buffer.find_last_not_of(" \t\r\n");
+        buffer = start == std::string::npos ? "" : buffer.substr(start, end - start + 1);
+    }
+
+    void toLowerCase() {
+        for (char& c : buffer)
+            c = tolower((unsigned char) c);
+    }
+
+    void toUpperCase() {
+        for (char& c : buffer)
+            c = toupper((unsigned char) c);
+    }
+
+    long toInt() const { return atol(buffer.c_str()); }
+
+    float toFloat() const { return atof(buffer.c_str()); }
+
+private:
+    std::string buffer;
+
+    static int position(size_t found) { return found == std::string::npos ? -1 : (int) found; }
+
+    void appendUnsigned(unsigned long long value, unsigned char base) {
+        char digits[66];
+        int i = sizeof(digits) - 1;
+        digits[i] = '\0';
+        do {
+            uint8_t digit = value % base;
+            digits[--i] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+            value /= base;
+        } while (value > 0);
+        buffer += &digits[i];
+    }
+};
+
+class StringSumHelper: public String {
+public:
+    StringSumHelper(const String& value): String(value) {}
+    StringSumHelper(const char* value): String(value) {}
+};
+
+inline StringSumHelper operator+(const String& left, const String& right) {
+    StringSumHelper sum(left);
+    sum.concat(right);
+    return sum;
+}
+
+inline StringSumHelper operator+(const String& left, const char* right) {
+    StringSumHelper sum(left);
+    sum.concat(right);
+    return sum;
+}
+
+inline StringSumHelper operator+(const char* left, const String& right) {
+    StringSumHelper sum(left);
+    sum.concat(right);
+    return sum;
+}
+
+inline StringSumHelper operator+(const String& left, char right) {
+    StringSumHelper sum(left);
+    sum.concat(right);
+    return sum;
+}
+
+template <typename T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, char>::value, int>::type = 0>
+inline StringSumHelper operator+(const String& left, T right) {
+    StringSumHelper sum(left);
+    sum.concat(String(right));
+    return sum;
+}
+
+#define F(text) (text)
+
+inline std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+inline unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline std::minstd_rand randomGenerator;
+
+inline long random(long min, long max) {
+    return max > min ? min + (long) (randomGenerator() % (unsigned long) (max - min)) : min;
+}
+
+inline long random(long max) {
+    return random(0, max);
+}
+
+// Level of every pin, the tests read back what the firmware wrote
+inline uint8_t pinLevels[256];
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline void digitalWrite(uint8_t pin, uint8_t level) { pinLevels[pin] = level; }
+
+inline int digitalRead(uint8_t pin) { return pinLevels[pin]; }
+
+inline uint16_t analogRead(uint8_t) { return 0; }
+
+/**
+ * @brief Serial port writing to stdout, nothing is ever received
+ */
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial {
+public:
+    HardwareSerial() {}
+
+    HardwareSerial(int uartNumber) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {}
+
+    int available() { return 0; }
+
+    int read() { return -1; }
+
+    template <typename... Args>
+    int printf(const char* format, Args... args) { return ::printf(format, args...); }
+
+    size_t print(const String& value) { return fputs(value.c_str(), stdout) >= 0 ? value.length() : 0; }
+
+    size_t println(const String& value = String()) { return print(value) + print("\n"); }
+};
+
+inline HardwareSerial Serial;
+
+inline HardwareSerial Serial1;
+
+/**
+ * @brief Heap statistics of the ESP class, the host reports none
+ */
+class EspClass {
+public:
+    uint32_t getFreeHeap() { return 0; }
+
+    uint32_t getMinFreeHeap() { return 0; }
+
+    uint32_t getMaxAllocHeap() { return 0; }
+
+    void restart() { exit(0); }
+};
+
+inline EspClass ESP;
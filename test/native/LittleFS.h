@@ -0,0 +1,63 @@
+#pragma once
+
+// LittleFS shim, the file system never mounts so the store and forward log stays disabled
+
+#include <Arduino.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File {
+public:
+    operator bool() const { return false; }
+
+    size_t write(const uint8_t*, size_t) { return 0; }
+
+    size_t read(uint8_t*, size_t) { return 0; }
+
+    bool seek(uint32_t) { return false; }
+
+    size_t size() { return 0; }
+
+    size_t position() { return 0; }
+
+    void flush() {}
+
+    void close() {}
+
+    bool isDirectory() { return false; }
+
+    File openNextFile() { return File(); }
+
+    const char* name() { return ""; }
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool = false, const char* = "/littlefs", uint8_t = 10, const char* = "spiffs") { return false; }
+
+    bool exists(const char*) { return false; }
+
+    bool exists(const String&) { return false; }
+
+    bool mkdir(const char*) { return false; }
+
+    File open(const char*, const char* = FILE_READ, bool = false) { return File(); }
+
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+
+    bool remove(const char*) { return false; }
+
+    bool remove(const String&) { return false; }
+
+    bool rename(const char*, const char*) { return false; }
+
+    bool rename(const String&, const String&) { return false; }
+
+    size_t usedBytes() { return 0; }
+
+    size_t totalBytes() { return 0; }
+};
+
+inline LittleFSFS LittleFS;
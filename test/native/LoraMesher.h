@@ -0,0 +1,285 @@
+#pragma once
+
+// Fake LoRaMesher of the native environment. There is no radio: the routing table is filled by the
+// benchmarks with addRoute() and the packets sent are only counted.
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#include <vector>
+
+// Same routing table as the BMX6 branch of platformio.ini
+#define LORAMESHER_BMX
+
+#define BROADCAST_ADDR 0xFFFF
+#define ROLE_DEFAULT 0b00000000
+#define ROLE_GATEWAY 0b00000001
+#define HELLO_PACKETS_DELAY 120 //s
+#define LM_CONFIG_HEADER_SIZE 9
+
+#pragma pack(push, 1)
+
+struct NetworkNode {
+    uint16_t address = 0;
+    uint8_t metric = 0;
+    uint8_t role = ROLE_DEFAULT;
+};
+
+struct RouteNode {
+    NetworkNode networkNode;
+    unsigned long timeout = 0;
+    uint16_t via = 0;
+    int8_t receivedSNR = 0;
+    int8_t sentSNR = 0;
+    unsigned long SRTT = 0;
+    unsigned long RTTVAR = 0;
+};
+
+struct LM_PacketHeader {
+    uint8_t type;
+    uint8_t id;
+    uint8_t packetSize;
+    uint16_t src;
+    uint16_t dst;
+    uint16_t via;
+    uint8_t seq_id;
+    uint16_t number;
+};
+
+struct LM_State {
+    uint8_t id;
+    uint8_t type;
+    uint16_t receivedQueueSize;
+    uint16_t sentQueueSize;
+    uint16_t receivedUserQueueSize;
+    uint16_t q_WRPSize;
+    uint16_t q_WSPSize;
+    uint16_t routingTableSize;
+    uint32_t secondsSinceStart;
+    uint32_t freeMemoryAllocation;
+    LM_PacketHeader packetHeader;
+};
+
+#pragma pack(pop)
+
+template <class T>
+class AppPacket {
+public:
+    uint16_t dst;
+    uint16_t src;
+    uint32_t payloadSize = 0;
+    T payload[];
+};
+
+/**
+ * @brief List with the cursor interface of LoRaMesher, it owns copies of its elements
+ */
+template <class T>
+class LM_LinkedList {
+public:
+    LM_LinkedList() {}
+
+    ~LM_LinkedList() {
+        Clear();
+    }
+
+    void setInUse() {}
+
+    void releaseInUse() {}
+
+    int getLength() { return items.size(); }
+
+    bool moveToStart() {
+        cursor = 0;
+        return !items.empty();
+    }
+
+    bool next() {
+        if (cursor + 1 >= items.size())
+            return false;
+        cursor++;
+        return true;
+    }
+
+    T* getCurrent() { return cursor < items.size() ? items[cursor] : nullptr; }
+
+    void Append(T* item) { items.push_back(item); }
+
+    T* Pop() {
+        if (items.empty())
+            return nullptr;
+        T* item = items.front();
+        items.erase(items.begin());
+        return item;
+    }
+
+    void Clear() {
+        for (T* item : items)
+            delete item;
+        items.clear();
+    }
+
+private:
+    std::vector<T*> items;
+
+    size_t cursor = 0;
+};
+
+class SimulatorService {
+public:
+    LM_LinkedList<LM_State>* statesList = new LM_LinkedList<LM_State>();
+
+    void startSimulation() {}
+
+    void stopSimulation() {}
+};
+
+class RoutingTableService {
+public:
+    inline static uint8_t routingTableId = 0;
+
+    inline static std::vector<RouteNode> routes;
+
+    static void printRoutingTable() {}
+
+    static size_t routingTableSize() { return routes.size(); }
+
+    static RouteNode* findNode(uint16_t address) {
+        for (RouteNode& route : routes)
+            if (route.networkNode.address == address)
+                return &route;
+        return nullptr;
+    }
+
+    static uint16_t getNextHop(uint16_t dst) {
+        RouteNode* route = findNode(dst);
+        return route ? route->via : 0;
+    }
+};
+
+class LoraMesher {
+public:
+    static LoraMesher& getInstance() {
+        static LoraMesher instance;
+        return instance;
+    }
+
+    enum LoraModules {
+        SX1276_MOD,
+        SX1262_MOD,
+    };
+
+    struct LoraMesherConfig {
+        uint8_t loraCs = 0;
+        uint8_t loraRst = 0;
+        uint8_t loraIrq = 0;
+        uint8_t loraIo1 = 0;
+        LoraModules module = SX1276_MOD;
+        float freq = 869.9;
+        float bw = 125.0;
+        uint8_t sf = 7;
+        uint8_t cr = 7;
+        uint8_t syncWord = 0x12;
+        int8_t power = 2;
+        uint16_t preambleLength = 8;
+        SPIClass* spi = nullptr;
+    };
+
+    /**
+     * @brief Add or replace a route, the routing table id changes like after a hello
+     */
+    void addRoute(uint16_t address, uint16_t via, uint8_t metric, uint8_t role = ROLE_DEFAULT, int8_t snr = 0) {
+        RouteNode* route = RoutingTableService::findNode(address);
+        if (!route) {
+            RoutingTableService::routes.push_back(RouteNode());
+            route = &RoutingTableService::routes.back();
+        }
+        route->networkNode.address = address;
+        route->networkNode.metric = metric;
+        route->networkNode.role = role;
+        route->via = via;
+        route->receivedSNR = snr;
+        route->SRTT = 1000 + metric * 250;
+        RoutingTableService::routingTableId++;
+    }
+
+    void clearRoutes() {
+        RoutingTableService::routes.clear();
+        RoutingTableService::routingTableId++;
+    }
+
+    void begin(LoraMesherConfig) {}
+
+    void start() {}
+
+    void standby() {}
+
+    uint16_t getLocalAddress() { return localAddress; }
+
+    void setLocalAddress(uint16_t address) { localAddress = address; }
+
+    LM_LinkedList<RouteNode>* routingTableListCopy() {
+        LM_LinkedList<RouteNode>* copy = new LM_LinkedList<RouteNode>();
+        for (const RouteNode& route : RoutingTableService::routes)
+            copy->Append(new RouteNode(route));
+        return copy;
+    }
+
+    RouteNode* getClosestGateway() {
+        RouteNode* closest = nullptr;
+        for (RouteNode& route : RoutingTableService::routes)
+            if ((route.networkNode.role & ROLE_GATEWAY) == ROLE_GATEWAY &&
+                (!closest || route.networkNode.metric < closest->networkNode.metric))
+                closest = &route;
+        return closest;
+    }
+
+    void addGatewayRole() { role |= ROLE_GATEWAY; }
+
+    void removeGatewayRole() { role &= ~ROLE_GATEWAY; }
+
+    void setReceiveAppDataTaskHandle(TaskHandle_t) {}
+
+    size_t getReceivedQueueSize() { return 0; }
+
+    size_t getSendQueueSize() { return 0; }
+
+    size_t queueWaitingSendPacketsLength() { return 0; }
+
+    template <class T>
+    AppPacket<T>* getNextAppPacket() { return nullptr; }
+
+    template <class T>
+    void deletePacket(AppPacket<T>* packet) { free(packet); }
+
+    void createPacketAndSend(uint16_t, uint8_t*, uint8_t size) {
+        packetsSent++;
+        bytesSent += size;
+    }
+
+    void sendReliablePacket(uint16_t, uint8_t*, uint32_t size) {
+        packetsSent++;
+        bytesSent += size;
+    }
+
+    bool hasActiveConnections() { return false; }
+
+    bool hasActiveSentConnections() { return false; }
+
+    bool hasActiveReceivedConnections() { return false; }
+
+    void setSimulatorService(SimulatorService*) {}
+
+    void removeSimulatorService() {}
+
+    static uint32_t getMaxAppDataSize() { return 255 - LM_CONFIG_HEADER_SIZE; }
+
+    uint32_t packetsSent = 0;
+
+    uint32_t bytesSent = 0;
+
+private:
+    uint16_t localAddress = 0x1000;
+
+    uint8_t role = ROLE_DEFAULT;
+};
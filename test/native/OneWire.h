@@ -0,0 +1,9 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Only declared by SoilHTSensor, its driver is not built on the host
+class OneWire {
+public:
+    OneWire(uint8_t pin) {}
+};
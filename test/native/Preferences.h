@@ -0,0 +1,35 @@
+#pragma once
+
+// Preferences shim, the values are kept in memory
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+
+class Preferences {
+public:
+    bool begin(const char*, bool = false) { return true; }
+
+    void end() {}
+
+    size_t putString(const char* key, const String& value) {
+        values[key] = value.c_str();
+        return value.length();
+    }
+
+    String getString(const char* key, const String& defaultValue = String()) {
+        auto value = values.find(key);
+        return value == values.end() ? defaultValue : String(value->second.c_str());
+    }
+
+    bool remove(const char* key) { return values.erase(key) > 0; }
+
+    bool clear() {
+        values.clear();
+        return true;
+    }
+
+private:
+    std::map<std::string, std::string> values;
+};
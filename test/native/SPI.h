@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define VSPI 3
+#define HSPI 2
+
+class SPIClass {
+public:
+    SPIClass(uint8_t spiBus = HSPI) {}
+
+    void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+
+    void end() {}
+};
+
+inline SPIClass SPI(VSPI);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+
+// u-blox GPS configuration of the T-Beam, the host has no module and every call succeeds
+
+#define COM_TYPE_NMEA 0x02
+#define COM_PORT_UART1 1
+
+#define UBX_NMEA_GGA 0x00
+#define UBX_NMEA_GLL 0x01
+#define UBX_NMEA_GSA 0x02
+#define UBX_NMEA_GSV 0x03
+#define UBX_NMEA_RMC 0x04
+#define UBX_NMEA_VTG 0x05
+
+class SFE_UBLOX_GPS {
+public:
+    bool begin(HardwareSerial& serialPort) { return true; }
+
+    bool setUART1Output(uint8_t comSettings) { return true; }
+
+    bool saveConfiguration() { return true; }
+
+    bool enableNMEAMessage(uint8_t message, uint8_t port) { return true; }
+
+    bool disableNMEAMessage(uint8_t message, uint8_t port) { return true; }
+};
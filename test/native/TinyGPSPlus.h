@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+
+// TinyGPSPlus with the fields read by GPSService. The host has no GPS module, nothing is ever encoded and
+// every value stays at 0, so GPSService sees no fix
+
+class TinyGPSLocation {
+public:
+    bool isValid() const { return valid; }
+
+    bool isUpdated() const { return updated; }
+
+    double lat() { return latitude; }
+
+    double lng() { return longitude; }
+
+private:
+    bool valid = false;
+    bool updated = false;
+    double latitude = 0;
+    double longitude = 0;
+};
+
+class TinyGPSAltitude {
+public:
+    double meters() { return value; }
+
+private:
+    double value = 0;
+};
+
+class TinyGPSInteger {
+public:
+    uint32_t value() { return number; }
+
+private:
+    uint32_t number = 0;
+};
+
+class TinyGPSTime {
+public:
+    uint8_t hour() { return 0; }
+
+    uint8_t minute() { return 0; }
+
+    uint8_t second() { return 0; }
+};
+
+class TinyGPSDate {
+public:
+    uint16_t year() { return 2000; }
+
+    uint8_t month() { return 1; }
+
+    uint8_t day() { return 1; }
+};
+
+class TinyGPSPlus {
+public:
+    bool encode(char c) { return false; }
+
+    static double distanceBetween(double lat1, double long1, double lat2, double long2) {
+        const double radius = 6372795;
+        double dLat = (lat2 - lat1) * M_PI / 180;
+        double dLong = (long2 - long1) * M_PI / 180;
+        double a = sin(dLat / 2) * sin(dLat / 2) +
+            cos(lat1 * M_PI / 180) * cos(lat2 * M_PI / 180) * sin(dLong / 2) * sin(dLong / 2);
+        return 2 * radius * atan2(sqrt(a), sqrt(1 - a));
+    }
+
+    TinyGPSLocation location;
+    TinyGPSAltitude altitude;
+    TinyGPSInteger satellites;
+    TinyGPSTime time;
+    TinyGPSDate date;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class WiFiClass {
+public:
+    int status() { return WL_DISCONNECTED; }
+};
+
+inline WiFiClass WiFi;
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief I2C bus without devices, the sensor and PMU drivers are not built on the host
+ */
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+};
+
+inline TwoWire Wire;
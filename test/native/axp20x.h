@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Wire.h>
+
+// AXP192 power management unit of the T-Beam, the host has none and every call succeeds
+
+#define AXP192_SLAVE_ADDRESS 0x34
+
+#define AXP202_ON 1
+#define AXP202_OFF 0
+
+enum {
+    AXP192_DCDC1 = 0,
+    AXP192_DCDC3 = 1,
+    AXP192_LDO2 = 2,
+    AXP192_LDO3 = 3,
+    AXP192_DCDC2 = 4,
+    AXP192_EXTEN = 6,
+};
+
+class AXP20X_Class {
+public:
+    int begin(TwoWire& port, uint8_t address) { return 0; }
+
+    int setPowerOutPut(uint8_t channel, bool enable) { return 0; }
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef const char* esp_event_base_t;
+typedef int esp_err_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t base, int32_t id, void* data);
+typedef void* esp_event_handler_instance_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERROR_CHECK(x) ((void) (x))
+
+#define ESP_EVENT_ANY_ID -1
+
+inline const char* esp_err_to_name(esp_err_t code) {
+    return code == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+/**
+ * @brief The default loop is never run on the host, the handlers are not called
+ */
+inline esp_err_t esp_event_loop_create_default() {
+    return ESP_OK;
+}
+
+inline esp_err_t esp_event_handler_instance_register(esp_event_base_t, int32_t, esp_event_handler_t, void*,
+    esp_event_handler_instance_t*) {
+    return ESP_OK;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdio.h>
+
+// The errors and warnings are printed, the rest would only add noise to the benchmarks. The
+// arguments of the dropped levels are not compiled, some of them cast pointers to uint32_t
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do {} while (0)
+#define ESP_LOGD(tag, format, ...) do {} while (0)
+#define ESP_LOGV(tag, format, ...) do {} while (0)
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+inline uint32_t esp_random() {
+    return ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+}
+
+inline uint32_t esp_get_free_heap_size() {
+    return 0;
+}
+
+inline void esp_restart() {
+    exit(0);
+}
+
+inline int64_t esp_timer_get_time() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "esp_event.h"
+
+// WiFi station of ESP-IDF, the host never gets an access point: the connection attempts are accepted and
+// the station stays disconnected
+
+#define ESP_ERR_WIFI_CONN 0x3007
+
+inline esp_event_base_t WIFI_EVENT = "WIFI_EVENT";
+inline esp_event_base_t IP_EVENT = "IP_EVENT";
+
+enum {
+    WIFI_EVENT_STA_START = 2,
+    WIFI_EVENT_STA_STOP = 3,
+    WIFI_EVENT_STA_DISCONNECTED = 5,
+};
+
+enum {
+    IP_EVENT_STA_GOT_IP = 0,
+};
+
+typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+} wifi_mode_t;
+
+typedef enum {
+    WIFI_IF_STA = 0,
+} wifi_interface_t;
+
+typedef struct {
+    int unused;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() {0}
+
+typedef struct {
+    uint8_t ssid[33];
+} wifi_ap_record_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+} wifi_sta_config_t;
+
+typedef union {
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef esp_ip4_addr_t ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    esp_netif_ip_info_t ip_info;
+} ip_event_got_ip_t;
+
+typedef struct esp_netif_obj esp_netif_t;
+
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(ipaddr) ((ipaddr)->addr & 0xff), (((ipaddr)->addr >> 8) & 0xff), \
+    (((ipaddr)->addr >> 16) & 0xff), (((ipaddr)->addr >> 24) & 0xff)
+
+inline esp_err_t esp_netif_init() { return ESP_OK; }
+
+inline esp_netif_t* esp_netif_create_default_wifi_sta() { return nullptr; }
+
+inline esp_netif_t* esp_netif_get_handle_from_ifkey(const char*) { return nullptr; }
+
+inline esp_err_t esp_netif_get_ip_info(esp_netif_t*, esp_netif_ip_info_t*) { return ESP_FAIL; }
+
+inline char* ip4addr_ntoa_r(const ip4_addr_t* address, char* buffer, int length) {
+    snprintf(buffer, length, IPSTR, IP2STR(address));
+    return buffer;
+}
+
+inline esp_err_t esp_wifi_init(const wifi_init_config_t*) { return ESP_OK; }
+
+inline esp_err_t esp_wifi_set_mode(wifi_mode_t) { return ESP_OK; }
+
+inline esp_err_t esp_wifi_set_config(wifi_interface_t, wifi_config_t*) { return ESP_OK; }
+
+inline esp_err_t esp_wifi_start() { return ESP_OK; }
+
+inline esp_err_t esp_wifi_stop() { return ESP_OK; }
+
+inline esp_err_t esp_wifi_connect() { return ESP_OK; }
+
+inline esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t*) { return ESP_ERR_WIFI_CONN; }
+
+inline esp_err_t esp_wifi_set_max_tx_power(int8_t) { return ESP_OK; }
+
+inline esp_err_t esp_wifi_get_max_tx_power(int8_t* power) {
+    *power = 0;
+    return ESP_OK;
+}
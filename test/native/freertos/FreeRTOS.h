@@ -0,0 +1,40 @@
+#pragma once
+
+// FreeRTOS shim of the native environment. The benchmarks run on one thread, so the critical sections
+// are empty and the tasks are not started, the benchmarks call the code they measure directly.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL 0
+
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef struct {
+    uint32_t owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void) (mux))
+#define portEXIT_CRITICAL(mux) ((void) (mux))
+#define portENTER_CRITICAL_ISR(mux) ((void) (mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void) (mux))
+
+inline void* pvPortMalloc(size_t size) {
+    return malloc(size);
+}
+
+inline void vPortFree(void* pointer) {
+    free(pointer);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+
+/**
+ * @brief Event bits of a group, the waits return at once with the bits set
+ */
+struct EventGroupDefinition {
+    EventBits_t bits;
+};
+
+typedef EventGroupDefinition* EventGroupHandle_t;
+
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+
+inline EventGroupHandle_t xEventGroupCreate() {
+    return new EventGroupDefinition{0};
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    return group->bits |= bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+    BaseType_t waitForAll, TickType_t) {
+    EventBits_t previous = group->bits;
+    if (clearOnExit)
+        group->bits &= ~bits;
+    return previous;
+}
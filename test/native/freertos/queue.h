@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "FreeRTOS.h"
+
+/**
+ * @brief Bounded queue of items copied by value, it never blocks
+ */
+struct QueueDefinition {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+typedef QueueDefinition* QueueHandle_t;
+typedef QueueHandle_t xQueueHandle;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new QueueDefinition{length, itemSize, {}};
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+inline BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t) {
+    if (!queue || queue->items.size() >= queue->length)
+        return errQUEUE_FULL;
+
+    const uint8_t* data = (const uint8_t*) item;
+    queue->items.emplace_back(data, data + queue->itemSize);
+    return pdPASS;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return xQueueSendToBack(queue, item, ticks);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t) {
+    if (!queue || queue->items.empty())
+        return pdFALSE;
+
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue ? queue->items.size() : 0;
+}
+
+inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    return queue ? queue->length - queue->items.size() : 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include "esp_system.h"
+
+typedef void* TaskHandle_t;
+
+typedef void (*TaskFunction_t)(void*);
+
+/**
+ * @brief The task is not started, it gets a handle so the callers see it as created
+ */
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t,
+    TaskHandle_t* handle, BaseType_t) {
+    static uint8_t tasks[64];
+    static uint8_t created = 0;
+    if (handle)
+        *handle = &tasks[created++ % sizeof(tasks)];
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack, void* parameters,
+    UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stack, parameters, priority, handle, tskNO_AFFINITY);
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline void vTaskDelay(TickType_t) {}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return nullptr;
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+    return 0;
+}
+
+inline TickType_t xTaskGetTickCount() {
+    return esp_timer_get_time() / 1000;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t) {}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) {
+    return 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// ESP-MQTT shim, the client is never created so nothing is published
+
+#include "esp_event.h"
+
+typedef struct esp_mqtt_client* esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+} esp_mqtt_event_id_t;
+
+typedef enum {
+    MQTT_ERROR_TYPE_NONE = 0,
+    MQTT_ERROR_TYPE_TCP_TRANSPORT,
+    MQTT_ERROR_TYPE_CONNECTION_REFUSED,
+} esp_mqtt_error_type_t;
+
+typedef struct {
+    esp_err_t esp_tls_last_esp_err;
+    int esp_tls_stack_err;
+    int esp_tls_cert_verify_flags;
+    esp_mqtt_error_type_t error_type;
+    int connect_return_code;
+    int esp_transport_sock_errno;
+} esp_mqtt_error_codes_t;
+
+typedef struct {
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    void* user_context;
+    char* data;
+    int data_len;
+    int total_data_len;
+    int current_data_offset;
+    char* topic;
+    int topic_len;
+    int msg_id;
+    int session_present;
+    esp_mqtt_error_codes_t* error_handle;
+    bool retain;
+    int qos;
+    bool dup;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t* esp_mqtt_event_handle_t;
+
+typedef struct {
+    const char* uri;
+    const char* host;
+    uint32_t port;
+    const char* client_id;
+    const char* username;
+    const char* password;
+    int keepalive;
+    int buffer_size;
+    int out_buffer_size;
+    int task_stack;
+    int task_prio;
+} esp_mqtt_client_config_t;
+
+typedef void (*esp_event_handler_t)(void* arguments, esp_event_base_t base, int32_t eventId, void* eventData);
+
+inline esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t*) { return nullptr; }
+
+inline esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t) { return ESP_FAIL; }
+
+inline esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t) { return ESP_FAIL; }
+
+inline esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t) { return ESP_FAIL; }
+
+inline esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t, esp_mqtt_event_id_t, esp_event_handler_t, void*) {
+    return ESP_FAIL;
+}
+
+inline int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t, const char*, int) { return -1; }
+
+inline int esp_mqtt_client_publish(esp_mqtt_client_handle_t, const char*, const char*, int, int, int) { return -1; }
+
+inline int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t, const char*, const char*, int, int, int, bool) { return -1; }
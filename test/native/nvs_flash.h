@@ -0,0 +1,14 @@
+#pragma once
+
+#include "esp_event.h"
+
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+inline esp_err_t nvs_flash_init() {
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_flash_erase() {
+    return ESP_OK;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// Camera sensor header of the ESP32 Arduino core, included by led.h and unused
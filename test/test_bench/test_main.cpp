@@ -0,0 +1,604 @@
+// Host microbenchmarks of the message path: MessageManager dispatch, the serialization of every message
+// to JSON and MessagePack and back, the console commands, the routing table formatting and the next hop lookups.
+// Run with: pio test -e native -v
+// Each benchmark prints its time per operation. test_output checks the exact JSON and MessagePack of every
+// message, the other assertions only check that the measured path worked.
+// The timings are those of the host CPU, use them to compare changes, not as ESP32 numbers.
+
+#include <unity.h>
+
+#include "message/messageManager.h"
+
+#include "loramesh/loraMeshService.h"
+
+#include "loramesh/routingSnapshot.h"
+
+#include "mqtt/mqttService.h"
+
+#include "monitor/monService.h"
+
+#include "simulator/sim.h"
+
+#include "gps/gpsService.h"
+
+#include "wifi/wifiServerService.h"
+
+#include "led/led.h"
+
+#include "sensor/sensorService.h"
+
+#include "sensor/metadata/metadata.h"
+
+static const uint32_t ITERATIONS = 20000;
+
+static const uint32_t MON_ROUTES = 6;
+
+static const uint16_t LOCAL_ADDRESS = 0x1000;
+
+/**
+ * @brief Run the body once per iteration after a warm up and print the time per operation
+ *
+ * @return double Nanoseconds per operation
+ */
+template <typename Body>
+static double bench(const char* name, uint32_t iterations, Body body) {
+    for (uint32_t i = 0; i < iterations / 10; i++)
+        body(i);
+
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; i++)
+        body(i);
+    double ns = (esp_timer_get_time() - start) * 1000.0 / iterations;
+
+    printf("%-44s %10.1f ns/op\n", name, ns);
+    return ns;
+}
+
+static void setHeader(DataMessage* message, appPort port, uint32_t messageSize) {
+    message->appPortSrc = port;
+    message->appPortDst = port;
+    message->messageId = 1;
+    message->addrSrc = 0x2000;
+    message->addrDst = LOCAL_ADDRESS;
+    message->messageSize = messageSize;
+    message->priority = DefaultPriority;
+    message->deadline = 0;
+}
+
+static void setGPS(GPSMessage& gps) {
+    // Exact in binary, so the expected JSON does not depend on how the floats are rounded
+    gps.latitude = 41.375;
+    gps.longitude = 2.15625;
+    gps.altitude = 12.5;
+    gps.satellites = 7;
+    gps.hour = 10;
+    gps.minute = 42;
+    gps.second = 3;
+    gps.day = 17;
+    gps.month = 10;
+    gps.year = 2026;
+}
+
+static DataMessage* createMeasurement() {
+    MeasurementMessage* measurement = new MeasurementMessage();
+    setHeader((DataMessage*) measurement, SensorApp, MeasurementMessageSchema.payloadSize);
+    measurement->sensorCommand = SensorCommand::Data;
+    setGPS(measurement->gps);
+    measurement->phSensorMessage.temperature = 21.5;
+    measurement->phSensorMessage.ph = 7.25;
+    measurement->sht4xAirSensorMessage.temperature = 22.125;
+    measurement->sht4xAirSensorMessage.humidity = 55.375;
+    measurement->soilSensorMessage.temperature = 180;
+    measurement->soilSensorMessage.moisture = 320;
+    measurement->soilSensorMessage.conductivity = 410;
+    measurement->waterLevelSensorMessage.distance = 1200;
+    return (DataMessage*) measurement;
+}
+
+static DataMessage* createCalibrate() {
+    CalibrateMessage* calibrate = new CalibrateMessage();
+    setHeader((DataMessage*) calibrate, SensorApp, CalibrateMessageSchema.payloadSize);
+    calibrate->sensorCommand = SensorCommand::Calibrate;
+    return (DataMessage*) calibrate;
+}
+
+static DataMessage* createMetadata() {
+    MetadataMessage* metadata = new MetadataMessage();
+    setHeader((DataMessage*) metadata, MetadataApp, MetadataMessageSchema.payloadSize);
+    setGPS(metadata->gps);
+    metadata->metadataSendTimeInterval = 300;
+    metadata->batteryPercentage = 87.5;
+    return (DataMessage*) metadata;
+}
+
+static DataMessage* createGPS() {
+    GPSMessageResponse* gps = new GPSMessageResponse();
+    setHeader((DataMessage*) gps, GPSApp, GPSMessageResponseSchema.payloadSize);
+    gps->type = GPSMessageType::getGPS;
+    setGPS(gps->gps);
+    return (DataMessage*) gps;
+}
+
+static DataMessage* createLed() {
+    LedMessage* led = new LedMessage();
+    setHeader((DataMessage*) led, LedApp, LedMessageSchema.payloadSize);
+    led->ledCommand = LedCommand::On;
+    return (DataMessage*) led;
+}
+
+static DataMessage* createSimState() {
+    uint32_t payloadSize = sizeof(SimCommand) + sizeof(SimMessageState);
+    SimMessage* sim = (SimMessage*) ::operator new(sizeof(DataMessageGeneric) + payloadSize);
+    memset(sim, 0, sizeof(DataMessageGeneric) + payloadSize);
+    setHeader((DataMessage*) sim, SimApp, payloadSize);
+    sim->simCommand = SimCommand::Message;
+
+    SimMessageState* state = (SimMessageState*) sim->payload;
+    state->state.id = 3;
+    state->state.receivedQueueSize = 2;
+    state->state.routingTableSize = 12;
+    state->state.secondsSinceStart = 3600;
+    state->state.freeMemoryAllocation = 120000;
+    state->state.packetHeader.src = 0x2000;
+    state->state.packetHeader.dst = 0x3000;
+    state->state.packetHeader.packetSize = 48;
+    return (DataMessage*) sim;
+}
+
+static DataMessage* createSimPayload() {
+    uint32_t packetSize = 64;
+    uint32_t payloadSize = sizeof(SimCommand) + sizeof(SimPayloadMessage) + packetSize;
+    SimMessage* sim = (SimMessage*) ::operator new(sizeof(DataMessageGeneric) + payloadSize);
+    setHeader((DataMessage*) sim, SimApp, payloadSize);
+    sim->simCommand = SimCommand::Payload;
+
+    SimPayloadMessage* payload = (SimPayloadMessage*) sim->payload;
+    payload->packetSize = packetSize;
+    for (uint32_t i = 0; i < packetSize; i++)
+        payload->payload[i] = i;
+    return (DataMessage*) sim;
+}
+
+static DataMessage* createMonitor() {
+    const char* sensorData = "{\"temperature\":21.5,\"humidity\":55.3}";
+    uint16_t sensorDataSize = strlen(sensorData) + 1;
+    uint32_t messageStructSize = monOneMessage::getMessageStructSize(MON_ROUTES, sensorDataSize);
+
+    monOneMessage* mon = (monOneMessage*) ::operator new(messageStructSize);
+    new (mon) monOneMessage();
+    setHeader((DataMessage*) mon, MonApp, messageStructSize - sizeof(DataMessageGeneric));
+    mon->appPortDst = MQTTApp;
+    mon->uptime = 3600000;
+    mon->TxQ = 1;
+    mon->RxQ = 0;
+    mon->number_of_neighbors = MON_ROUTES;
+    mon->routingTableId = 9;
+    setGPS(mon->gpsData);
+    for (uint32_t i = 0; i < MON_ROUTES; i++)
+        mon->rt[i] = {0x2000 + i, (int8_t) (5 - i), 1200 + i * 100, (uint8_t) (1 + i % 3), (uint16_t) (100 + i * 25)};
+    mon->setSensorData(sensorData, sensorDataSize);
+    return (DataMessage*) mon;
+}
+
+struct BenchMessage {
+    const char* name;
+    DataMessage* message;
+};
+
+static BenchMessage messages[8];
+
+static const size_t MESSAGE_COUNT = sizeof(messages) / sizeof(messages[0]);
+
+// Downlinks as the server publishes them, only the services with a getDataMessage
+static const char* downlinks[][2] = {
+    {"led", "{\"data\":{\"appPortDst\":13,\"appPortSrc\":13,\"messageId\":1,\"addrSrc\":0,\"addrDst\":4096,"
+        "\"ledCommand\":1}}"},
+    {"calibrate", "{\"data\":{\"appPortDst\":14,\"appPortSrc\":14,\"messageId\":2,\"addrSrc\":0,\"addrDst\":4096,"
+        "\"sensorCommand\":1}}"},
+    {"measurement", "{\"data\":{\"appPortDst\":14,\"appPortSrc\":14,\"messageId\":3,\"addrSrc\":0,\"addrDst\":4096,"
+        "\"sensorCommand\":0}}"},
+    {"metadata", "{\"data\":{\"appPortDst\":15,\"appPortSrc\":15,\"messageId\":4,\"addrSrc\":0,\"addrDst\":4096,"
+        "\"gps.latitude\":41.38879,\"gps.longitude\":2.15899,\"gps.altitude\":12.5,\"gps.satellites\":7,"
+        "\"gps.year\":2026,\"metadataSendTimeInterval\":300,\"batteryPercentage\":87.5}}"},
+    {"sim", "{\"data\":{\"appPortDst\":12,\"appPortSrc\":12,\"messageId\":5,\"addrSrc\":0,\"addrDst\":4096,"
+        "\"simCommand\":1}}"},
+    {"monitor", "{\"data\":{\"appPortDst\":8,\"appPortSrc\":16,\"messageId\":6,\"addrSrc\":8192,\"addrDst\":0,"
+        "\"RTcount\":65535,\"uptime\":3600000,\"TxQ\":1,\"RxQ\":0,\"number_of_neighbors\":6,\"routingTableId\":9,"
+        "\"dutyCycleLeft\":1000,\"deferred\":0,\"sensorData\":\"{\\\"temperature\\\":21.5}\",\"rt\":["
+        "{\"neighbor\":8192,\"RxSNR\":5,\"SRTT\":1200,\"metric\":1,\"ETX\":100},"
+        "{\"neighbor\":8193,\"RxSNR\":4,\"SRTT\":1300,\"metric\":2,\"ETX\":125},"
+        "{\"neighbor\":8194,\"RxSNR\":3,\"SRTT\":1400,\"metric\":3,\"ETX\":150},"
+        "{\"neighbor\":8195,\"RxSNR\":2,\"SRTT\":1500,\"metric\":1,\"ETX\":175},"
+        "{\"neighbor\":8196,\"RxSNR\":1,\"SRTT\":1600,\"metric\":2,\"ETX\":200},"
+        "{\"neighbor\":8197,\"RxSNR\":0,\"SRTT\":1700,\"metric\":3,\"ETX\":225}]}}"},
+};
+
+// What the device publishes for each message, JSON and the positional MessagePack as hex
+static const struct {
+    const char* name;
+    DataMessage* (*create)();
+    const char* json;
+    const char* msgpack;
+} outputs[] = {
+    {"measurement", createMeasurement,
+        "{\"data\":{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":59,\"gps\":{\"latit"
+        "ude\":41.375,\"longitude\":2.15625,\"altitude\":12.5,\"satellite_number\":7},\"timestamp\":\"202"
+        "6-10-17T10:42:03\",\"message_type\":\"measurement\",\"message\":[{\"measurement\":21.5,\"type\":"
+        "\"Soil_Temperature\"},{\"measurement\":7.25,\"type\":\"Soil_PH\"},{\"measurement\":55.375,\"type"
+        "\":\"humidity\"},{\"measurement\":22.125,\"type\":\"temperature\"},{\"measurement\":180,\"type\""
+        ":\"Soil_Temperature_Low_Res\"},{\"measurement\":320,\"type\":\"Soil_Moisture\"},{\"measurement\""
+        ":410,\"type\":\"Soil_Conductivity\"},{\"measurement\":1200,\"type\":\"Water_Level\"}]}}",
+        "dc00180e01cd2000cd10003b00cb4044b00000000000cb4001400000000000cb4029000000000000070a2a03110acd07"
+        "eaca41ac0000ca40e80000ca41b10000ca425d8000ccb4cd0140cd019aca44960000"},
+    {"calibrate", createCalibrate,
+        "{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":1,\"sensorCommand\":1}",
+        "960e01cd2000cd10000101"},
+    {"metadata", createMetadata,
+        "{\"data\":{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":40,\"gps\":{\"latit"
+        "ude\":41.375,\"longitude\":2.15625,\"altitude\":12.5,\"satellite_number\":7},\"timestamp\":\"202"
+        "6-10-17T10:42:03\",\"message_type\":\"metadata\",\"metadata_send_time_interval\":300,\"battery_p"
+        "ercentage\":87.5,\"message\":[]}}",
+        "dc00110f01cd2000cd100028cb4044b00000000000cb4001400000000000cb4029000000000000070a2a03110acd07ea"
+        "cd012cca42af0000"},
+    {"gps", createGPS,
+        "{\"data\":{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":33,\"type\":2,\"gps"
+        "\":{\"latitude\":41.375,\"longitude\":2.15625,\"altitude\":12.5,\"satellite_number\":7},\"timest"
+        "amp\":\"2026-10-17T10:42:03\"}}",
+        "dc00100401cd2000cd10002102cb4044b00000000000cb4001400000000000cb4029000000000000070a2a03110acd07"
+        "ea"},
+    {"led", createLed,
+        "{\"data\":{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":1,\"ledCommand\":1}"
+        "}",
+        "960d01cd2000cd10000101"},
+    {"sim state", createSimState,
+        "{\"data\":{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":35,\"simCommand\":2"
+        ",\"state\":{\"Id\":3,\"Type\":0,\"QR\":2,\"QS\":0,\"QRU\":0,\"QWRP\":0,\"QWSP\":0,\"RT\":12,\"SS"
+        "S\":3600,\"FMA\":120000,\"packetHeader\":{\"Type\":0,\"Id\":0,\"Size\":48,\"Src\":8192,\"Dst\":1"
+        "2288,\"Via\":0,\"SeqId\":0,\"Num\":0}}}}",
+        "970c01cd2000cd100023029b030002000000000ccd0e10ce0001d4c098000030cd2000cd3000000000"},
+    {"sim payload", createSimPayload,
+        "{\"data\":{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":69,\"simCommand\":3"
+        ",\"packetSize\":64,\"payload\":63}}",
+        "980c01cd2000cd10004503403f"},
+    {"monitor", createMonitor,
+        "{\"RT\":{\"messageId\":1,\"addrSrc\":8192,\"addrDst\":4096,\"messageSize\":192,\"RTcount\":65535"
+        ",\"uptime\":3600000,\"TxQ\":1,\"RxQ\":0,\"number_of_neighbors\":6,\"routingTableId\":9,\"dutyCyc"
+        "leLeft\":1000,\"deferred\":0,\"sensorData\":\"{\\\"temperature\\\":21.5,\\\"humidity\\\":55.3}\""
+        ",\"gps\":{\"gps\":{\"latitude\":41.375,\"longitude\":2.15625,\"altitude\":12.5,\"satellite_numbe"
+        "r\":7},\"timestamp\":\"2026-10-17T10:42:03\"},\"rt\":[{\"neighbor\":8192,\"RxSNR\":5,\"SRTT\":12"
+        "00,\"metric\":1,\"ETX\":100},{\"neighbor\":8193,\"RxSNR\":4,\"SRTT\":1300,\"metric\":2,\"ETX\":1"
+        "25},{\"neighbor\":8194,\"RxSNR\":3,\"SRTT\":1400,\"metric\":3,\"ETX\":150},{\"neighbor\":8195,\""
+        "RxSNR\":2,\"SRTT\":1500,\"metric\":1,\"ETX\":175},{\"neighbor\":8196,\"RxSNR\":1,\"SRTT\":1600,"
+        "\"metric\":2,\"ETX\":200},{\"neighbor\":8197,\"RxSNR\":0,\"SRTT\":1700,\"metric\":3,\"ETX\":225}"
+        "]}}",
+        "dc00101001cd2000cd1000ccc0cdffffce0036ee8001000609cd03e800d9247b2274656d7065726174757265223a3231"
+        "2e352c2268756d6964697479223a35352e337d9acb4044b00000000000cb4001400000000000cb402900000000000007"
+        "0a2a03110acd07ea9695cd200005cd04b0016495cd200104cd0514027d95cd200203cd057803cc9695cd200302cd05dc"
+        "01ccaf95cd200401cd064002ccc895cd200500cd06a403cce1"},
+};
+
+static String toHex(const char* buffer, size_t length) {
+    String hex;
+    char digits[3];
+    for (size_t i = 0; i < length; i++) {
+        snprintf(digits, sizeof(digits), "%02x", (uint8_t) buffer[i]);
+        hex += digits;
+    }
+    return hex;
+}
+
+static void fillRoutingTable(uint16_t routes) {
+    LoraMesher& radio = LoraMesher::getInstance();
+    radio.clearRoutes();
+    for (uint16_t i = 0; i < routes; i++) {
+        uint16_t address = 0x2000 + i;
+        // A neighbor every 4 routes, the rest reached through the previous neighbor, and a gateway every 16
+        uint16_t via = i % 4 == 0 ? address : 0x2000 + i - i % 4;
+        radio.addRoute(address, via, 1 + i % 4, i % 16 == 0 ? ROLE_GATEWAY : ROLE_DEFAULT, (int8_t) (i % 10));
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_dispatch() {
+    MessageManager& manager = MessageManager::getInstance();
+    Led& led = Led::getInstance();
+
+    // Mix of the messages handled by the node: measurements, calibrations, GPS, LED commands and sim states
+    DataMessage* mix[] = {messages[0].message, messages[1].message, messages[3].message, messages[4].message,
+        messages[5].message};
+    const size_t mixSize = sizeof(mix) / sizeof(mix[0]);
+
+    led.ledOff();
+    bench("dispatch MQTT port", ITERATIONS, [&](uint32_t i) {
+        manager.processReceivedMessage(MqttPort, mix[i % mixSize]);
+    });
+    TEST_ASSERT_EQUAL(LED_ON, digitalRead(LED));
+
+    // From LoRa every message goes through the duplicate cache first, the ids change so none is dropped
+    DataMessage* ledOn = messages[4].message;
+    uint32_t sequence = 0;
+    bench("dispatch LoRa port, duplicate check", ITERATIONS, [&](uint32_t) {
+        ledOn->messageId = sequence;
+        ledOn->addrSrc = 0x2000 + (sequence++ >> 8);
+        manager.processReceivedMessage(LoRaMeshPort, ledOn);
+    });
+
+    // The last one again is a duplicate and does not reach the Led service
+    led.ledOff();
+    manager.processReceivedMessage(LoRaMeshPort, ledOn);
+    TEST_ASSERT_EQUAL(LED_OFF, digitalRead(LED));
+    ledOn->messageId = sequence++;
+    manager.processReceivedMessage(LoRaMeshPort, ledOn);
+    TEST_ASSERT_EQUAL(LED_ON, digitalRead(LED));
+
+    // Not for this node, dropped before the service is looked up
+    DataMessage other = {};
+    setHeader(&other, LedApp, 0);
+    other.addrDst = 0x3000;
+    bench("dispatch LoRa port, other destination", ITERATIONS, [&](uint32_t) {
+        other.messageId = sequence;
+        other.addrSrc = 0x2000 + (sequence++ >> 8);
+        manager.processReceivedMessage(LoRaMeshPort, &other);
+    });
+}
+
+void test_output() {
+    MessageManager& manager = MessageManager::getInstance();
+    static char buffer[MQTT_MAX_PACKET_SIZE];
+
+    for (auto& output : outputs) {
+        DataMessage* message = output.create();
+
+        String json;
+        manager.getJSON(message, json);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(output.json, json.c_str(), output.name);
+
+        JsonDocument doc;
+        size_t length = manager.encode(message, MsgPackCodec, doc, buffer, sizeof(buffer));
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(output.msgpack, toHex(buffer, length).c_str(), output.name);
+
+        delete message;
+    }
+}
+
+void test_serialize() {
+    MessageManager& manager = MessageManager::getInstance();
+    char name[64];
+
+    for (size_t m = 0; m < MESSAGE_COUNT; m++) {
+        String json;
+        snprintf(name, sizeof(name), "getJSON %s", messages[m].name);
+        bench(name, ITERATIONS, [&](uint32_t) {
+            manager.getJSON(messages[m].message, json);
+        });
+        TEST_ASSERT_TRUE_MESSAGE(json.startsWith("{") && json.indexOf("Empty") < 0, messages[m].name);
+        printf("%-44s %10u bytes\n", "", json.length());
+    }
+}
+
+void test_encode() {
+    MessageManager& manager = MessageManager::getInstance();
+    static char buffer[MQTT_MAX_PACKET_SIZE];
+    char name[64];
+
+    const messageCodec codecs[] = {JsonCodec, MsgPackCodec};
+    const char* codecNames[] = {"json", "msgpack"};
+
+    for (uint8_t c = 0; c < 2; c++) {
+        for (size_t m = 0; m < MESSAGE_COUNT; m++) {
+            JsonDocument doc;
+            size_t length = 0;
+            snprintf(name, sizeof(name), "encode %s %s", codecNames[c], messages[m].name);
+            bench(name, ITERATIONS, [&](uint32_t) {
+                doc.clear();
+                length = manager.encode(messages[m].message, codecs[c], doc, buffer, sizeof(buffer));
+            });
+            TEST_ASSERT_GREATER_THAN_MESSAGE(0, length, name);
+            printf("%-44s %10u bytes\n", "", (unsigned) length);
+        }
+    }
+}
+
+void test_deserialize() {
+    MessageManager& manager = MessageManager::getInstance();
+    char name[64];
+
+    for (auto& downlink : downlinks) {
+        String json = downlink[1];
+        DataMessage* message = manager.getDataMessage(json);
+        TEST_ASSERT_NOT_NULL_MESSAGE(message, downlink[0]);
+        delete message;
+
+        snprintf(name, sizeof(name), "getDataMessage %s", downlink[0]);
+        bench(name, ITERATIONS, [&](uint32_t) {
+            delete manager.getDataMessage(json);
+        });
+    }
+}
+
+void test_execute_command() {
+    MessageManager& manager = MessageManager::getInstance();
+    fillRoutingTable(20);
+
+    const char* commands[] = {"/poolStats", "/sendStats", "/getRT", "/mqttStats", "/schedStats", "/unknown"};
+    char name[64];
+
+    for (const char* command : commands) {
+        String result;
+        snprintf(name, sizeof(name), "executeCommand %s", command);
+        bench(name, ITERATIONS / 10, [&](uint32_t) {
+            result = manager.executeCommand(String(command));
+        });
+        TEST_ASSERT_TRUE_MESSAGE(result.length() > 0, command);
+    }
+
+    // Straight to the CommandService of the service, without the scan of hasCommand
+    String result;
+    bench("CommandService::executeCommand /poolStats", ITERATIONS / 10, [&](uint32_t) {
+        result = MonService::getInstance().commandService->executeCommand(String("/poolStats"));
+    });
+    TEST_ASSERT_TRUE(result.length() > 0);
+
+    // The duplicate window only takes a positive number of ms up to DUPLICATE_CACHE_MAX_WINDOW
+    const char* invalidWindows[] = {"/dupWindow", "/dupWindow abc", "/dupWindow 0", "/dupWindow -5",
+        "/dupWindow 3600001"};
+    for (const char* command : invalidWindows) {
+        manager.executeCommand(String(command));
+        TEST_ASSERT_EQUAL_UINT32(DUPLICATE_CACHE_WINDOW, manager.duplicates.getWindow());
+    }
+    TEST_ASSERT_EQUAL_STRING("Duplicate window: 60000 ms", manager.executeCommand(String("/dupWindow 60000")).c_str());
+    manager.duplicates.setWindow(DUPLICATE_CACHE_WINDOW);
+}
+
+void test_routing_table() {
+    LoRaMeshService& mesher = LoRaMeshService::getInstance();
+    const uint16_t sizes[] = {10, 50, LORA_ROUTING_SNAPSHOT_SIZE, 200};
+    char name[64];
+
+    for (uint16_t routes : sizes) {
+        fillRoutingTable(routes);
+
+        String table;
+        snprintf(name, sizeof(name), "getRoutingTable %d routes", routes);
+        bench(name, ITERATIONS / 10, [&](uint32_t) {
+            table = mesher.getRoutingTable();
+        });
+        TEST_ASSERT_EQUAL(routes + 1, std::count(table.c_str(), table.c_str() + table.length(), '\n'));
+
+        // The table changed since the last read, the snapshot is rebuilt before formatting it
+        snprintf(name, sizeof(name), "getRoutingTable %d routes, changed", routes);
+        bench(name, ITERATIONS / 10, [&](uint32_t) {
+            RoutingTableService::routingTableId++;
+            table = mesher.getRoutingTable();
+        });
+    }
+}
+
+void test_route_lookup() {
+    // The snapshot index holds LORA_ROUTING_SNAPSHOT_SIZE routes, the lookups of the routes past it walk the
+    // LoRaMesher table, as LoRaMeshService::getNextHop does
+    static RoutingSnapshot routingSnapshot;
+    const uint16_t sizes[] = {10, LORA_ROUTING_SNAPSHOT_SIZE, 200};
+    char name[64];
+
+    for (uint16_t routes : sizes) {
+        fillRoutingTable(routes);
+        RoutingTableService::routingTableId++;
+
+        const RoutingTableSnapshot* routingTable = routingSnapshot.acquire();
+        TEST_ASSERT_EQUAL(routes > LORA_ROUTING_SNAPSHOT_SIZE ? LORA_ROUTING_SNAPSHOT_SIZE : routes, routingTable->size);
+        TEST_ASSERT_EQUAL(routes - routingTable->size, routingTable->truncated);
+
+        auto getNextHop = [&](uint16_t dst) {
+            const RouteRecord* route = routingTable->index.find(dst);
+            if (route)
+                return route->via;
+            return routingTable->truncated > 0 ? RoutingTableService::getNextHop(dst) : (uint16_t) 0;
+        };
+
+        for (uint16_t i = 0; i < routes; i++)
+            TEST_ASSERT_EQUAL(RoutingTableService::getNextHop(0x2000 + i), getNextHop(0x2000 + i));
+
+        uint32_t found = 0;
+        snprintf(name, sizeof(name), "next hop %d routes, list", routes);
+        bench(name, ITERATIONS, [&](uint32_t i) {
+            found += RoutingTableService::getNextHop(0x2000 + i % routes) != 0;
+        });
+        snprintf(name, sizeof(name), "next hop %d routes, index", routes);
+        bench(name, ITERATIONS, [&](uint32_t i) {
+            found += getNextHop(0x2000 + i % routes) != 0;
+        });
+
+        // Addresses without a route, a truncated snapshot has to walk the whole table for them
+        snprintf(name, sizeof(name), "next hop %d routes, missing, list", routes);
+        bench(name, ITERATIONS, [&](uint32_t i) {
+            found += RoutingTableService::getNextHop(0x4000 + i % routes) != 0;
+        });
+        snprintf(name, sizeof(name), "next hop %d routes, missing, index", routes);
+        bench(name, ITERATIONS, [&](uint32_t i) {
+            found += getNextHop(0x4000 + i % routes) != 0;
+        });
+        TEST_ASSERT_EQUAL(2 * (ITERATIONS + ITERATIONS / 10), found);
+
+        routingSnapshot.release(routingTable);
+    }
+}
+
+void test_pool() {
+    MessagePool& pool = MessageManager::getInstance().pool;
+    pool.resetStats();
+
+    // A monitor frame with its neighbors and sensor JSON, and a reassembled message, take a large slot
+    uint32_t monitorSize = monOneMessage::getMessageStructSize(MON_ROUTES, 512);
+    uint32_t reassembledSize = sizeof(DataMessage) + LORA_FRAGMENT_MAX_COUNT * LORA_FRAGMENT_DATA_SIZE;
+    const size_t sizes[] = {64, MESSAGE_POOL_SLOT_SIZE, monitorSize, reassembledSize};
+    char name[64];
+
+    for (size_t size : sizes) {
+        void* buffer = pool.alloc(size);
+        TEST_ASSERT_TRUE(pool.owns(buffer));
+        pool.release(buffer);
+
+        snprintf(name, sizeof(name), "pool alloc %d bytes", (int) size);
+        bench(name, ITERATIONS, [&](uint32_t) {
+            pool.release(pool.alloc(size));
+        });
+    }
+
+    // Only the requests bigger than a large slot, or made with every slot busy, go to the heap
+    void* large[MESSAGE_POOL_LARGE_SLOTS + 1];
+    for (void*& buffer : large)
+        buffer = pool.alloc(MESSAGE_POOL_LARGE_SLOT_SIZE);
+    TEST_ASSERT_FALSE(pool.owns(large[MESSAGE_POOL_LARGE_SLOTS]));
+    for (void* buffer : large)
+        pool.release(buffer);
+
+    void* oversized = pool.alloc(MESSAGE_POOL_LARGE_SLOT_SIZE + 1);
+    TEST_ASSERT_FALSE(pool.owns(oversized));
+    pool.release(oversized);
+
+    String stats = pool.getStats();
+    TEST_ASSERT_TRUE(
+        stats.indexOf("Heap allocations: 2 (up to 256 bytes 0, up to 1536 bytes 1, bigger 1, largest 1537 bytes)") >= 0);
+}
+
+int main(int argc, char** argv) {
+    LoraMesher::getInstance().setLocalAddress(LOCAL_ADDRESS);
+
+    // The send queues are created, their worker tasks do not run on the host
+    MessageManager& manager = MessageManager::getInstance();
+    manager.init();
+    manager.addMessageService(&LoRaMeshService::getInstance());
+    manager.addMessageService(&GPSService::getInstance());
+    manager.addMessageService(&WiFiServerService::getInstance());
+    manager.addMessageService(&MqttService::getInstance());
+    manager.addMessageService(&MonService::getInstance());
+    manager.addMessageService(&Led::getInstance());
+    manager.addMessageService(&Metadata::getInstance());
+    manager.addMessageService(&SensorService::getInstance());
+    manager.addMessageService(&Sim::getInstance());
+
+    messages[0] = {"measurement", createMeasurement()};
+    messages[1] = {"calibrate", createCalibrate()};
+    messages[2] = {"metadata", createMetadata()};
+    messages[3] = {"gps", createGPS()};
+    messages[4] = {"led", createLed()};
+    messages[5] = {"sim state", createSimState()};
+    messages[6] = {"sim payload", createSimPayload()};
+    messages[7] = {"monitor", createMonitor()};
+
+    UNITY_BEGIN();
+    RUN_TEST(test_output);
+    RUN_TEST(test_dispatch);
+    RUN_TEST(test_pool);
+    RUN_TEST(test_serialize);
+    RUN_TEST(test_encode);
+    RUN_TEST(test_deserialize);
+    RUN_TEST(test_execute_command);
+    RUN_TEST(test_routing_table);
+    RUN_TEST(test_route_lookup);
+    return UNITY_END();
+}
@@ -0,0 +1,201 @@
+// Tests of the store and forward log over RamStoreBackend: the replay order, a torn write, the segment
+// rotation and the replay cursor after a reset.
+// Run with: pio test -e native -v
+
+#include <unity.h>
+
+#include "message/storeForward.h"
+
+static const uint32_t PAYLOAD_SIZE = 200;
+
+static const uint32_t RECORD_HEADER_SIZE = 8;
+
+static uint8_t buffer[sizeof(DataMessageGeneric) + PAYLOAD_SIZE];
+
+/**
+ * @brief Message of PAYLOAD_SIZE bytes, the id is in the header and in every byte of the payload
+ */
+static DataMessage* createMessage(uint16_t id) {
+    DataMessage* message = (DataMessage*) buffer;
+    memset(buffer, 0, sizeof(buffer));
+    message->appPortDst = MQTTApp;
+    message->appPortSrc = SensorApp;
+    message->messageId = id;
+    message->addrSrc = 0x2000 + id;
+    message->addrDst = 0;
+    message->messageSize = PAYLOAD_SIZE;
+    memset(message->message, (uint8_t) id, PAYLOAD_SIZE);
+    return message;
+}
+
+/**
+ * @brief Pop the next message and check it is the one stored with that id
+ */
+static void assertPop(StoreForward& log, uint16_t id) {
+    static uint8_t popped[sizeof(buffer)];
+
+    TEST_ASSERT_EQUAL(sizeof(buffer), log.peek());
+    TEST_ASSERT_TRUE(log.pop(popped, sizeof(popped)));
+
+    DataMessage* message = (DataMessage*) popped;
+    TEST_ASSERT_EQUAL(0x2000 + id, message->addrSrc);
+    TEST_ASSERT_EQUAL_MEMORY(createMessage(id), popped, sizeof(buffer));
+}
+
+static bool hasStat(StoreForward& log, const char* stat) {
+    return log.getStats().indexOf(stat) >= 0;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_replay_order() {
+    RamStoreBackend backend;
+    StoreForward log;
+    TEST_ASSERT_TRUE(log.begin(&backend));
+    TEST_ASSERT_TRUE(log.isEmpty());
+
+    for (uint16_t id = 0; id < 5; id++)
+        TEST_ASSERT_TRUE(log.store(createMessage(id)));
+
+    for (uint16_t id = 0; id < 5; id++)
+        assertPop(log, id);
+
+    TEST_ASSERT_TRUE(log.isEmpty());
+
+    // The replayed segment is given back
+    uint32_t first, last;
+    TEST_ASSERT_FALSE(backend.getRange(first, last));
+}
+
+void test_torn_write() {
+    RamStoreBackend backend;
+    StoreForward log;
+    TEST_ASSERT_TRUE(log.begin(&backend));
+
+    TEST_ASSERT_TRUE(log.store(createMessage(1)));
+
+    // A reset in the middle of the message, the header is complete
+    backend.failAfter = RECORD_HEADER_SIZE + PAYLOAD_SIZE / 2;
+    TEST_ASSERT_FALSE(log.store(createMessage(2)));
+    TEST_ASSERT_TRUE(hasStat(log, "Write errors: 1\n"));
+
+    // The next ones go to a new segment
+    backend.failAfter = SIZE_MAX;
+    TEST_ASSERT_TRUE(log.store(createMessage(3)));
+
+    // A reset in the middle of the header
+    backend.failAfter = RECORD_HEADER_SIZE / 2;
+    TEST_ASSERT_FALSE(log.store(createMessage(4)));
+    backend.failAfter = SIZE_MAX;
+    TEST_ASSERT_TRUE(log.store(createMessage(5)));
+
+    assertPop(log, 1);
+
+    // The torn message is read with a wrong checksum and skipped
+    uint8_t popped[sizeof(buffer)];
+    TEST_ASSERT_EQUAL(sizeof(buffer), log.peek());
+    TEST_ASSERT_FALSE(log.pop(popped, sizeof(popped)));
+
+    assertPop(log, 3);
+
+    // The torn header ends its segment
+    assertPop(log, 5);
+    TEST_ASSERT_TRUE(log.isEmpty());
+    TEST_ASSERT_TRUE(hasStat(log, "Damaged records: 2\n"));
+}
+
+void test_segment_rotation() {
+    RamStoreBackend backend;
+    StoreForward log;
+    TEST_ASSERT_TRUE(log.begin(&backend));
+
+    const uint32_t perSegment = STORE_FORWARD_SEGMENT_SIZE / (RECORD_HEADER_SIZE + sizeof(buffer));
+
+    // One segment more than the log keeps, the first one is dropped
+    const uint32_t count = perSegment * (STORE_FORWARD_SEGMENTS + 1);
+    for (uint32_t id = 0; id < count; id++)
+        TEST_ASSERT_TRUE(log.store(createMessage(id)));
+
+    TEST_ASSERT_TRUE(hasStat(log, "Dropped segments: 1\n"));
+
+    uint32_t first, last;
+    TEST_ASSERT_TRUE(backend.getRange(first, last));
+    TEST_ASSERT_EQUAL(STORE_FORWARD_SEGMENTS, last - first + 1);
+
+    for (uint32_t id = perSegment; id < count; id++)
+        assertPop(log, id);
+
+    TEST_ASSERT_TRUE(log.isEmpty());
+    TEST_ASSERT_FALSE(backend.getRange(first, last));
+}
+
+void test_cursor_recovery() {
+    RamStoreBackend backend;
+    uint8_t popped[sizeof(buffer)];
+
+    {
+        StoreForward log;
+        TEST_ASSERT_TRUE(log.begin(&backend));
+        for (uint16_t id = 0; id < 6; id++)
+            TEST_ASSERT_TRUE(log.store(createMessage(id)));
+
+        assertPop(log, 0);
+        assertPop(log, 1);
+        log.commit();
+
+        // Read after the last commit, lost by the reset
+        TEST_ASSERT_TRUE(log.pop(popped, sizeof(popped)));
+    }
+
+    // After a reset the replay starts again at the saved cursor
+    {
+        StoreForward log;
+        TEST_ASSERT_TRUE(log.begin(&backend));
+        assertPop(log, 2);
+        assertPop(log, 3);
+        log.commit();
+
+        // The new messages go to a new segment, after the old ones
+        TEST_ASSERT_TRUE(log.store(createMessage(6)));
+    }
+
+    {
+        StoreForward log;
+        TEST_ASSERT_TRUE(log.begin(&backend));
+        for (uint16_t id = 4; id <= 6; id++)
+            assertPop(log, id);
+        TEST_ASSERT_TRUE(log.isEmpty());
+    }
+
+    // A damaged cursor replays the log from the start
+    RamStoreBackend damaged;
+    {
+        StoreForward log;
+        TEST_ASSERT_TRUE(log.begin(&damaged));
+        TEST_ASSERT_TRUE(log.store(createMessage(7)));
+        TEST_ASSERT_TRUE(log.store(createMessage(8)));
+        assertPop(log, 7);
+        log.commit();
+    }
+
+    uint8_t state[16];
+    size_t stateSize = damaged.readState(state, sizeof(state));
+    state[stateSize - 1] ^= 0xFF;
+    damaged.writeState(state, stateSize);
+
+    StoreForward log;
+    TEST_ASSERT_TRUE(log.begin(&damaged));
+    assertPop(log, 7);
+    assertPop(log, 8);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_order);
+    RUN_TEST(test_torn_write);
+    RUN_TEST(test_segment_rotation);
+    RUN_TEST(test_cursor_recovery);
+    return UNITY_END();
+}